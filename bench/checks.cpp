@@ -0,0 +1,299 @@
+#include "checks.h"
+
+#include "damage_tracker.h"
+#include "imgui_renderer.h"
+#include "render_context.h"
+#include "synthetic_draw_data.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace mu
+{
+	namespace bench
+	{
+		namespace
+		{
+			[[nodiscard]] auto expect(bool condition, const char* what) noexcept -> mu::leaf::result<void>
+			{
+				if (!condition) [[unlikely]]
+				{
+					debug::logger()->stderr_logger()->error("check failed: {0}", what);
+					return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+				}
+				return {};
+			}
+
+			[[nodiscard]] auto same(const ImVec4& a, const ImVec4& b) noexcept -> bool
+			{
+				return a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w;
+			}
+
+			// One viewport of quads, a list each, built directly like synthetic_draw_data
+			struct quad_frame
+			{
+				std::vector<std::unique_ptr<ImDrawList>> m_lists;
+				std::vector<ImDrawList*>				 m_list_ptrs;
+				ImDrawData								 m_draw_data;
+
+				explicit quad_frame(ImVec2 size = ImVec2(640.0f, 480.0f))
+				{
+					m_draw_data.Valid			 = true;
+					m_draw_data.DisplayPos		 = ImVec2(0.0f, 0.0f);
+					m_draw_data.DisplaySize		 = size;
+					m_draw_data.FramebufferScale = ImVec2(1.0f, 1.0f);
+				}
+
+				quad_frame(const quad_frame&)			 = delete;
+				quad_frame& operator=(const quad_frame&) = delete;
+
+				// With gfx_primitives_callback the quad is a batch of two primitives, two corners each, instead of two triangles.
+				// Any other callback is a user callback put before the quad.
+				auto add(const ImVec4& rect, ImDrawCallback callback = nullptr) -> quad_frame&
+				{
+					auto list = std::make_unique<ImDrawList>(nullptr);
+
+					const ImVec4 clip_rect(0.0f, 0.0f, m_draw_data.DisplaySize.x, m_draw_data.DisplaySize.y);
+					if (callback != nullptr && callback != &gfx_primitives_callback)
+					{
+						ImDrawCmd callback_cmd;
+						callback_cmd.UserCallback = callback;
+						callback_cmd.ClipRect	  = clip_rect;
+						list->CmdBuffer.push_back(callback_cmd);
+					}
+
+					const ImVec2 corners[4] = {ImVec2(rect.x, rect.y), ImVec2(rect.z, rect.y), ImVec2(rect.z, rect.w), ImVec2(rect.x, rect.w)};
+					for (const ImVec2& corner : corners)
+					{
+						ImDrawVert vert;
+						vert.pos = corner;
+						vert.uv	 = ImVec2(0.0f, 0.0f);
+						vert.col = IM_COL32_WHITE;
+						list->VtxBuffer.push_back(vert);
+					}
+					const ImDrawIdx indices[6] = {0, 1, 2, 0, 2, 3};
+					for (ImDrawIdx idx : indices)
+					{
+						list->IdxBuffer.push_back(idx);
+					}
+
+					const bool primitives = callback == &gfx_primitives_callback;
+					ImDrawCmd  cmd;
+					cmd.ClipRect	 = clip_rect;
+					cmd.ElemCount	 = primitives ? 2 : 6;
+					cmd.UserCallback = primitives ? callback : nullptr;
+					list->CmdBuffer.push_back(cmd);
+
+					m_draw_data.TotalVtxCount += list->VtxBuffer.Size;
+					m_draw_data.TotalIdxCount += list->IdxBuffer.Size;
+					m_list_ptrs.push_back(list.get());
+					m_lists.push_back(std::move(list));
+					m_draw_data.CmdLists	  = m_list_ptrs.data();
+					m_draw_data.CmdListsCount = static_cast<int>(m_list_ptrs.size());
+					return *this;
+				}
+			};
+
+			// What damage_tracker makes of a quad: its vertices and the pixel beyond them
+			[[nodiscard]] auto quad_bounds(const ImVec4& rect) noexcept -> ImVec4
+			{
+				return ImVec4(rect.x - 1.0f, rect.y - 1.0f, rect.z + 1.0f, rect.w + 1.0f);
+			}
+
+			[[nodiscard]] auto check_damage_tracker() noexcept -> mu::leaf::result<void>
+			try
+			{
+				const ImVec4 a(10.0f, 10.0f, 50.0f, 50.0f);
+				const ImVec4 b(100.0f, 20.0f, 140.0f, 60.0f);
+				const ImVec4 c(200.0f, 200.0f, 260.0f, 240.0f);
+				const ImVec4 display(0.0f, 0.0f, 640.0f, 480.0f);
+				const ImVec4 none(0.0f, 0.0f, 0.0f, 0.0f);
+
+				{
+					damage_tracker tracker;
+					quad_frame	   first;
+					first.add(a).add(b);
+					MU_LEAF_CHECK(expect(same(tracker.update(&first.m_draw_data), display), "the first frame damages the whole viewport"));
+					MU_LEAF_CHECK(expect(same(tracker.update(&first.m_draw_data), none), "an unchanged frame damages nothing"));
+
+					quad_frame moved;
+					moved.add(a).add(c);
+					MU_LEAF_CHECK(expect(
+						same(tracker.update(&moved.m_draw_data), ImVec4(b.x - 1.0f, b.y - 1.0f, c.z + 1.0f, c.w + 1.0f)),
+						"a changed list damages the union of its old and new bounds"));
+
+					quad_frame fewer;
+					fewer.add(a);
+					MU_LEAF_CHECK(expect(same(tracker.update(&fewer.m_draw_data), quad_bounds(c)), "a list that went away damages its old bounds"));
+
+					tracker.invalidate();
+					MU_LEAF_CHECK(expect(same(tracker.update(&fewer.m_draw_data), display), "an invalidated tracker damages the whole viewport"));
+				}
+
+				{
+					damage_tracker tracker;
+					quad_frame	   first;
+					first.add(a).add(b);
+					(void)tracker.update(&first.m_draw_data);
+
+					quad_frame callbacks;
+					callbacks.add(a).add(b, &synthetic_callback);
+					MU_LEAF_CHECK(expect(same(tracker.update(&callbacks.m_draw_data), display), "a user callback damages the whole viewport"));
+					MU_LEAF_CHECK(expect(same(tracker.update(&callbacks.m_draw_data), display), "a user callback damages the whole viewport every frame"));
+				}
+
+				{
+					damage_tracker tracker;
+					quad_frame	   first;
+					first.add(a).add(b, &gfx_primitives_callback);
+					(void)tracker.update(&first.m_draw_data);
+					MU_LEAF_CHECK(expect(same(tracker.update(&first.m_draw_data), none), "unchanged primitive batches damage nothing"));
+
+					quad_frame moved;
+					moved.add(a).add(c, &gfx_primitives_callback);
+					MU_LEAF_CHECK(expect(
+						same(tracker.update(&moved.m_draw_data), ImVec4(b.x - 1.0f, b.y - 1.0f, c.z + 1.0f, c.w + 1.0f)),
+						"primitive batches damage their bounds, not the whole viewport"));
+				}
+
+				{
+					damage_tracker tracker;
+					quad_frame	   first;
+					first.add(a);
+					(void)tracker.update(&first.m_draw_data);
+
+					quad_frame resized(ImVec2(800.0f, 600.0f));
+					resized.add(a);
+					MU_LEAF_CHECK(expect(same(tracker.update(&resized.m_draw_data), ImVec4(0.0f, 0.0f, 800.0f, 600.0f)), "a new display rect damages the whole viewport"));
+
+					quad_frame moved(ImVec2(800.0f, 600.0f));
+					moved.add(a);
+					moved.m_draw_data.DisplayPos = ImVec2(100.0f, 0.0f);
+					MU_LEAF_CHECK(expect(same(tracker.update(&moved.m_draw_data), ImVec4(100.0f, 0.0f, 900.0f, 600.0f)), "a moved display damages the whole viewport"));
+
+					quad_frame scaled(ImVec2(800.0f, 600.0f));
+					scaled.add(a);
+					scaled.m_draw_data.DisplayPos		= ImVec2(100.0f, 0.0f);
+					scaled.m_draw_data.FramebufferScale = ImVec2(2.0f, 2.0f);
+					MU_LEAF_CHECK(expect(same(tracker.update(&scaled.m_draw_data), ImVec4(100.0f, 0.0f, 900.0f, 600.0f)), "a new scale damages the whole viewport"));
+				}
+				return {};
+			}
+			catch (...)
+			{
+				return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+			}
+
+			using free_ranges = std::vector<std::pair<Diligent::Uint32, Diligent::Uint32>>;
+
+			[[nodiscard]] auto check_range_allocator() noexcept -> mu::leaf::result<void>
+			try
+			{
+				Diligent::range_allocator allocator;
+				allocator.reset(100);
+
+				Diligent::Uint32 offsets[4] = {};
+				for (auto& offset : offsets)
+				{
+					MU_LEAF_CHECK(expect(allocator.allocate(10, offset), "ranges are allocated while there is room"));
+				}
+				MU_LEAF_CHECK(expect(offsets[0] == 0 && offsets[1] == 10 && offsets[2] == 20 && offsets[3] == 30, "ranges are allocated first fit"));
+
+				Diligent::Uint32 offset = 0;
+				MU_LEAF_CHECK(expect(!allocator.allocate(61, offset), "a range larger than any free one is not allocated"));
+
+				allocator.free(offsets[1], 10);
+				MU_LEAF_CHECK(expect(allocator.m_free == free_ranges{{10, 10}, {40, 60}}, "a range between used ones is freed on its own"));
+
+				allocator.free(offsets[3], 10);
+				MU_LEAF_CHECK(expect(allocator.m_free == free_ranges{{10, 10}, {30, 70}}, "a freed range merges with the next free one"));
+
+				MU_LEAF_CHECK(expect(allocator.allocate(5, offset) && offset == 10, "the first free range that fits is used"));
+				allocator.free(offset, 5);
+				MU_LEAF_CHECK(expect(allocator.m_free == free_ranges{{10, 10}, {30, 70}}, "a range freed back into its hole merges with it"));
+
+				allocator.free(offsets[0], 10);
+				MU_LEAF_CHECK(expect(allocator.m_free == free_ranges{{0, 20}, {30, 70}}, "a freed range merges with the previous free one"));
+
+				allocator.free(offsets[2], 10);
+				MU_LEAF_CHECK(expect(allocator.m_free == free_ranges{{0, 100}}, "a freed range merges with both free neighbours"));
+				return {};
+			}
+			catch (...)
+			{
+				return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+			}
+
+			[[nodiscard]] auto check_geometry_cache() noexcept -> mu::leaf::result<void>
+			try
+			{
+				// Frames of 4 lists, 256 vertices and 672 indices each, in buffers that hold exactly two of them
+				auto frame = [](int seed) -> std::unique_ptr<synthetic_draw_data>
+				{
+					synthetic_draw_data_desc desc;
+					desc.m_lists		 = 4;
+					desc.m_cmds_per_list = 4;
+					desc.m_verts_per_cmd = 16;
+					desc.m_clip_churn	 = 0.0f;
+					desc.m_seed			 = seed;
+					return std::make_unique<synthetic_draw_data>(desc, std::vector<ImTextureID>{});
+				};
+				auto a = frame(1);
+				auto b = frame(2);
+				auto c = frame(3);
+
+				auto shared_resources = std::make_shared<Diligent::imgui_shared_resources>(nullptr, Diligent::TEX_FORMAT_UNKNOWN, Diligent::TEX_FORMAT_UNKNOWN, false);
+				Diligent::imgui_renderer	renderer(shared_resources, 512, 1344, 1.0f);
+				mu::counting_render_context ctx;
+
+				auto render = [&](synthetic_draw_data& data) -> mu::leaf::result<void>
+				{
+					return renderer.render_draw_data(
+						Diligent::SURFACE_TRANSFORM_IDENTITY,
+						static_cast<Diligent::Uint32>(data.m_draw_data.DisplaySize.x),
+						static_cast<Diligent::Uint32>(data.m_draw_data.DisplaySize.y),
+						&ctx,
+						&data.m_draw_data);
+				};
+
+				MU_LEAF_CHECK(render(*a));
+				MU_LEAF_CHECK(expect(renderer.m_stats.m_lists_uploaded == 4 && renderer.m_stats.m_lists_cached == 0, "new lists are uploaded"));
+				MU_LEAF_CHECK(render(*a));
+				MU_LEAF_CHECK(expect(renderer.m_stats.m_lists_uploaded == 0 && renderer.m_stats.m_lists_cached == 4, "the same lists are drawn from the cache"));
+
+				MU_LEAF_CHECK(render(*b));
+				MU_LEAF_CHECK(expect(renderer.m_stats.m_lists_uploaded == 4, "other lists fill the rest of the buffers"));
+				MU_LEAF_CHECK(render(*c));
+				MU_LEAF_CHECK(expect(renderer.m_stats.m_lists_uploaded == 4, "lists that do not fit evict the earlier frames' and are uploaded"));
+				MU_LEAF_CHECK(expect(renderer.m_vertex_buffer_size == 512 && renderer.m_index_buffer_size == 1344, "evicting makes room without growing the buffers"));
+				MU_LEAF_CHECK(expect(renderer.m_cache.m_entries.size() == 4, "only the current frame's lists are left after evicting"));
+				MU_LEAF_CHECK(expect(
+					renderer.m_cache.m_vertices.m_free == free_ranges{{256, 256}} && renderer.m_cache.m_indices.m_free == free_ranges{{672, 672}},
+					"evicted ranges merge back into one"));
+
+				MU_LEAF_CHECK(render(*c));
+				MU_LEAF_CHECK(expect(renderer.m_stats.m_lists_cached == 4, "lists placed after evicting are drawn from the cache"));
+				MU_LEAF_CHECK(render(*a));
+				MU_LEAF_CHECK(expect(renderer.m_stats.m_lists_uploaded == 4 && renderer.m_stats.m_lists_cached == 0, "evicted lists are uploaded again"));
+				MU_LEAF_CHECK(render(*c));
+				MU_LEAF_CHECK(expect(renderer.m_stats.m_lists_cached == 4, "lists that were not evicted stay cached"));
+				return {};
+			}
+			catch (...)
+			{
+				return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+			}
+		} // namespace
+
+		auto run_checks() noexcept -> mu::leaf::result<void>
+		{
+			MU_LEAF_CHECK(check_damage_tracker());
+			MU_LEAF_CHECK(check_range_allocator());
+			MU_LEAF_CHECK(check_geometry_cache());
+
+			debug::logger()->stdout_logger()->info("all checks passed");
+			return {};
+		}
+	} // namespace bench
+} // namespace mu
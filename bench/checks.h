@@ -0,0 +1,13 @@
+#pragma once
+
+#include <mu_gfx.h>
+
+namespace mu
+{
+	namespace bench
+	{
+		// Deterministic checks of the CPU-only parts of the renderer, no device or ImGui context involved. Fails on the first
+		// check that does not hold, after logging it.
+		[[nodiscard]] auto run_checks() noexcept -> mu::leaf::result<void>;
+	} // namespace bench
+} // namespace mu
@@ -0,0 +1,353 @@
+#include <mu_gfx.h>
+
+#include "mu_diligent.h"
+#include "imgui_renderer.h"
+#include "render_context.h"
+#include "draw_capture.h"
+#include "synthetic_draw_data.h"
+#include "checks.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+
+static auto all_error_handlers = std::tuple_cat(mu::error_handlers, mu::only_gfx_error_handlers);
+
+struct bench_options
+{
+	mu::bench::synthetic_draw_data_desc m_desc;
+	int									m_frames	  = 1000;
+	bool								m_real_device = false;
+	bool								m_compact	  = false; // compact vertex format
+	const char*							m_capture	  = nullptr; // replay a draw capture instead of synthetic draw data
+	bool								m_check		  = false; // run the checks instead of benchmarking
+};
+
+// The frames to render, each a list of viewports. Synthetic draw data is a single frame with a single viewport.
+using bench_frames = std::vector<std::vector<ImDrawData*>>;
+
+// A decoded draw capture, with captured texture ids mapped onto the bench's textures in order of first use.
+struct bench_capture
+{
+	mu::draw_capture							   m_capture;
+	std::vector<mu::draw_capture_frame>			   m_frames;
+	std::unordered_map<std::uint64_t, ImTextureID> m_texture_map;
+
+	[[nodiscard]] auto load(const char* path, const std::vector<ImTextureID>& textures) noexcept -> mu::leaf::result<bench_frames>
+	try
+	{
+		MU_LEAF_CHECK(m_capture.open(path));
+
+		auto resolve = [&](std::uint64_t captured) -> ImTextureID
+		{
+			auto [itor, inserted] = m_texture_map.try_emplace(captured, ImTextureID{});
+			if (inserted && !textures.empty())
+			{
+				itor->second = textures[(m_texture_map.size() - 1) % textures.size()];
+			}
+			return itor->second;
+		};
+
+		bench_frames frames;
+		m_frames.resize(m_capture.frame_count());
+		for (std::size_t n = 0; n < m_frames.size(); ++n)
+		{
+			MU_LEAF_CHECK(m_capture.decode(n, resolve, m_frames[n]));
+
+			auto& frame = frames.emplace_back();
+			for (auto& viewport : m_frames[n].m_viewports)
+			{
+				frame.push_back(&viewport.m_draw_data);
+			}
+		}
+
+		if (frames.empty()) [[unlikely]]
+		{
+			return MU_LEAF_NEW_ERROR(mu::gfx_error::not_specified{});
+		}
+		return frames;
+	}
+	catch (...)
+	{
+		return MU_LEAF_NEW_ERROR(mu::gfx_error::not_specified{});
+	}
+};
+
+static auto parse_options(int argc, char** argv) -> bench_options
+{
+	bench_options options;
+	for (int n = 1; n < argc; ++n)
+	{
+		std::string_view arg(argv[n]);
+		auto			 value_of = [&](std::string_view key) -> const char*
+		{
+			return (arg.size() > key.size() && arg.substr(0, key.size()) == key) ? argv[n] + key.size() : nullptr;
+		};
+
+		if (auto v = value_of("--lists="))
+			options.m_desc.m_lists = std::atoi(v);
+		else if (auto v = value_of("--cmds="))
+			options.m_desc.m_cmds_per_list = std::atoi(v);
+		else if (auto v = value_of("--verts="))
+			options.m_desc.m_verts_per_cmd = std::atoi(v);
+		else if (auto v = value_of("--textures="))
+			options.m_desc.m_textures = std::atoi(v);
+		else if (auto v = value_of("--clip-churn="))
+			options.m_desc.m_clip_churn = static_cast<float>(std::atof(v));
+		else if (auto v = value_of("--callbacks="))
+			options.m_desc.m_callbacks_per_list = std::atoi(v);
+		else if (auto v = value_of("--frames="))
+			options.m_frames = std::atoi(v);
+		else if (auto v = value_of("--capture="))
+			options.m_capture = v;
+		else if (arg == "--device")
+			options.m_real_device = true;
+		else if (arg == "--compact")
+			options.m_compact = true;
+		else if (arg == "--check")
+			options.m_check = true;
+	}
+	return options;
+}
+
+static auto run_renderer(
+	const char*					 label,
+	const bench_options&		 options,
+	Diligent::imgui_renderer&	 renderer,
+	mu::counting_render_context& ctx,
+	const bench_frames&			 frames,
+	Diligent::ITextureView*		 rtv,
+	Diligent::ITextureView*		 dsv) noexcept -> mu::leaf::result<void>
+{
+	auto render_frame = [&](const std::vector<ImDrawData*>& viewports, std::uint64_t& bytes_uploaded, std::uint64_t& lists_uploaded) -> mu::leaf::result<void>
+	{
+		for (ImDrawData* draw_data : viewports)
+		{
+			if (rtv)
+			{
+				ctx.set_render_target(rtv, dsv);
+			}
+			MU_LEAF_CHECK(renderer.render_draw_data(
+				Diligent::SURFACE_TRANSFORM_IDENTITY,
+				static_cast<Diligent::Uint32>(draw_data->DisplaySize.x),
+				static_cast<Diligent::Uint32>(draw_data->DisplaySize.y),
+				&ctx,
+				draw_data));
+			bytes_uploaded += renderer.m_stats.m_bytes_uploaded;
+			lists_uploaded += renderer.m_stats.m_lists_uploaded;
+		}
+		return {};
+	};
+
+	// Warm up, so buffer growth is not part of the measurement
+	std::uint64_t bytes_uploaded = 0;
+	std::uint64_t lists_uploaded = 0;
+	for (const auto& frame : frames)
+	{
+		MU_LEAF_CHECK(render_frame(frame, bytes_uploaded, lists_uploaded));
+	}
+	ctx.reset();
+
+	bytes_uploaded	 = 0;
+	lists_uploaded	 = 0;
+	const auto begin = std::chrono::steady_clock::now();
+	for (int frame = 0; frame < options.m_frames; ++frame)
+	{
+		MU_LEAF_CHECK(render_frame(frames[static_cast<std::size_t>(frame) % frames.size()], bytes_uploaded, lists_uploaded));
+	}
+	const auto end = std::chrono::steady_clock::now();
+
+	const auto frame_count = static_cast<double>(std::max(1, options.m_frames));
+	const auto draws	   = static_cast<double>(
+		  std::max<std::uint64_t>(1, ctx.calls(mu::counting_render_context::call::draw_indexed) + ctx.calls(mu::counting_render_context::call::draw)));
+	const auto elapsed_ns  = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+
+	mu::debug::logger()->stdout_logger()->info(
+		"{0}: {1:.1f} ns/draw, {2:.1f} us/frame, {3:.0f} draws/frame, {4:.0f} bytes uploaded/frame, {5:.1f} lists uploaded/frame, {6:.0f} state calls/frame, "
+		"{7:.0f} texture commits/frame",
+		label,
+		elapsed_ns / draws,
+		elapsed_ns / frame_count / 1000.0,
+		draws / frame_count,
+		static_cast<double>(bytes_uploaded) / frame_count,
+		static_cast<double>(lists_uploaded) / frame_count,
+		static_cast<double>(ctx.state_calls()) / frame_count,
+		static_cast<double>(ctx.calls(mu::counting_render_context::call::commit_texture)) / frame_count);
+
+	return {};
+}
+
+static auto run_null_device(const bench_options& options) noexcept -> mu::leaf::result<void>
+try
+{
+	// Texture ids are opaque to a null context, any distinct non-null value will do
+	std::vector<ImTextureID> textures;
+	for (int n = 0; n < options.m_desc.m_textures; ++n)
+	{
+		textures.push_back(reinterpret_cast<ImTextureID>(static_cast<std::uintptr_t>(n + 1) * 16));
+	}
+
+	mu::bench::synthetic_draw_data data(options.m_desc, textures);
+	bench_capture				   capture;
+	bench_frames				   frames{{&data.m_draw_data}};
+	if (options.m_capture)
+	{
+		MU_LEAF_AUTO(captured_frames, capture.load(options.m_capture, textures));
+		frames = std::move(captured_frames);
+	}
+
+	auto shared_resources = std::make_shared<Diligent::imgui_shared_resources>(nullptr, Diligent::TEX_FORMAT_UNKNOWN, Diligent::TEX_FORMAT_UNKNOWN, options.m_compact);
+	Diligent::imgui_renderer	renderer(shared_resources, 1024 * 1024, 1024 * 1024, 1.0f);
+	mu::counting_render_context ctx;
+
+	return run_renderer("null", options, renderer, ctx, frames, nullptr, nullptr);
+}
+catch (...)
+{
+	return MU_LEAF_NEW_ERROR(mu::gfx_error::not_specified{});
+}
+
+static auto run_real_device(const bench_options& options) noexcept -> mu::leaf::result<void>
+try
+{
+	auto imgui_context = std::shared_ptr<ImGuiContext>(ImGui::CreateContext(), ImGui::DestroyContext);
+	ImGui::SetCurrentContext(imgui_context.get());
+
+	auto globals = std::make_shared<mu::diligent_globals>();
+
+	const auto color_fmt = Diligent::TEX_FORMAT_RGBA8_UNORM_SRGB;
+	const auto depth_fmt = Diligent::TEX_FORMAT_D32_FLOAT;
+
+	auto shared_resources = std::make_shared<Diligent::imgui_shared_resources>(globals->m_device, color_fmt, depth_fmt, options.m_compact);
+	MU_LEAF_CHECK(shared_resources->create_device_objects(true));
+
+	std::vector<Diligent::RefCntAutoPtr<Diligent::ITexture>> texture_objects;
+	std::vector<ImTextureID>								 textures;
+	for (int n = 0; n < options.m_desc.m_textures; ++n)
+	{
+		const Diligent::Uint32 white[16] = {
+			0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+			0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff};
+
+		Diligent::TextureDesc desc;
+		desc.Name	   = "Bench texture";
+		desc.Type	   = Diligent::RESOURCE_DIM_TEX_2D;
+		desc.Width	   = 4;
+		desc.Height	   = 4;
+		desc.Format	   = Diligent::TEX_FORMAT_RGBA8_UNORM;
+		desc.BindFlags = Diligent::BIND_SHADER_RESOURCE;
+		desc.Usage	   = Diligent::USAGE_IMMUTABLE;
+
+		Diligent::TextureSubResData mip_0_data[] = {{white, 4 * 4}};
+		Diligent::TextureData		init_data(mip_0_data, _countof(mip_0_data));
+
+		Diligent::RefCntAutoPtr<Diligent::ITexture> texture;
+		globals->m_device->CreateTexture(desc, &init_data, &texture);
+		textures.push_back(reinterpret_cast<ImTextureID>(texture->GetDefaultView(Diligent::TEXTURE_VIEW_SHADER_RESOURCE)));
+		texture_objects.push_back(texture);
+	}
+
+	mu::bench::synthetic_draw_data data(options.m_desc, textures);
+	bench_capture				   capture;
+	bench_frames				   frames{{&data.m_draw_data}};
+	if (options.m_capture)
+	{
+		MU_LEAF_AUTO(captured_frames, capture.load(options.m_capture, textures));
+		frames = std::move(captured_frames);
+	}
+
+	// Large enough for the biggest viewport of any frame
+	Diligent::Uint32 target_width  = 1;
+	Diligent::Uint32 target_height = 1;
+	for (const auto& frame : frames)
+	{
+		for (const ImDrawData* draw_data : frame)
+		{
+			target_width  = std::max(target_width, static_cast<Diligent::Uint32>(draw_data->DisplaySize.x));
+			target_height = std::max(target_height, static_cast<Diligent::Uint32>(draw_data->DisplaySize.y));
+		}
+	}
+
+	Diligent::RefCntAutoPtr<Diligent::ITexture> color_target;
+	Diligent::RefCntAutoPtr<Diligent::ITexture> depth_target;
+	{
+		Diligent::TextureDesc desc;
+		desc.Name	   = "Bench color target";
+		desc.Type	   = Diligent::RESOURCE_DIM_TEX_2D;
+		desc.Width	   = target_width;
+		desc.Height	   = target_height;
+		desc.Format	   = color_fmt;
+		desc.BindFlags = Diligent::BIND_RENDER_TARGET;
+		globals->m_device->CreateTexture(desc, nullptr, &color_target);
+
+		desc.Name	   = "Bench depth target";
+		desc.Format	   = depth_fmt;
+		desc.BindFlags = Diligent::BIND_DEPTH_STENCIL;
+		globals->m_device->CreateTexture(desc, nullptr, &depth_target);
+	}
+
+	Diligent::imgui_renderer		 renderer(shared_resources, 1024 * 1024, 1024 * 1024, 1.0f);
+	mu::diligent_render_context device_ctx(globals->m_immediate_context);
+	mu::counting_render_context ctx(&device_ctx);
+
+	MU_LEAF_CHECK(run_renderer(
+		"device",
+		options,
+		renderer,
+		ctx,
+		frames,
+		color_target->GetDefaultView(Diligent::TEXTURE_VIEW_RENDER_TARGET),
+		depth_target->GetDefaultView(Diligent::TEXTURE_VIEW_DEPTH_STENCIL)));
+
+	globals->m_immediate_context->Flush();
+	globals->m_immediate_context->WaitForIdle();
+	return {};
+}
+catch (...)
+{
+	return MU_LEAF_NEW_ERROR(mu::gfx_error::not_specified{});
+}
+
+auto main(int argc, char** argv) -> int
+{
+	if (auto app_error = [&]() -> mu::leaf::result<void>
+		{
+			const auto options = parse_options(argc, argv);
+			if (options.m_check)
+			{
+				return mu::bench::run_checks();
+			}
+
+			mu::debug::logger()->stdout_logger()->info(
+				"{0} lists x {1} cmds x {2} verts, {3} textures, clip churn {4}, {5} callbacks/list, {6} frames",
+				options.m_desc.m_lists,
+				options.m_desc.m_cmds_per_list,
+				options.m_desc.m_verts_per_cmd,
+				options.m_desc.m_textures,
+				options.m_desc.m_clip_churn,
+				options.m_desc.m_callbacks_per_list,
+				options.m_frames);
+
+			if (options.m_capture)
+			{
+				mu::debug::logger()->stdout_logger()->info("replaying draw capture {0}", options.m_capture);
+			}
+
+			MU_LEAF_CHECK(run_null_device(options));
+
+			if (options.m_real_device)
+			{
+				MU_LEAF_CHECK(run_real_device(options));
+			}
+
+			return {};
+		}();
+		!app_error) [[unlikely]]
+	{
+		return app_error.get_error_id().value();
+	}
+
+	return 0;
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace mu
+{
+	namespace bench
+	{
+		struct synthetic_draw_data_desc
+		{
+			int	  m_lists			   = 8;
+			int	  m_cmds_per_list	   = 64;
+			int	  m_verts_per_cmd	   = 64;
+			int	  m_textures		   = 4;
+			float m_clip_churn		   = 0.5f; // probability that a command gets a new clip rect instead of its predecessor's
+			int	  m_callbacks_per_list = 0;
+			float m_width			   = 1920.0f;
+			float m_height			   = 1080.0f;
+			int	  m_seed			   = 1;
+		};
+
+		inline std::uint32_t g_synthetic_callback_count = 0;
+
+		inline auto synthetic_callback(const ImDrawList*, const ImDrawCmd*) -> void
+		{
+			++g_synthetic_callback_count;
+		}
+
+		// Builds ImDrawLists directly, no ImGui context involved. Every command owns its own vertex range through VtxOffset,
+		// so any number of commands works with 16-bit indices; a command's own vertices are capped to what ImDrawIdx can index.
+		struct synthetic_draw_data
+		{
+			std::vector<std::unique_ptr<ImDrawList>> m_lists;
+			std::vector<ImDrawList*>				 m_list_ptrs;
+			ImDrawData								 m_draw_data;
+
+			synthetic_draw_data(const synthetic_draw_data_desc& desc, const std::vector<ImTextureID>& textures)
+			{
+				std::mt19937						  rng(desc.m_seed);
+				std::uniform_real_distribution<float> x_dist(0.0f, desc.m_width);
+				std::uniform_real_distribution<float> y_dist(0.0f, desc.m_height);
+				std::uniform_real_distribution<float> unit_dist(0.0f, 1.0f);
+
+				constexpr int s_max_verts_per_cmd = static_cast<int>(std::numeric_limits<ImDrawIdx>::max()) + 1;
+				const int	  verts_per_cmd		  = std::clamp(desc.m_verts_per_cmd, 3, s_max_verts_per_cmd);
+				const int	  callback_step		  = desc.m_callbacks_per_list > 0 ? std::max(1, desc.m_cmds_per_list / desc.m_callbacks_per_list) : 0;
+
+				int total_vtx = 0;
+				int total_idx = 0;
+				for (int list_n = 0; list_n < desc.m_lists; ++list_n)
+				{
+					auto list = std::make_unique<ImDrawList>(nullptr);
+
+					ImVec4 clip_rect(0.0f, 0.0f, desc.m_width, desc.m_height);
+					int	   texture_n = 0;
+					for (int cmd_n = 0; cmd_n < desc.m_cmds_per_list; ++cmd_n)
+					{
+						if (callback_step > 0 && (cmd_n % callback_step) == callback_step - 1)
+						{
+							ImDrawCmd callback_cmd;
+							callback_cmd.UserCallback = &synthetic_callback;
+							callback_cmd.ClipRect	  = clip_rect;
+							callback_cmd.IdxOffset	  = static_cast<unsigned int>(list->IdxBuffer.Size);
+							callback_cmd.VtxOffset	  = static_cast<unsigned int>(list->VtxBuffer.Size);
+							list->CmdBuffer.push_back(callback_cmd);
+						}
+
+						if (unit_dist(rng) < desc.m_clip_churn)
+						{
+							const float x0 = x_dist(rng), y0 = y_dist(rng);
+							clip_rect	   = ImVec4(x0, y0, std::min(desc.m_width, x0 + x_dist(rng) * 0.5f), std::min(desc.m_height, y0 + y_dist(rng) * 0.5f));
+						}
+
+						// Runs of 4 commands per texture, like text interleaved with images
+						if (!textures.empty() && (cmd_n % 4) == 0)
+						{
+							texture_n = (texture_n + 1) % static_cast<int>(textures.size());
+						}
+
+						ImDrawCmd cmd;
+						cmd.ClipRect  = clip_rect;
+						cmd.TextureId = textures.empty() ? ImTextureID{} : textures[texture_n];
+						cmd.VtxOffset = static_cast<unsigned int>(list->VtxBuffer.Size);
+						cmd.IdxOffset = static_cast<unsigned int>(list->IdxBuffer.Size);
+
+						for (int v = 0; v < verts_per_cmd; ++v)
+						{
+							ImDrawVert vert;
+							vert.pos = ImVec2(x_dist(rng), y_dist(rng));
+							vert.uv	 = ImVec2(unit_dist(rng), unit_dist(rng));
+							vert.col = static_cast<ImU32>(rng());
+							list->VtxBuffer.push_back(vert);
+						}
+
+						// A triangle fan over the command's vertex range
+						for (int v = 1; v + 1 < verts_per_cmd; ++v)
+						{
+							list->IdxBuffer.push_back(static_cast<ImDrawIdx>(0));
+							list->IdxBuffer.push_back(static_cast<ImDrawIdx>(v));
+							list->IdxBuffer.push_back(static_cast<ImDrawIdx>(v + 1));
+						}
+						cmd.ElemCount = static_cast<unsigned int>(list->IdxBuffer.Size) - cmd.IdxOffset;
+						list->CmdBuffer.push_back(cmd);
+					}
+
+					total_vtx += list->VtxBuffer.Size;
+					total_idx += list->IdxBuffer.Size;
+					m_list_ptrs.push_back(list.get());
+					m_lists.push_back(std::move(list));
+				}
+
+				m_draw_data.Valid			 = true;
+				m_draw_data.CmdLists		 = m_list_ptrs.data();
+				m_draw_data.CmdListsCount	 = static_cast<int>(m_list_ptrs.size());
+				m_draw_data.TotalVtxCount	 = total_vtx;
+				m_draw_data.TotalIdxCount	 = total_idx;
+				m_draw_data.DisplayPos		 = ImVec2(0.0f, 0.0f);
+				m_draw_data.DisplaySize		 = ImVec2(desc.m_width, desc.m_height);
+				m_draw_data.FramebufferScale = ImVec2(1.0f, 1.0f);
+			}
+
+			synthetic_draw_data(const synthetic_draw_data&)			   = delete;
+			synthetic_draw_data& operator=(const synthetic_draw_data&) = delete;
+		};
+	} // namespace bench
+} // namespace mu
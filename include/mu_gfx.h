@@ -5,6 +5,10 @@
 
 #include <imgui.h>
 
+#include <cstdint>
+#include <functional>
+#include <string>
+
 namespace mu
 {
 	struct gfx_error
@@ -31,6 +35,116 @@ namespace mu
 
 namespace mu
 {
+	// How a window's GPU work is scheduled relative to building its UI.
+	enum class gfx_frame_pipeline
+	{
+		immediate, // end_frame records and presents on the calling thread, taking turns with the submission thread
+		pipelined, // frame N is recorded and presented on the submission thread while frame N+1 is built, one frame of added latency
+		strict,	   // as pipelined, but end_frame waits for the submission thread, so no latency is added
+	};
+
+	// How swap chains follow window resizes. Sizes are rounded up to multiples of m_bucket and a swap chain that is large enough
+	// is only resized once the window size has been the same for m_stable_frames frames; until then the frame is rendered into its
+	// top-left corner. {1, 0} resizes to the exact size every time the size changes.
+	struct gfx_resize_policy
+	{
+		int m_bucket{128};
+		int m_stable_frames{8};
+	};
+
+	// Process-wide rendering options, applied when the render device is created, i.e. set them before opening the first window.
+	struct gfx_render_options
+	{
+		bool m_depth_buffer{true}; // the ImGui pipeline never tests depth, only user callbacks could need it
+		bool m_elide_clear{true};  // skip clearing when a viewport's first draw is an opaque rectangle covering it, e.g. a fullscreen dockspace
+
+		// Keep each window's image in an offscreen target and redraw only what changed since the previous frame, at the cost of
+		// that target and a copy to the back buffer per frame. Images whose pixels change under the same ImTextureID are not redrawn.
+		bool m_partial_redraw{false};
+
+		// Upload 12-byte vertices instead of ImDrawVert's 20: positions in quarter pixels and 16-bit texture coordinates. Geometry
+		// more than 8191 pixels from a viewport's corner and texture coordinates outside [0, 1], e.g. tiled images, are clamped.
+		bool m_compact_vertices{false};
+
+		// Build the font atlas once as signed distance fields and draw text of any size or DPI scale from it, instead of a bitmap
+		// atlas for each DPI scale windows are shown at. Glyph edges are slightly softer than a bitmap at its native size.
+		bool m_sdf_fonts{false};
+
+		// Keep the font atlas in a single channel texture instead of RGBA, a quarter of the memory and texture bandwidth, expanded
+		// to white with that alpha in the pixel shader. User textures are drawn as before. Coloured glyphs lose their colours.
+		bool m_alpha8_fonts{false};
+
+		// Path of a TTF/OTF font for the code points the font atlas does not cover, e.g. CJK. gfx_add_text rasterises its glyphs the
+		// first time they are drawn into pages that evict the least recently drawn ones, so only the glyphs in use take time and
+		// memory. ImGui's own text only draws what the atlas has.
+		std::string m_glyph_font;
+	};
+
+	// Memory held by the library, in bytes. GPU figures are the sizes of resources as created, before any padding by the driver.
+	// A window counts what it and its viewports own; the font atlases, their glyph caches and the constant buffer are shared by
+	// windows and only counted by gfx_interface::memory_stats. Textures the application creates are its own to count.
+	struct gfx_memory_stats
+	{
+		std::uint64_t m_swap_chains{0}; // colour buffers, every buffer of every viewport's swap chain
+		std::uint64_t m_depth_buffers{0};
+		std::uint64_t m_canvases{0};		 // see gfx_render_options::m_partial_redraw
+		std::uint64_t m_geometry_buffers{0}; // the renderers' vertex and index buffers
+		std::uint64_t m_constant_buffers{0};
+		std::uint64_t m_font_textures{0}; // the atlases and the glyph caches' pages
+		std::uint64_t m_imgui_heap{0};	  // what ImGui allocated: contexts, draw lists, the shared atlases' pixels when not windows'
+		std::uint64_t m_glyph_pixels{0};  // the glyph cache's copy of its pages
+
+		[[nodiscard]] auto gpu_bytes() const noexcept -> std::uint64_t
+		{
+			return m_swap_chains + m_depth_buffers + m_canvases + m_geometry_buffers + m_constant_buffers + m_font_textures;
+		}
+
+		[[nodiscard]] auto cpu_bytes() const noexcept -> std::uint64_t
+		{
+			return m_imgui_heap + m_glyph_pixels;
+		}
+
+		auto operator+=(const gfx_memory_stats& other) noexcept -> gfx_memory_stats&
+		{
+			m_swap_chains += other.m_swap_chains;
+			m_depth_buffers += other.m_depth_buffers;
+			m_canvases += other.m_canvases;
+			m_geometry_buffers += other.m_geometry_buffers;
+			m_constant_buffers += other.m_constant_buffers;
+			m_font_textures += other.m_font_textures;
+			m_imgui_heap += other.m_imgui_heap;
+			m_glyph_pixels += other.m_glyph_pixels;
+			return *this;
+		}
+	};
+
+	// Limits on a window's gfx_memory_stats, 0 for none, checked after each frame is recorded. Past one, the window gives back what
+	// can be rebuilt: renderer buffers shrink to what the last frame needed and the draw buffers of ImGui windows that were not
+	// shown are freed. Swap chains and canvases are what the window needs to draw and are never trimmed, nor is anything in use,
+	// so a window can stay over its budget. What windows share has a budget of its own, see gfx_interface::set_memory_budget.
+	struct gfx_memory_budget
+	{
+		std::uint64_t m_gpu_bytes{0};
+		std::uint64_t m_cpu_bytes{0};
+	};
+
+	// Rectangles, circles and text drawn as one instance each by the renderer's primitive pipeline, which evaluates rounded corners,
+	// outlines and antialiasing per pixel instead of tessellating them: two vertices per shape or glyph and no indices. They mirror
+	// the ImDrawList functions of the same name and must be called with the window's ImGui context current; where the renderer has
+	// no primitive pipeline (Metal) they call those functions instead. Rounding and thickness are kept in quarter pixels. Like
+	// ImDrawList::AddText, gfx_add_text draws with the draw list's current font when font is null and its size when font_size is 0.
+	auto gfx_add_rect(ImDrawList* draw_list, const ImVec2& p_min, const ImVec2& p_max, ImU32 col, float rounding = 0.0f, float thickness = 1.0f) noexcept -> void;
+	auto gfx_add_rect_filled(ImDrawList* draw_list, const ImVec2& p_min, const ImVec2& p_max, ImU32 col, float rounding = 0.0f) noexcept -> void;
+	auto gfx_add_circle(ImDrawList* draw_list, const ImVec2& center, float radius, ImU32 col, float thickness = 1.0f) noexcept -> void;
+	auto gfx_add_circle_filled(ImDrawList* draw_list, const ImVec2& center, float radius, ImU32 col) noexcept -> void;
+	auto gfx_add_text(ImDrawList* draw_list, ImFont* font, float font_size, const ImVec2& pos, ImU32 col, const char* text_begin, const char* text_end = nullptr) noexcept
+		-> void;
+
+	// The callback of a batch of primitives. In its command ElemCount is the number of primitives and VtxOffset the first of their
+	// vertices in VtxBuffer: each takes two, its top left and bottom right corners with their texture coordinates, the colour in the
+	// first and the rounding and thickness in the second's colour. Renderers that do not know it call it, which draws nothing.
+	auto gfx_primitives_callback(const ImDrawList* parent_list, const ImDrawCmd* cmd) -> void;
+
 	struct gfx_window : std::enable_shared_from_this<gfx_window>
 	{
 		std::shared_ptr<gfx_window> get_shared_ptr()
@@ -49,8 +163,41 @@ namespace mu
 		virtual [[nodiscard]] auto end_imgui_sync() noexcept -> mu::leaf::result<void>	  = 0;
 		virtual [[nodiscard]] auto end_frame() noexcept -> mu::leaf::result<void>		  = 0;
 		virtual [[nodiscard]] auto make_current() noexcept -> mu::leaf::result<void>	  = 0;
+
+		// Call between frames.
+		virtual [[nodiscard]] auto set_frame_pipeline(gfx_frame_pipeline pipeline) noexcept -> mu::leaf::result<void> = 0;
+
+		// Applies to the window and all of its viewports.
+		virtual [[nodiscard]] auto set_resize_policy(const gfx_resize_policy& policy) noexcept -> mu::leaf::result<void> = 0;
+
+		// What the window and its viewports hold, see gfx_memory_stats. Call between frames or from the window's own gfx_ui_callback;
+		// the calling thread's ImGui context and heap are left as they were.
+		virtual [[nodiscard]] auto memory_stats() noexcept -> mu::leaf::result<gfx_memory_stats>						 = 0;
+		virtual [[nodiscard]] auto set_memory_budget(const gfx_memory_budget& budget) noexcept -> mu::leaf::result<void> = 0;
+
+		// Records every render call issued for this window to path until end_command_recording, see src/command_log.h.
+		// Call between frames, i.e. not between begin_frame_async and end_frame.
+		virtual [[nodiscard]] auto begin_command_recording(const char* path) noexcept -> mu::leaf::result<void> = 0;
+		virtual [[nodiscard]] auto end_command_recording() noexcept -> mu::leaf::result<void>				 = 0;
+
+		// Appends the ImDrawData of every viewport to a memory-mapped capture file each frame until end_draw_capture, see src/draw_capture.h.
+		virtual [[nodiscard]] auto begin_draw_capture(const char* path) noexcept -> mu::leaf::result<void> = 0;
+		virtual [[nodiscard]] auto end_draw_capture() noexcept -> mu::leaf::result<void>				= 0;
+
+		// Records every input event of this window and its viewports, saved to path by end_input_recording.
+		virtual [[nodiscard]] auto begin_input_recording() noexcept -> mu::leaf::result<void>			 = 0;
+		virtual [[nodiscard]] auto end_input_recording(const char* path) noexcept -> mu::leaf::result<void> = 0;
+
+		// Replays a recording in place of live input, one recorded frame per frame with a fixed delta_time. Live input resumes once
+		// the recording is exhausted, which is_replaying_input reports.
+		virtual [[nodiscard]] auto begin_input_replay(const char* path, float delta_time = 1.0f / 60.0f) noexcept -> mu::leaf::result<void> = 0;
+		virtual [[nodiscard]] auto is_replaying_input() noexcept -> mu::leaf::result<bool>											  = 0;
 	};
 
+	// Builds a window's UI for gfx_interface::run_frame, with its ImGui context current. With MU_GFX_THREAD_LOCAL_IMGUI it is
+	// called for several windows at once, on executor's workers.
+	using gfx_ui_callback = std::function<mu::leaf::result<void>(const std::shared_ptr<gfx_window>& window)>;
+
 	namespace details
 	{
 		struct gfx_interface
@@ -62,6 +209,23 @@ namespace mu
 			virtual [[nodiscard]] auto pump() noexcept -> mu::leaf::result<void>																	   = 0;
 			virtual [[nodiscard]] auto present() noexcept -> mu::leaf::result<void>																	   = 0;
 
+			// Fails while a window still holds the render device.
+			virtual [[nodiscard]] auto set_render_options(const gfx_render_options& options) noexcept -> mu::leaf::result<void> = 0;
+
+			// Every window's memory_stats and what they share. Call between frames, or from a gfx_ui_callback unless built with
+			// MU_GFX_THREAD_LOCAL_IMGUI, where the other windows are in the middle of their frames on other threads.
+			virtual [[nodiscard]] auto memory_stats() noexcept -> mu::leaf::result<gfx_memory_stats> = 0;
+
+			// Limits on what windows share, i.e. memory_stats less every window's, checked by present. Past one, the glyph caches free
+			// their pages not drawn lately. The font atlases and the constant buffer are always in use.
+			virtual [[nodiscard]] auto set_memory_budget(const gfx_memory_budget& budget) noexcept -> mu::leaf::result<void> = 0;
+
+			// One frame of every open window, in the order they were opened: pumps events, runs each window's stages from
+			// begin_frame_async to end_frame, the UI and the stages after it on executor with MU_GFX_THREAD_LOCAL_IMGUI, and presents,
+			// see src/frame_graph.h. The task graphs are kept from frame to frame and only built again when windows were opened or
+			// closed. Fails with the first error of the first window that failed, still presenting. Instead of do_frame, not within it.
+			virtual [[nodiscard]] auto run_frame(tf::Executor& executor, const gfx_ui_callback& ui) noexcept -> mu::leaf::result<void> = 0;
+
 			template<typename T_FUNC>
 			[[nodiscard]] auto do_frame(T_FUNC func) noexcept -> mu::leaf::result<void>
 			{
@@ -0,0 +1,11 @@
+#pragma once
+
+// ImGui user config for MU_GFX_THREAD_LOCAL_IMGUI builds, selected through IMGUI_USER_CONFIG.
+//
+// Makes the current ImGui context a per-thread binding instead of a process global, so every window's gfx_application_state
+// can be current on a different thread at the same time. The imgui library itself must be compiled with the same
+// IMGUI_USER_CONFIG, otherwise imgui.cpp keeps its own global GImGui and the two disagree.
+
+struct ImGuiContext;
+extern thread_local ImGuiContext* mu_gfx_imgui_context;
+#define GImGui mu_gfx_imgui_context
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <mu_gfx.h>
+
+#include <cstdint>
+
+// Frame stage tracing.
+//
+// Spans are recorded with MU_GFX_TRACE_SCOPE into per-thread buffers and exported as Chrome trace JSON
+// (chrome://tracing, ui.perfetto.dev). Everything compiles away unless MU_GFX_ENABLE_TRACING is defined,
+// which the MU_GFX_ENABLE_TRACING CMake option does for mu_gfx and its consumers.
+
+#define MU_GFX_TRACE_CONCAT_IMPL(a, b) a##b
+#define MU_GFX_TRACE_CONCAT(a, b)	   MU_GFX_TRACE_CONCAT_IMPL(a, b)
+
+#if defined(MU_GFX_ENABLE_TRACING)
+
+namespace mu
+{
+	namespace gfx_trace
+	{
+		[[nodiscard]] auto now_ns() noexcept -> std::uint64_t;
+
+		// name must outlive the trace; string literals are the intended use.
+		auto record(const char* name, std::uint64_t begin_ns, std::uint64_t end_ns) noexcept -> void;
+
+		auto set_thread_name(const char* name) noexcept -> void;
+
+		// Drops every recorded span; only call while no other thread is recording.
+		auto clear() noexcept -> void;
+
+		// Safe while other threads record; spans they overwrite during the export are left out.
+		[[nodiscard]] auto write_chrome_trace(const char* path) noexcept -> mu::leaf::result<void>;
+
+		struct scope
+		{
+			const char*	  m_name;
+			std::uint64_t m_begin_ns;
+
+			explicit scope(const char* name) noexcept : m_name(name), m_begin_ns(now_ns()) { }
+
+			~scope()
+			{
+				record(m_name, m_begin_ns, now_ns());
+			}
+
+			scope(const scope&)			   = delete;
+			scope& operator=(const scope&) = delete;
+		};
+
+		// Records one span per executed taskflow task, named after the task.
+		struct executor_observer : public tf::ObserverInterface
+		{
+			executor_observer() = default;
+			virtual ~executor_observer();
+
+			virtual auto set_up(size_t num_workers) -> void override final;
+			virtual auto on_entry(tf::WorkerView wv, tf::TaskView tv) -> void override final;
+			virtual auto on_exit(tf::WorkerView wv, tf::TaskView tv) -> void override final;
+
+			std::vector<std::uint64_t> m_begin_ns;
+		};
+	} // namespace gfx_trace
+} // namespace mu
+
+#define MU_GFX_TRACE_SCOPE(name)		   ::mu::gfx_trace::scope MU_GFX_TRACE_CONCAT(mu_gfx_trace_scope_, __LINE__)(name)
+#define MU_GFX_TRACE_THREAD_NAME(name)	   ::mu::gfx_trace::set_thread_name(name)
+#define MU_GFX_TRACE_EXECUTOR(executor)	   (executor).make_observer<::mu::gfx_trace::executor_observer>()
+
+#else // #if defined(MU_GFX_ENABLE_TRACING)
+
+namespace mu
+{
+	namespace gfx_trace
+	{
+		inline auto clear() noexcept -> void { }
+
+		[[nodiscard]] inline auto write_chrome_trace(const char*) noexcept -> mu::leaf::result<void>
+		{
+			return {};
+		}
+	} // namespace gfx_trace
+} // namespace mu
+
+#define MU_GFX_TRACE_SCOPE(name)
+#define MU_GFX_TRACE_THREAD_NAME(name)
+#define MU_GFX_TRACE_EXECUTOR(executor)
+
+#endif // #else // #if defined(MU_GFX_ENABLE_TRACING)
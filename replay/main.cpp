@@ -0,0 +1,136 @@
+#include <mu_gfx.h>
+
+#include "mu_diligent.h"
+#include "imgui_renderer.h"
+#include "command_log.h"
+#include "render_context.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <string_view>
+
+static auto all_error_handlers = std::tuple_cat(mu::error_handlers, mu::only_gfx_error_handlers);
+
+struct replay_options
+{
+	const char* m_path		  = nullptr;
+	int			m_loops		  = 100;
+	bool		m_real_device = false;
+};
+
+static auto parse_options(int argc, char** argv) -> replay_options
+{
+	replay_options options;
+	for (int n = 1; n < argc; ++n)
+	{
+		std::string_view arg(argv[n]);
+		if (arg.size() > 8 && arg.substr(0, 8) == "--loops=")
+			options.m_loops = std::atoi(argv[n] + 8);
+		else if (arg == "--device")
+			options.m_real_device = true;
+		else
+			options.m_path = argv[n];
+	}
+	return options;
+}
+
+static auto run_player(const char* label, const replay_options& options, mu::command_log_player& player, mu::counting_render_context& ctx) noexcept
+	-> mu::leaf::result<void>
+{
+	// Warm up, so buffer and target creation in the driver is not part of the measurement
+	mu::command_log_replay_stats stats;
+	MU_LEAF_CHECK(player.play(&ctx, stats));
+	ctx.reset();
+	stats = {};
+
+	const auto begin = std::chrono::steady_clock::now();
+	for (int loop = 0; loop < options.m_loops; ++loop)
+	{
+		MU_LEAF_CHECK(player.play(&ctx, stats));
+	}
+	const auto end = std::chrono::steady_clock::now();
+
+	const auto frames	  = static_cast<double>(std::max<std::uint64_t>(1, stats.m_frames));
+	const auto elapsed_ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+
+	mu::debug::logger()->stdout_logger()->info(
+		"{0}: {1:.1f} us/frame, {2:.0f} commands/frame, {3:.0f} draws/frame, {4:.0f} state calls/frame, {5:.0f} bytes uploaded/frame",
+		label,
+		elapsed_ns / frames / 1000.0,
+		static_cast<double>(stats.m_commands) / frames,
+		static_cast<double>(ctx.calls(mu::counting_render_context::call::draw_indexed) + ctx.calls(mu::counting_render_context::call::draw)) / frames,
+		static_cast<double>(ctx.state_calls()) / frames,
+		static_cast<double>(stats.m_bytes_uploaded) / frames);
+
+	return {};
+}
+
+static auto run_null_device(const replay_options& options, std::shared_ptr<mu::command_log> log) noexcept -> mu::leaf::result<void>
+try
+{
+	mu::command_log_player		player(log, nullptr);
+	mu::counting_render_context ctx;
+	return run_player("null", options, player, ctx);
+}
+catch (...)
+{
+	return MU_LEAF_NEW_ERROR(mu::gfx_error::not_specified{});
+}
+
+static auto run_real_device(const replay_options& options, std::shared_ptr<mu::command_log> log) noexcept -> mu::leaf::result<void>
+try
+{
+	auto imgui_context = std::shared_ptr<ImGuiContext>(ImGui::CreateContext(), ImGui::DestroyContext);
+	ImGui::SetCurrentContext(imgui_context.get());
+
+	auto globals = std::make_shared<mu::diligent_globals>();
+
+	mu::command_log_player		player(log, globals->m_device);
+	mu::diligent_render_context device_ctx(globals->m_immediate_context);
+	mu::counting_render_context ctx(&device_ctx);
+	MU_LEAF_CHECK(run_player("device", options, player, ctx));
+
+	globals->m_immediate_context->Flush();
+	globals->m_immediate_context->WaitForIdle();
+	return {};
+}
+catch (...)
+{
+	return MU_LEAF_NEW_ERROR(mu::gfx_error::not_specified{});
+}
+
+auto main(int argc, char** argv) -> int
+{
+	if (auto app_error = [&]() -> mu::leaf::result<void>
+		{
+			const auto options = parse_options(argc, argv);
+			if (options.m_path == nullptr) [[unlikely]]
+			{
+				return MU_LEAF_NEW_ERROR(mu::gfx_error::not_specified{});
+			}
+
+			MU_LEAF_AUTO(log, mu::command_log::load(options.m_path));
+			mu::debug::logger()->stdout_logger()->info(
+				"{0}: {1} frames, {2} objects, {3} bytes, {4} loops",
+				options.m_path,
+				log->m_frames,
+				log->m_objects.size(),
+				log->m_stream.size(),
+				options.m_loops);
+
+			MU_LEAF_CHECK(run_null_device(options, log));
+
+			if (options.m_real_device)
+			{
+				MU_LEAF_CHECK(run_real_device(options, log));
+			}
+
+			return {};
+		}();
+		!app_error) [[unlikely]]
+	{
+		return app_error.get_error_id().value();
+	}
+
+	return 0;
+}
@@ -0,0 +1,566 @@
+#include "mu_gfx_impl.h"
+
+#include "command_log.h"
+#include "imgui_renderer.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace mu
+{
+	namespace
+	{
+		struct command_log_reader
+		{
+			const std::byte* m_data;
+			std::size_t		 m_size;
+			std::size_t		 m_pos{0};
+
+			[[nodiscard]] auto at_end() const noexcept -> bool
+			{
+				return m_pos >= m_size;
+			}
+
+			template<typename T>
+			[[nodiscard]] auto read(T& value) noexcept -> bool
+			{
+				static_assert(std::is_trivially_copyable_v<T>);
+				if (m_size - m_pos < sizeof(T)) [[unlikely]]
+				{
+					return false;
+				}
+				std::memcpy(&value, m_data + m_pos, sizeof(T));
+				m_pos += sizeof(T);
+				return true;
+			}
+
+			[[nodiscard]] auto skip(std::size_t size) noexcept -> const std::byte*
+			{
+				if (m_size - m_pos < size) [[unlikely]]
+				{
+					return nullptr;
+				}
+				auto data = m_data + m_pos;
+				m_pos += size;
+				return data;
+			}
+		};
+
+		// Size of each record's payload, except unmap_buffer, update_buffer and update_texture which carry a variable amount of data.
+		constexpr auto fixed_payload_size(command_log_op op) noexcept -> std::size_t
+		{
+			switch (op)
+			{
+			case command_log_op::declare_object:
+				return sizeof(command_log_object_desc);
+			case command_log_op::map_buffer:
+				return 4 * sizeof(std::uint32_t);
+			case command_log_op::unmap_buffer:
+			case command_log_op::update_buffer:
+				return 3 * sizeof(std::uint32_t);
+			case command_log_op::set_vertex_buffer:
+			case command_log_op::set_index_buffer:
+				return 2 * sizeof(std::uint32_t);
+			case command_log_op::set_pipeline_state:
+				return sizeof(std::uint32_t);
+			case command_log_op::set_blend_factors:
+				return 4 * sizeof(float);
+			case command_log_op::set_viewport:
+				return sizeof(Diligent::Viewport) + 2 * sizeof(std::uint32_t);
+			case command_log_op::set_scissor_rect:
+				return sizeof(Diligent::Rect) + 2 * sizeof(std::uint32_t);
+			case command_log_op::commit_texture:
+			case command_log_op::set_render_target:
+			case command_log_op::present:
+			case command_log_op::copy_texture:
+				return 2 * sizeof(std::uint32_t);
+			case command_log_op::draw_indexed:
+			case command_log_op::draw:
+				return sizeof(command_log_draw);
+			case command_log_op::clear_render_target:
+				return sizeof(std::uint32_t) + 4 * sizeof(float);
+			case command_log_op::clear_depth:
+				return sizeof(std::uint32_t) + sizeof(float);
+			case command_log_op::update_texture:
+				return 7 * sizeof(std::uint32_t);
+			case command_log_op::copy_buffer:
+				return 5 * sizeof(std::uint32_t);
+			}
+			return 0;
+		}
+	} // namespace
+
+	auto command_log::load(const char* path) noexcept -> leaf::result<std::shared_ptr<command_log>>
+	try
+	{
+		auto file = std::unique_ptr<std::FILE, int (*)(std::FILE*)>(std::fopen(path, "rb"), &std::fclose);
+		if (!file) [[unlikely]]
+		{
+			return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+		}
+
+		command_log_header header;
+		command_log_header expected;
+		if (std::fread(&header, sizeof(header), 1, file.get()) != 1 || std::memcmp(header.m_magic, expected.m_magic, sizeof(header.m_magic)) != 0 ||
+			header.m_version != expected.m_version) [[unlikely]]
+		{
+			return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+		}
+
+		auto log = std::make_shared<command_log>();
+
+		std::byte chunk[64 * 1024];
+		while (auto n = std::fread(chunk, 1, sizeof(chunk), file.get()))
+		{
+			log->m_stream.insert(log->m_stream.end(), chunk, chunk + n);
+		}
+
+		// Validate the whole stream once and collect object declarations, so play() can trust it.
+		command_log_reader reader{log->m_stream.data(), log->m_stream.size()};
+		while (!reader.at_end())
+		{
+			command_log_op op;
+			if (!reader.read(op) || op > command_log_op::update_texture) [[unlikely]]
+			{
+				return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+			}
+
+			if (op == command_log_op::declare_object)
+			{
+				command_log_object_desc desc;
+				if (!reader.read(desc) || desc.m_id != log->m_objects.size() + 1) [[unlikely]]
+				{
+					return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+				}
+				log->m_objects.push_back(desc);
+				continue;
+			}
+
+			const auto payload = reader.skip(fixed_payload_size(op));
+			if (payload == nullptr) [[unlikely]]
+			{
+				return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+			}
+
+			if (op == command_log_op::unmap_buffer || op == command_log_op::update_buffer || op == command_log_op::update_texture)
+			{
+				std::uint32_t size;
+				std::memcpy(&size, payload + fixed_payload_size(op) - sizeof(size), sizeof(size));
+				if (reader.skip(size) == nullptr) [[unlikely]]
+				{
+					return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+				}
+			}
+			else if (op == command_log_op::present)
+			{
+				++log->m_frames;
+			}
+		}
+
+		return log;
+	}
+	catch (...)
+	{
+		return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+	}
+
+	command_log_player::command_log_player(std::shared_ptr<command_log> log, Diligent::IRenderDevice* device) : m_log(std::move(log)), m_device(device)
+	{
+		const auto object_count = m_log->m_objects.size() + 1;
+		m_buffers.resize(object_count);
+		m_views.resize(object_count);
+		m_mapped.resize(object_count, nullptr);
+
+		auto rtv_format = Diligent::TEX_FORMAT_UNKNOWN;
+		auto dsv_format = Diligent::TEX_FORMAT_UNKNOWN;
+		bool compact	= false;
+		for (const auto& desc : m_log->m_objects)
+		{
+			compact |= desc.m_kind == command_log_object::pipeline_state && desc.m_format == Diligent::VT_INT16;
+
+			if (desc.m_kind == command_log_object::texture_view)
+			{
+				if (desc.m_view_type == Diligent::TEXTURE_VIEW_RENDER_TARGET && rtv_format == Diligent::TEX_FORMAT_UNKNOWN)
+				{
+					rtv_format = static_cast<Diligent::TEXTURE_FORMAT>(desc.m_format);
+				}
+				else if (desc.m_view_type == Diligent::TEXTURE_VIEW_DEPTH_STENCIL && dsv_format == Diligent::TEX_FORMAT_UNKNOWN)
+				{
+					dsv_format = static_cast<Diligent::TEXTURE_FORMAT>(desc.m_format);
+				}
+			}
+		}
+
+		m_shared_resources = std::make_shared<Diligent::imgui_shared_resources>(m_device, rtv_format, dsv_format, compact);
+		m_font_resources   = std::make_shared<Diligent::imgui_font_resources>(m_device);
+		if (!m_device)
+		{
+			return;
+		}
+
+		// The font texture stands in for every recorded shader resource.
+		MU_LEAF_RETHROW(m_shared_resources->create_device_objects(true));
+		MU_LEAF_RETHROW(m_font_resources->create_fonts_texture(1.0f, true));
+
+		for (const auto& desc : m_log->m_objects)
+		{
+			switch (desc.m_kind)
+			{
+			case command_log_object::buffer:
+			{
+				Diligent::BufferDesc buffer_desc;
+				buffer_desc.Name		   = "Replay buffer";
+				buffer_desc.uiSizeInBytes  = desc.m_size;
+				buffer_desc.BindFlags	   = static_cast<Diligent::BIND_FLAGS>(desc.m_bind);
+				buffer_desc.Usage		   = desc.m_usage == Diligent::USAGE_DEFAULT ? Diligent::USAGE_DEFAULT : Diligent::USAGE_DYNAMIC;
+				buffer_desc.CPUAccessFlags = buffer_desc.Usage == Diligent::USAGE_DYNAMIC ? Diligent::CPU_ACCESS_WRITE : Diligent::CPU_ACCESS_NONE;
+				m_device->CreateBuffer(buffer_desc, nullptr, &m_buffers[desc.m_id]);
+				break;
+			}
+
+			case command_log_object::texture_view:
+			{
+				if (desc.m_view_type == Diligent::TEXTURE_VIEW_RENDER_TARGET || desc.m_view_type == Diligent::TEXTURE_VIEW_DEPTH_STENCIL)
+				{
+					const bool is_rtv = desc.m_view_type == Diligent::TEXTURE_VIEW_RENDER_TARGET;
+
+					Diligent::TextureDesc texture_desc;
+					texture_desc.Name	   = is_rtv ? "Replay render target" : "Replay depth target";
+					texture_desc.Type	   = Diligent::RESOURCE_DIM_TEX_2D;
+					texture_desc.Width	   = std::max(1u, desc.m_width);
+					texture_desc.Height	   = std::max(1u, desc.m_height);
+					texture_desc.Format	   = static_cast<Diligent::TEXTURE_FORMAT>(desc.m_format);
+					texture_desc.BindFlags = is_rtv ? Diligent::BIND_RENDER_TARGET : Diligent::BIND_DEPTH_STENCIL;
+
+					Diligent::RefCntAutoPtr<Diligent::ITexture> texture;
+					m_device->CreateTexture(texture_desc, nullptr, &texture);
+					m_views[desc.m_id] = texture->GetDefaultView(is_rtv ? Diligent::TEXTURE_VIEW_RENDER_TARGET : Diligent::TEXTURE_VIEW_DEPTH_STENCIL);
+					m_textures.push_back(texture);
+				}
+				else
+				{
+					m_views[desc.m_id] = m_font_resources->m_font_srv;
+				}
+				break;
+			}
+
+			default:
+				break;
+			}
+		}
+	}
+
+	command_log_player::~command_log_player() = default;
+
+	auto command_log_player::play(render_context* ctx, command_log_replay_stats& stats) noexcept -> leaf::result<void>
+	try
+	{
+		const auto& objects = m_log->m_objects;
+		auto		valid	= [&](std::uint32_t id) -> bool
+		{
+			return id <= objects.size();
+		};
+
+		// Textures are committed through the SRB of the pipeline set last
+		bool primitives = false;
+
+		command_log_reader reader{m_log->m_stream.data(), m_log->m_stream.size()};
+		while (!reader.at_end())
+		{
+			command_log_op op;
+			if (!reader.read(op)) [[unlikely]]
+			{
+				return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+			}
+			++stats.m_commands;
+
+			switch (op)
+			{
+			case command_log_op::declare_object:
+			{
+				command_log_object_desc desc;
+				if (!reader.read(desc)) [[unlikely]]
+				{
+					return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+				}
+				--stats.m_commands;
+				break;
+			}
+
+			case command_log_op::map_buffer:
+			{
+				std::uint32_t id, size, map_type, map_flags;
+				if (!(reader.read(id) && reader.read(size) && reader.read(map_type) && reader.read(map_flags) && valid(id))) [[unlikely]]
+				{
+					return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+				}
+				m_mapped[id] = ctx->map_buffer(m_buffers[id], size, static_cast<Diligent::MAP_TYPE>(map_type), static_cast<Diligent::MAP_FLAGS>(map_flags));
+				break;
+			}
+
+			case command_log_op::unmap_buffer:
+			{
+				std::uint32_t id, map_type, size;
+				if (!(reader.read(id) && reader.read(map_type) && reader.read(size) && valid(id))) [[unlikely]]
+				{
+					return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+				}
+				const auto payload = reader.skip(size);
+				if (payload == nullptr) [[unlikely]]
+				{
+					return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+				}
+				if (m_mapped[id] != nullptr)
+				{
+					std::memcpy(m_mapped[id], payload, size);
+					m_mapped[id] = nullptr;
+				}
+				ctx->unmap_buffer(m_buffers[id], static_cast<Diligent::MAP_TYPE>(map_type));
+				stats.m_bytes_uploaded += size;
+				break;
+			}
+
+			case command_log_op::update_buffer:
+			{
+				std::uint32_t id, offset, size;
+				if (!(reader.read(id) && reader.read(offset) && reader.read(size) && valid(id))) [[unlikely]]
+				{
+					return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+				}
+				const auto payload = reader.skip(size);
+				if (payload == nullptr) [[unlikely]]
+				{
+					return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+				}
+				ctx->update_buffer(m_buffers[id], offset, size, payload);
+				stats.m_bytes_uploaded += size;
+				break;
+			}
+
+			case command_log_op::copy_buffer:
+			{
+				std::uint32_t src_id, src_offset, dst_id, dst_offset, size;
+				if (!(reader.read(src_id) && reader.read(src_offset) && reader.read(dst_id) && reader.read(dst_offset) && reader.read(size) && valid(src_id) &&
+					  valid(dst_id))) [[unlikely]]
+				{
+					return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+				}
+				ctx->copy_buffer(m_buffers[src_id], src_offset, m_buffers[dst_id], dst_offset, size);
+				break;
+			}
+
+			case command_log_op::update_texture:
+			{
+				std::uint32_t id, min_x, max_x, min_y, max_y, stride, size;
+				if (!(reader.read(id) && reader.read(min_x) && reader.read(max_x) && reader.read(min_y) && reader.read(max_y) && reader.read(stride) &&
+					  reader.read(size) && valid(id) && reader.skip(size) != nullptr)) [[unlikely]]
+				{
+					return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+				}
+
+				// Recorded textures are all the immutable font placeholder, their uploads are only accounted for
+				stats.m_bytes_uploaded += size;
+				break;
+			}
+
+			case command_log_op::set_vertex_buffer:
+			case command_log_op::set_index_buffer:
+			{
+				std::uint32_t id, offset;
+				if (!(reader.read(id) && reader.read(offset) && valid(id))) [[unlikely]]
+				{
+					return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+				}
+				if (op == command_log_op::set_vertex_buffer)
+				{
+					ctx->set_vertex_buffer(m_buffers[id], offset);
+				}
+				else
+				{
+					ctx->set_index_buffer(m_buffers[id], offset);
+				}
+				break;
+			}
+
+			case command_log_op::set_pipeline_state:
+			{
+				std::uint32_t id;
+				if (!reader.read(id)) [[unlikely]]
+				{
+					return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+				}
+				primitives = id != 0 && valid(id) && objects[id - 1].m_view_type == Diligent::INPUT_ELEMENT_FREQUENCY_PER_INSTANCE;
+				ctx->set_pipeline_state(primitives ? m_shared_resources->m_primitive_pso : m_shared_resources->m_pso);
+				break;
+			}
+
+			case command_log_op::set_blend_factors:
+			{
+				float factors[4];
+				if (!reader.read(factors)) [[unlikely]]
+				{
+					return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+				}
+				ctx->set_blend_factors(factors);
+				break;
+			}
+
+			case command_log_op::set_viewport:
+			{
+				Diligent::Viewport viewport;
+				std::uint32_t	   rt_width, rt_height;
+				if (!(reader.read(viewport) && reader.read(rt_width) && reader.read(rt_height))) [[unlikely]]
+				{
+					return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+				}
+				ctx->set_viewport(viewport, rt_width, rt_height);
+				break;
+			}
+
+			case command_log_op::set_scissor_rect:
+			{
+				Diligent::Rect rect;
+				std::uint32_t  rt_width, rt_height;
+				if (!(reader.read(rect) && reader.read(rt_width) && reader.read(rt_height))) [[unlikely]]
+				{
+					return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+				}
+				ctx->set_scissor_rect(rect, rt_width, rt_height);
+				break;
+			}
+
+			case command_log_op::commit_texture:
+			{
+				std::uint32_t srb_id, view_id;
+				if (!(reader.read(srb_id) && reader.read(view_id) && valid(view_id))) [[unlikely]]
+				{
+					return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+				}
+				if (primitives)
+				{
+					ctx->commit_texture(m_shared_resources->m_primitive_srb, m_shared_resources->m_primitive_texture_var, m_views[view_id]);
+				}
+				else
+				{
+					ctx->commit_texture(m_shared_resources->m_srb, m_shared_resources->m_texture_var, m_views[view_id]);
+				}
+				break;
+			}
+
+			case command_log_op::draw_indexed:
+			{
+				command_log_draw draw;
+				if (!reader.read(draw)) [[unlikely]]
+				{
+					return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+				}
+				Diligent::DrawIndexedAttribs attribs;
+				attribs.NumIndices			  = draw.m_num_indices;
+				attribs.IndexType			  = static_cast<Diligent::VALUE_TYPE>(draw.m_index_type);
+				attribs.Flags				  = static_cast<Diligent::DRAW_FLAGS>(draw.m_flags);
+				attribs.NumInstances		  = draw.m_num_instances;
+				attribs.BaseVertex			  = draw.m_base_vertex;
+				attribs.FirstIndexLocation	  = draw.m_first_index_location;
+				attribs.FirstInstanceLocation = draw.m_first_instance_location;
+				ctx->draw_indexed(attribs);
+				break;
+			}
+
+			case command_log_op::draw:
+			{
+				command_log_draw draw;
+				if (!reader.read(draw)) [[unlikely]]
+				{
+					return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+				}
+				Diligent::DrawAttribs attribs;
+				attribs.NumVertices			  = draw.m_num_indices;
+				attribs.Flags				  = static_cast<Diligent::DRAW_FLAGS>(draw.m_flags);
+				attribs.NumInstances		  = draw.m_num_instances;
+				attribs.StartVertexLocation	  = draw.m_base_vertex;
+				attribs.FirstInstanceLocation = draw.m_first_instance_location;
+				ctx->draw(attribs);
+				break;
+			}
+
+			case command_log_op::set_render_target:
+			{
+				std::uint32_t rtv_id, dsv_id;
+				if (!(reader.read(rtv_id) && reader.read(dsv_id) && valid(rtv_id) && valid(dsv_id))) [[unlikely]]
+				{
+					return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+				}
+				ctx->set_render_target(m_views[rtv_id], m_views[dsv_id]);
+				break;
+			}
+
+			case command_log_op::clear_render_target:
+			{
+				std::uint32_t id;
+				float		  color[4];
+				if (!(reader.read(id) && reader.read(color) && valid(id))) [[unlikely]]
+				{
+					return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+				}
+				ctx->clear_render_target(m_views[id], color);
+				break;
+			}
+
+			case command_log_op::clear_depth:
+			{
+				std::uint32_t id;
+				float		  depth;
+				if (!(reader.read(id) && reader.read(depth) && valid(id))) [[unlikely]]
+				{
+					return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+				}
+				if (m_views[id] || !m_device)
+				{
+					ctx->clear_depth(m_views[id], depth);
+				}
+				break;
+			}
+
+			case command_log_op::copy_texture:
+			{
+				std::uint32_t src_id, dst_id;
+				if (!(reader.read(src_id) && reader.read(dst_id) && valid(src_id) && valid(dst_id))) [[unlikely]]
+				{
+					return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+				}
+				// Recorded targets are recreated at their recorded sizes, so a copy between them still matches up
+				if ((m_views[src_id] && m_views[dst_id]) || !m_device)
+				{
+					ctx->copy_texture(m_views[src_id], m_views[dst_id]);
+				}
+				break;
+			}
+
+			case command_log_op::present:
+			{
+				std::uint32_t id, sync_interval;
+				if (!(reader.read(id) && reader.read(sync_interval))) [[unlikely]]
+				{
+					return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+				}
+				// There is no swap chain to present to on replay; a frame boundary is all that is left of it.
+				if (!m_device)
+				{
+					ctx->present(nullptr, sync_interval);
+				}
+				++stats.m_frames;
+				break;
+			}
+
+			default:
+				return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+			}
+		}
+
+		return {};
+	}
+	catch (...)
+	{
+		return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+	}
+} // namespace mu
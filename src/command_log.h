@@ -0,0 +1,524 @@
+#pragma once
+
+#include <mu_gfx.h>
+
+#include "render_context.h"
+
+#include <Graphics/GraphicsEngine/interface/Buffer.h>
+#include <Graphics/GraphicsEngine/interface/Texture.h>
+#include <Graphics/GraphicsEngine/interface/TextureView.h>
+#include <Graphics/GraphicsEngine/interface/RenderDevice.h>
+#include <Graphics/GraphicsEngine/interface/PipelineState.h>
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace Diligent
+{
+	struct imgui_shared_resources;
+}
+
+namespace mu
+{
+	// Binary log of the render_context calls made during a recording.
+	//
+	// Layout: command_log_header, then records of one command_log_op byte followed by its fixed payload (see command_log_recorder).
+	// Objects (buffers, views, PSOs, SRBs, swap chains) are referenced by ids that are introduced by a declare_object record the first
+	// time they are seen, carrying enough of the description to recreate an equivalent object on replay.
+	struct command_log_header
+	{
+		char		  m_magic[8] = {'M', 'U', 'G', 'F', 'X', 'C', 'M', 'D'};
+		std::uint32_t m_version	 = 5;
+	};
+
+	enum class command_log_op : std::uint8_t
+	{
+		declare_object,
+		map_buffer,
+		unmap_buffer, // followed by the bytes written while mapped
+		set_vertex_buffer,
+		set_index_buffer,
+		set_pipeline_state,
+		set_blend_factors,
+		set_viewport,
+		set_scissor_rect,
+		commit_texture,
+		draw_indexed,
+		set_render_target,
+		clear_render_target,
+		clear_depth,
+		present,
+		copy_texture,
+		update_buffer, // followed by the bytes written
+		draw,		   // command_log_draw with the vertex count in m_num_indices and the start vertex in m_base_vertex
+		update_texture, // view id, box min x, max x, min y, max y, stride, size, followed by the bytes written
+		copy_buffer,	// source id, source offset, destination id, destination offset, size
+	};
+
+	enum class command_log_object : std::uint8_t
+	{
+		buffer,
+		texture_view,
+		pipeline_state,
+		shader_resource_binding,
+		swap_chain,
+	};
+
+	struct command_log_object_desc
+	{
+		std::uint32_t	   m_id		   = 0;
+		command_log_object m_kind	   = command_log_object::buffer;
+		std::uint32_t	   m_size	   = 0; // buffers
+		std::uint32_t	   m_bind	   = 0; // buffers, texture views: bind flags
+		std::uint32_t	   m_width	   = 0; // texture views, swap chains
+		std::uint32_t	   m_height	   = 0;
+		std::uint32_t	   m_format	   = 0; // texture views: texture format, pipeline states: value type of the position
+		std::uint32_t	   m_view_type = 0; // texture views, pipeline states: input frequency of the position
+		std::uint32_t	   m_usage	   = 0; // buffers
+	};
+
+	struct command_log_draw
+	{
+		std::uint32_t m_num_indices;
+		std::uint32_t m_index_type;
+		std::uint32_t m_flags;
+		std::uint32_t m_num_instances;
+		std::uint32_t m_base_vertex;
+		std::uint32_t m_first_index_location;
+		std::uint32_t m_first_instance_location;
+	};
+
+	// Wraps another render_context, forwards every call and appends it to a command log file.
+	struct command_log_recorder : public render_context
+	{
+		std::shared_ptr<render_context> m_inner;
+		std::FILE*						m_file = nullptr;
+		bool							m_failed{false};
+
+		std::unordered_map<const void*, command_log_object_desc> m_objects;
+		std::uint32_t											 m_next_id{1};
+
+		struct open_map
+		{
+			void*		  m_data;
+			std::uint32_t m_size;
+		};
+		std::unordered_map<std::uint32_t, open_map> m_open_maps;
+
+		command_log_recorder(std::shared_ptr<render_context> inner, const char* path) : m_inner(std::move(inner))
+		{
+			m_file = std::fopen(path, "wb");
+			if (m_file == nullptr) [[unlikely]]
+			{
+				MU_LEAF_THROW_EXCEPTION(gfx_error::not_specified{});
+			}
+			write(command_log_header{});
+		}
+
+		virtual ~command_log_recorder()
+		{
+			if (m_file != nullptr)
+			{
+				std::fclose(m_file);
+			}
+		}
+
+		command_log_recorder(const command_log_recorder&)			 = delete;
+		command_log_recorder& operator=(const command_log_recorder&) = delete;
+
+		[[nodiscard]] auto close() noexcept -> leaf::result<void>
+		{
+			if (m_file != nullptr)
+			{
+				m_failed |= std::fclose(m_file) != 0;
+				m_file = nullptr;
+			}
+
+			if (m_failed) [[unlikely]]
+			{
+				return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+			}
+			return {};
+		}
+
+		auto write_bytes(const void* data, std::size_t size) noexcept -> void
+		{
+			if (m_file != nullptr && size > 0)
+			{
+				m_failed |= std::fwrite(data, 1, size, m_file) != size;
+			}
+		}
+
+		template<typename T>
+		auto write(const T& value) noexcept -> void
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			write_bytes(&value, sizeof(T));
+		}
+
+		auto op(command_log_op o) noexcept -> void
+		{
+			write(o);
+		}
+
+		// Returns the id of obj, declaring it first if it is new or its description changed since (pointer reuse after a release).
+		auto id_of(const void* obj, const command_log_object_desc& desc) noexcept -> std::uint32_t
+		try
+		{
+			if (obj == nullptr)
+			{
+				return 0;
+			}
+
+			auto& known = m_objects[obj];
+			if (known.m_id == 0 || known.m_kind != desc.m_kind || known.m_size != desc.m_size || known.m_width != desc.m_width || known.m_height != desc.m_height ||
+				known.m_format != desc.m_format)
+			{
+				known	   = desc;
+				known.m_id = m_next_id++;
+				op(command_log_op::declare_object);
+				write(known);
+			}
+			return known.m_id;
+		}
+		catch (...)
+		{
+			m_failed = true;
+			return 0;
+		}
+
+		auto id_of(Diligent::IBuffer* buffer) noexcept -> std::uint32_t
+		{
+			command_log_object_desc desc;
+			desc.m_kind = command_log_object::buffer;
+			if (buffer != nullptr)
+			{
+				const auto& buffer_desc = buffer->GetDesc();
+				desc.m_size				= static_cast<std::uint32_t>(buffer_desc.uiSizeInBytes);
+				desc.m_bind				= static_cast<std::uint32_t>(buffer_desc.BindFlags);
+				desc.m_usage			= static_cast<std::uint32_t>(buffer_desc.Usage);
+			}
+			return id_of(buffer, desc);
+		}
+
+		auto id_of(Diligent::ITextureView* view) noexcept -> std::uint32_t
+		{
+			command_log_object_desc desc;
+			desc.m_kind = command_log_object::texture_view;
+			if (view != nullptr)
+			{
+				const auto& texture_desc = view->GetTexture()->GetDesc();
+				desc.m_width			 = texture_desc.Width;
+				desc.m_height			 = texture_desc.Height;
+				desc.m_format			 = static_cast<std::uint32_t>(texture_desc.Format);
+				desc.m_bind				 = static_cast<std::uint32_t>(texture_desc.BindFlags);
+				desc.m_view_type		 = static_cast<std::uint32_t>(view->GetDesc().ViewType);
+			}
+			return id_of(view, desc);
+		}
+
+		auto id_of(Diligent::ISwapChain* swap_chain) noexcept -> std::uint32_t
+		{
+			command_log_object_desc desc;
+			desc.m_kind = command_log_object::swap_chain;
+			if (swap_chain != nullptr)
+			{
+				desc.m_width  = swap_chain->GetDesc().Width;
+				desc.m_height = swap_chain->GetDesc().Height;
+			}
+			return id_of(swap_chain, desc);
+		}
+
+		auto id_of(Diligent::IPipelineState* pso) noexcept -> std::uint32_t
+		{
+			command_log_object_desc desc;
+			desc.m_kind = command_log_object::pipeline_state;
+			if (pso != nullptr)
+			{
+				const auto& layout = pso->GetGraphicsPipelineDesc().InputLayout;
+				if (layout.NumElements > 0)
+				{
+					desc.m_format	 = static_cast<std::uint32_t>(layout.LayoutElements[0].ValueType);
+					desc.m_view_type = static_cast<std::uint32_t>(layout.LayoutElements[0].Frequency);
+				}
+			}
+			return id_of(pso, desc);
+		}
+
+		auto id_of(const void* obj, command_log_object kind) noexcept -> std::uint32_t
+		{
+			command_log_object_desc desc;
+			desc.m_kind = kind;
+			return id_of(obj, desc);
+		}
+
+		virtual auto map_buffer(Diligent::IBuffer* buffer, Diligent::Uint32 size, Diligent::MAP_TYPE map_type, Diligent::MAP_FLAGS map_flags) -> void* override final
+		{
+			const auto id = id_of(buffer);
+			op(command_log_op::map_buffer);
+			write(id);
+			write(static_cast<std::uint32_t>(size));
+			write(static_cast<std::uint32_t>(map_type));
+			write(static_cast<std::uint32_t>(map_flags));
+
+			auto data = m_inner->map_buffer(buffer, size, map_type, map_flags);
+			try
+			{
+				m_open_maps[id] = open_map{data, size};
+			}
+			catch (...)
+			{
+				m_failed = true;
+			}
+			return data;
+		}
+
+		virtual auto unmap_buffer(Diligent::IBuffer* buffer, Diligent::MAP_TYPE map_type) -> void override final
+		{
+			const auto id = id_of(buffer);
+			open_map   mapped{nullptr, 0};
+			if (auto itor = m_open_maps.find(id); itor != m_open_maps.end())
+			{
+				mapped = itor->second;
+				m_open_maps.erase(itor);
+			}
+
+			op(command_log_op::unmap_buffer);
+			write(id);
+			write(static_cast<std::uint32_t>(map_type));
+			write(mapped.m_data != nullptr ? mapped.m_size : std::uint32_t{0});
+			if (mapped.m_data != nullptr)
+			{
+				write_bytes(mapped.m_data, mapped.m_size);
+			}
+
+			m_inner->unmap_buffer(buffer, map_type);
+		}
+
+		virtual auto update_buffer(Diligent::IBuffer* buffer, Diligent::Uint32 offset, Diligent::Uint32 size, const void* data) -> void override final
+		{
+			const auto id = id_of(buffer);
+			op(command_log_op::update_buffer);
+			write(id);
+			write(static_cast<std::uint32_t>(offset));
+			write(static_cast<std::uint32_t>(size));
+			write_bytes(data, size);
+			m_inner->update_buffer(buffer, offset, size, data);
+		}
+
+		virtual auto copy_buffer(Diligent::IBuffer* src, Diligent::Uint32 src_offset, Diligent::IBuffer* dst, Diligent::Uint32 dst_offset, Diligent::Uint32 size) -> void override final
+		{
+			const auto src_id = id_of(src);
+			const auto dst_id = id_of(dst);
+			op(command_log_op::copy_buffer);
+			write(src_id);
+			write(static_cast<std::uint32_t>(src_offset));
+			write(dst_id);
+			write(static_cast<std::uint32_t>(dst_offset));
+			write(static_cast<std::uint32_t>(size));
+			m_inner->copy_buffer(src, src_offset, dst, dst_offset, size);
+		}
+
+		virtual auto update_texture(Diligent::ITextureView* view, const Diligent::Box& box, const void* data, Diligent::Uint32 stride) -> void override final
+		{
+			const auto id	= id_of(view);
+			const auto size = stride * (box.MaxY - box.MinY);
+			op(command_log_op::update_texture);
+			write(id);
+			write(static_cast<std::uint32_t>(box.MinX));
+			write(static_cast<std::uint32_t>(box.MaxX));
+			write(static_cast<std::uint32_t>(box.MinY));
+			write(static_cast<std::uint32_t>(box.MaxY));
+			write(static_cast<std::uint32_t>(stride));
+			write(static_cast<std::uint32_t>(size));
+			write_bytes(data, size);
+			m_inner->update_texture(view, box, data, stride);
+		}
+
+		virtual auto set_vertex_buffer(Diligent::IBuffer* buffer, Diligent::Uint32 offset) -> void override final
+		{
+			const auto id = id_of(buffer);
+			op(command_log_op::set_vertex_buffer);
+			write(id);
+			write(static_cast<std::uint32_t>(offset));
+			m_inner->set_vertex_buffer(buffer, offset);
+		}
+
+		virtual auto set_index_buffer(Diligent::IBuffer* buffer, Diligent::Uint32 offset) -> void override final
+		{
+			const auto id = id_of(buffer);
+			op(command_log_op::set_index_buffer);
+			write(id);
+			write(static_cast<std::uint32_t>(offset));
+			m_inner->set_index_buffer(buffer, offset);
+		}
+
+		virtual auto set_pipeline_state(Diligent::IPipelineState* pso) -> void override final
+		{
+			const auto id = id_of(pso);
+			op(command_log_op::set_pipeline_state);
+			write(id);
+			m_inner->set_pipeline_state(pso);
+		}
+
+		virtual auto set_blend_factors(const float* blend_factors) -> void override final
+		{
+			float factors[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+			if (blend_factors != nullptr)
+			{
+				std::memcpy(factors, blend_factors, sizeof(factors));
+			}
+			op(command_log_op::set_blend_factors);
+			write(factors);
+			m_inner->set_blend_factors(blend_factors);
+		}
+
+		virtual auto set_viewport(const Diligent::Viewport& viewport, Diligent::Uint32 rt_width, Diligent::Uint32 rt_height) -> void override final
+		{
+			op(command_log_op::set_viewport);
+			write(viewport);
+			write(static_cast<std::uint32_t>(rt_width));
+			write(static_cast<std::uint32_t>(rt_height));
+			m_inner->set_viewport(viewport, rt_width, rt_height);
+		}
+
+		virtual auto set_scissor_rect(const Diligent::Rect& rect, Diligent::Uint32 rt_width, Diligent::Uint32 rt_height) -> void override final
+		{
+			op(command_log_op::set_scissor_rect);
+			write(rect);
+			write(static_cast<std::uint32_t>(rt_width));
+			write(static_cast<std::uint32_t>(rt_height));
+			m_inner->set_scissor_rect(rect, rt_width, rt_height);
+		}
+
+		virtual auto commit_texture(Diligent::IShaderResourceBinding* srb, Diligent::IShaderResourceVariable* var, Diligent::ITextureView* view) -> void override final
+		{
+			const auto srb_id  = id_of(srb, command_log_object::shader_resource_binding);
+			const auto view_id = id_of(view);
+			op(command_log_op::commit_texture);
+			write(srb_id);
+			write(view_id);
+			m_inner->commit_texture(srb, var, view);
+		}
+
+		virtual auto draw_indexed(const Diligent::DrawIndexedAttribs& attribs) -> void override final
+		{
+			op(command_log_op::draw_indexed);
+			write(command_log_draw{
+				attribs.NumIndices,
+				static_cast<std::uint32_t>(attribs.IndexType),
+				static_cast<std::uint32_t>(attribs.Flags),
+				attribs.NumInstances,
+				attribs.BaseVertex,
+				attribs.FirstIndexLocation,
+				attribs.FirstInstanceLocation});
+			m_inner->draw_indexed(attribs);
+		}
+
+		virtual auto draw(const Diligent::DrawAttribs& attribs) -> void override final
+		{
+			op(command_log_op::draw);
+			write(command_log_draw{
+				attribs.NumVertices,
+				0,
+				static_cast<std::uint32_t>(attribs.Flags),
+				attribs.NumInstances,
+				attribs.StartVertexLocation,
+				0,
+				attribs.FirstInstanceLocation});
+			m_inner->draw(attribs);
+		}
+
+		virtual auto set_render_target(Diligent::ITextureView* rtv, Diligent::ITextureView* dsv) -> void override final
+		{
+			const auto rtv_id = id_of(rtv);
+			const auto dsv_id = id_of(dsv);
+			op(command_log_op::set_render_target);
+			write(rtv_id);
+			write(dsv_id);
+			m_inner->set_render_target(rtv, dsv);
+		}
+
+		virtual auto clear_render_target(Diligent::ITextureView* rtv, const float* clear_color) -> void override final
+		{
+			const auto rtv_id = id_of(rtv);
+			float	   color[4];
+			std::memcpy(color, clear_color, sizeof(color));
+			op(command_log_op::clear_render_target);
+			write(rtv_id);
+			write(color);
+			m_inner->clear_render_target(rtv, clear_color);
+		}
+
+		virtual auto clear_depth(Diligent::ITextureView* dsv, float depth) -> void override final
+		{
+			const auto dsv_id = id_of(dsv);
+			op(command_log_op::clear_depth);
+			write(dsv_id);
+			write(depth);
+			m_inner->clear_depth(dsv, depth);
+		}
+
+		virtual auto copy_texture(Diligent::ITextureView* src, Diligent::ITextureView* dst) -> void override final
+		{
+			const auto src_id = id_of(src);
+			const auto dst_id = id_of(dst);
+			op(command_log_op::copy_texture);
+			write(src_id);
+			write(dst_id);
+			m_inner->copy_texture(src, dst);
+		}
+
+		virtual auto present(Diligent::ISwapChain* swap_chain, Diligent::Uint32 sync_interval) -> void override final
+		{
+			const auto id = id_of(swap_chain);
+			op(command_log_op::present);
+			write(id);
+			write(static_cast<std::uint32_t>(sync_interval));
+			m_inner->present(swap_chain, sync_interval);
+		}
+	};
+
+	// A command log loaded into memory, ready to be replayed any number of times.
+	struct command_log
+	{
+		std::vector<std::byte>				 m_stream; // records, without the header
+		std::vector<command_log_object_desc> m_objects;
+		std::uint32_t						 m_frames{0};
+
+		[[nodiscard]] static auto load(const char* path) noexcept -> leaf::result<std::shared_ptr<command_log>>;
+	};
+
+	struct command_log_replay_stats
+	{
+		std::uint64_t m_frames{0};
+		std::uint64_t m_commands{0};
+		std::uint64_t m_bytes_uploaded{0};
+	};
+
+	// Re-issues a command_log against any render_context. Objects are recreated from their recorded descriptions when a device is
+	// given; without one (null/counting contexts) everything is issued with null handles. Recorded pipeline states all map to the
+	// ImGui or primitive pipeline of m_shared_resources, with the vertex format they were recorded with (the font pipeline
+	// replays as the ImGui one, every texture being the bitmap font), recorded textures to placeholders and recorded render targets
+	// to offscreen targets.
+	struct command_log_player
+	{
+		std::shared_ptr<command_log>					  m_log;
+		Diligent::RefCntAutoPtr<Diligent::IRenderDevice>  m_device;
+		std::shared_ptr<Diligent::imgui_shared_resources> m_shared_resources;
+		std::shared_ptr<Diligent::imgui_font_resources>	  m_font_resources;
+
+		std::vector<Diligent::RefCntAutoPtr<Diligent::IBuffer>>		 m_buffers;
+		std::vector<Diligent::RefCntAutoPtr<Diligent::ITextureView>> m_views;
+		std::vector<Diligent::RefCntAutoPtr<Diligent::ITexture>>	 m_textures;
+		std::vector<void*>											 m_mapped;
+
+		command_log_player(std::shared_ptr<command_log> log, Diligent::IRenderDevice* device);
+		~command_log_player();
+
+		[[nodiscard]] auto play(render_context* ctx, command_log_replay_stats& stats) noexcept -> leaf::result<void>;
+	};
+} // namespace mu
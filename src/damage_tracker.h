@@ -0,0 +1,139 @@
+#pragma once
+
+#include <mu_gfx.h>
+
+#include <imgui.h>
+#include <imgui_internal.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <vector>
+
+namespace mu
+{
+	// Finds the part of a viewport that changed since the previous frame. Each ImDrawList is compared with the list at the same
+	// position the frame before: when their contents hash differently, the old and the new bounds are both damaged. Lists with user
+	// callbacks, which can draw anything, and changes of the display rect or scale damage the whole viewport. Primitive batches are
+	// not user callbacks: their vertices are the corners of what they draw.
+	//
+	// Only the draw data is compared: an image whose pixels change under the same ImTextureID is not noticed.
+	struct damage_tracker
+	{
+		struct list_signature
+		{
+			ImU32  m_hash{0};
+			ImVec4 m_bounds{0.0f, 0.0f, 0.0f, 0.0f}; // display coordinates, what the list can touch
+			bool   m_callbacks{false};
+		};
+
+		std::vector<list_signature> m_lists;
+		std::vector<list_signature> m_next;
+		ImVec4						m_display{0.0f, 0.0f, 0.0f, 0.0f};
+		ImVec2						m_framebuffer_scale{0.0f, 0.0f};
+		bool						m_valid{false};
+
+		// Forgets the previous frame, the next update damages everything.
+		auto invalidate() noexcept -> void
+		{
+			m_valid = false;
+		}
+
+		[[nodiscard]] static auto empty(const ImVec4& rect) noexcept -> bool
+		{
+			return rect.z <= rect.x || rect.w <= rect.y;
+		}
+
+		[[nodiscard]] static auto signature(const ImDrawList* list, const ImVec4& display) noexcept -> list_signature
+		{
+			list_signature sig;
+			sig.m_hash = ImHashData(list->VtxBuffer.Data, static_cast<std::size_t>(list->VtxBuffer.Size) * sizeof(ImDrawVert), 0);
+			sig.m_hash = ImHashData(list->IdxBuffer.Data, static_cast<std::size_t>(list->IdxBuffer.Size) * sizeof(ImDrawIdx), sig.m_hash);
+			sig.m_hash = ImHashData(list->CmdBuffer.Data, static_cast<std::size_t>(list->CmdBuffer.Size) * sizeof(ImDrawCmd), sig.m_hash);
+
+			// Vertices that are drawn can only land inside the union of the clip rects
+			ImVec4 clip{FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX};
+			for (const ImDrawCmd& cmd : list->CmdBuffer)
+			{
+				if (cmd.UserCallback != nullptr && cmd.UserCallback != ImDrawCallback_ResetRenderState && cmd.UserCallback != &gfx_primitives_callback)
+				{
+					sig.m_callbacks = true;
+				}
+				else if (cmd.ElemCount > 0)
+				{
+					clip = ImVec4(ImMin(clip.x, cmd.ClipRect.x), ImMin(clip.y, cmd.ClipRect.y), ImMax(clip.z, cmd.ClipRect.z), ImMax(clip.w, cmd.ClipRect.w));
+				}
+			}
+
+			ImVec4 bounds{FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX};
+			for (const ImDrawVert& v : list->VtxBuffer)
+			{
+				bounds = ImVec4(ImMin(bounds.x, v.pos.x), ImMin(bounds.y, v.pos.y), ImMax(bounds.z, v.pos.x), ImMax(bounds.w, v.pos.y));
+			}
+
+			// Antialiased edges and the rasterizer's rounding reach a pixel beyond the vertices
+			sig.m_bounds = ImVec4(
+				ImMax(ImMax(bounds.x - 1.0f, clip.x), display.x),
+				ImMax(ImMax(bounds.y - 1.0f, clip.y), display.y),
+				ImMin(ImMin(bounds.z + 1.0f, clip.z), display.z),
+				ImMin(ImMin(bounds.w + 1.0f, clip.w), display.w));
+			return sig;
+		}
+
+		// Returns the damage in display coordinates, like ImDrawCmd::ClipRect, see empty().
+		[[nodiscard]] auto update(const ImDrawData* draw_data) -> ImVec4
+		{
+			const ImVec4 display{
+				draw_data->DisplayPos.x,
+				draw_data->DisplayPos.y,
+				draw_data->DisplayPos.x + draw_data->DisplaySize.x,
+				draw_data->DisplayPos.y + draw_data->DisplaySize.y};
+
+			bool full = !m_valid || m_display.x != display.x || m_display.y != display.y || m_display.z != display.z || m_display.w != display.w ||
+						m_framebuffer_scale.x != draw_data->FramebufferScale.x || m_framebuffer_scale.y != draw_data->FramebufferScale.y;
+
+			ImVec4 damage{FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX};
+			auto   add = [&](const ImVec4& rect) -> void
+			{
+				if (!empty(rect))
+				{
+					damage = ImVec4(ImMin(damage.x, rect.x), ImMin(damage.y, rect.y), ImMax(damage.z, rect.z), ImMax(damage.w, rect.w));
+				}
+			};
+
+			m_next.clear();
+			for (int n = 0; n < draw_data->CmdListsCount; n++)
+			{
+				const auto& sig = m_next.emplace_back(signature(draw_data->CmdLists[n], display));
+				full |= sig.m_callbacks;
+
+				const auto index = static_cast<std::size_t>(n);
+				if (index >= m_lists.size())
+				{
+					add(sig.m_bounds);
+				}
+				else if (m_lists[index].m_hash != sig.m_hash)
+				{
+					add(m_lists[index].m_bounds);
+					add(sig.m_bounds);
+				}
+			}
+
+			// Lists that went away leave their previous bounds to repaint
+			for (std::size_t n = m_next.size(); n < m_lists.size(); n++)
+			{
+				add(m_lists[n].m_bounds);
+			}
+
+			m_lists.swap(m_next);
+			m_display			= display;
+			m_framebuffer_scale = draw_data->FramebufferScale;
+			m_valid				= true;
+
+			if (full)
+			{
+				return display;
+			}
+			return empty(damage) ? ImVec4(0.0f, 0.0f, 0.0f, 0.0f) : damage;
+		}
+	};
+} // namespace mu
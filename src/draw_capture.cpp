@@ -0,0 +1,284 @@
+#include "mu_gfx_impl.h"
+
+#include "draw_capture.h"
+
+#include <cstring>
+
+namespace mu
+{
+	namespace
+	{
+		auto replayed_user_callback(const ImDrawList*, const ImDrawCmd*) -> void { }
+
+		struct draw_capture_reader
+		{
+			const std::byte* m_data;
+			std::size_t		 m_size;
+			std::size_t		 m_pos;
+
+			template<typename T>
+			[[nodiscard]] auto read(T& value) noexcept -> bool
+			{
+				static_assert(std::is_trivially_copyable_v<T>);
+				if (m_size - m_pos < sizeof(T)) [[unlikely]]
+				{
+					return false;
+				}
+				std::memcpy(&value, m_data + m_pos, sizeof(T));
+				m_pos += sizeof(T);
+				return true;
+			}
+
+			template<typename T>
+			[[nodiscard]] auto read(ImVector<T>& values, std::uint32_t count) noexcept -> bool
+			{
+				const auto size = static_cast<std::size_t>(count) * sizeof(T);
+				if (m_size - m_pos < size) [[unlikely]]
+				{
+					return false;
+				}
+				values.resize(static_cast<int>(count));
+				if (size > 0)
+				{
+					std::memcpy(values.Data, m_data + m_pos, size);
+				}
+				m_pos += size;
+				return true;
+			}
+		};
+	} // namespace
+
+	auto draw_capture_writer::open(const char* path) noexcept -> leaf::result<void>
+	{
+		MU_LEAF_CHECK(m_file.open_append(path));
+		MU_LEAF_CHECK(m_file.append(draw_capture_header{}));
+		m_frames   = 0;
+		m_in_frame = false;
+		return {};
+	}
+
+	auto draw_capture_writer::close() noexcept -> leaf::result<void>
+	{
+		abort_frame();
+		return m_file.close();
+	}
+
+	auto draw_capture_writer::begin_frame() noexcept -> leaf::result<void>
+	{
+		MU_LEAF_AUTO(offset, m_file.append(draw_capture_frame_header{}));
+		m_frame_offset = offset;
+		m_in_frame	   = true;
+		return {};
+	}
+
+	auto draw_capture_writer::add_viewport(ImGuiID id, const ImDrawData* draw_data) noexcept -> leaf::result<void>
+	{
+		if (!m_in_frame || draw_data == nullptr || !draw_data->Valid) [[unlikely]]
+		{
+			return {};
+		}
+
+		draw_capture_viewport viewport;
+		viewport.m_id					= id;
+		viewport.m_lists				= static_cast<std::uint32_t>(draw_data->CmdListsCount);
+		viewport.m_display_pos[0]		= draw_data->DisplayPos.x;
+		viewport.m_display_pos[1]		= draw_data->DisplayPos.y;
+		viewport.m_display_size[0]		= draw_data->DisplaySize.x;
+		viewport.m_display_size[1]		= draw_data->DisplaySize.y;
+		viewport.m_framebuffer_scale[0] = draw_data->FramebufferScale.x;
+		viewport.m_framebuffer_scale[1] = draw_data->FramebufferScale.y;
+		MU_LEAF_CHECK(m_file.append(viewport));
+
+		for (int list_n = 0; list_n < draw_data->CmdListsCount; ++list_n)
+		{
+			const ImDrawList* cmd_list = draw_data->CmdLists[list_n];
+
+			draw_capture_list list;
+			list.m_cmds	 = static_cast<std::uint32_t>(cmd_list->CmdBuffer.Size);
+			list.m_vtx	 = static_cast<std::uint32_t>(cmd_list->VtxBuffer.Size);
+			list.m_idx	 = static_cast<std::uint32_t>(cmd_list->IdxBuffer.Size);
+			list.m_flags = static_cast<std::uint32_t>(cmd_list->Flags);
+			MU_LEAF_CHECK(m_file.append(list));
+
+			for (const ImDrawCmd& im_cmd : cmd_list->CmdBuffer)
+			{
+				draw_capture_cmd cmd;
+				std::memcpy(cmd.m_clip_rect, &im_cmd.ClipRect, sizeof(cmd.m_clip_rect));
+				cmd.m_texture	 = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(im_cmd.TextureId));
+				cmd.m_vtx_offset = im_cmd.VtxOffset;
+				cmd.m_idx_offset = im_cmd.IdxOffset;
+				cmd.m_elem_count = im_cmd.ElemCount;
+				cmd.m_callback	 = im_cmd.UserCallback == nullptr								? draw_capture_callback::none
+								   : im_cmd.UserCallback == ImDrawCallback_ResetRenderState ? draw_capture_callback::reset_render_state
+								   : im_cmd.UserCallback == &gfx_primitives_callback		? draw_capture_callback::primitives
+																							: draw_capture_callback::user;
+				MU_LEAF_CHECK(m_file.append(cmd));
+			}
+
+			MU_LEAF_CHECK(m_file.append(cmd_list->VtxBuffer.Data, static_cast<std::size_t>(list.m_vtx) * sizeof(ImDrawVert)));
+			MU_LEAF_CHECK(m_file.append(cmd_list->IdxBuffer.Data, static_cast<std::size_t>(list.m_idx) * sizeof(ImDrawIdx)));
+		}
+
+		draw_capture_frame_header frame;
+		std::memcpy(&frame, m_file.m_data + m_frame_offset, sizeof(frame));
+		++frame.m_viewports;
+		std::memcpy(m_file.m_data + m_frame_offset, &frame, sizeof(frame));
+		return {};
+	}
+
+	auto draw_capture_writer::end_frame() noexcept -> leaf::result<void>
+	{
+		if (!m_in_frame) [[unlikely]]
+		{
+			return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+		}
+
+		draw_capture_frame_header frame;
+		std::memcpy(&frame, m_file.m_data + m_frame_offset, sizeof(frame));
+		frame.m_size = static_cast<std::uint32_t>(m_file.m_size - m_frame_offset);
+		std::memcpy(m_file.m_data + m_frame_offset, &frame, sizeof(frame));
+
+		m_in_frame = false;
+		++m_frames;
+		return {};
+	}
+
+	auto draw_capture_writer::abort_frame() noexcept -> void
+	{
+		if (m_in_frame)
+		{
+			m_file.m_size = m_frame_offset;
+			m_in_frame	  = false;
+		}
+	}
+
+	auto draw_capture::open(const char* path) noexcept -> leaf::result<void>
+	try
+	{
+		MU_LEAF_CHECK(m_file.open_read(path));
+		m_frame_offsets.clear();
+
+		draw_capture_reader reader{m_file.m_data, m_file.m_size, 0};
+
+		draw_capture_header header;
+		draw_capture_header expected;
+		if (!reader.read(header) || std::memcmp(header.m_magic, expected.m_magic, sizeof(header.m_magic)) != 0 || header.m_version != expected.m_version ||
+			header.m_vertex_size != expected.m_vertex_size || header.m_index_size != expected.m_index_size) [[unlikely]]
+		{
+			return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+		}
+
+		while (reader.m_pos < reader.m_size)
+		{
+			const auto				  offset = reader.m_pos;
+			draw_capture_frame_header frame;
+			if (!reader.read(frame) || frame.m_size < sizeof(frame) || frame.m_size > reader.m_size - offset) [[unlikely]]
+			{
+				// A truncated trailing frame is what a crashed capture looks like, keep everything before it
+				break;
+			}
+			m_frame_offsets.push_back(offset);
+			reader.m_pos = offset + frame.m_size;
+		}
+
+		return {};
+	}
+	catch (...)
+	{
+		return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+	}
+
+	auto draw_capture::decode(std::size_t index, const texture_resolver& resolve, draw_capture_frame& out) const noexcept -> leaf::result<void>
+	try
+	{
+		if (index >= m_frame_offsets.size()) [[unlikely]]
+		{
+			return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+		}
+
+		draw_capture_reader		  reader{m_file.m_data, m_file.m_size, m_frame_offsets[index]};
+		draw_capture_frame_header frame;
+		if (!reader.read(frame)) [[unlikely]]
+		{
+			return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+		}
+		reader.m_size = m_frame_offsets[index] + frame.m_size;
+
+		out.m_viewports.resize(frame.m_viewports);
+		for (auto& viewport : out.m_viewports)
+		{
+			draw_capture_viewport captured;
+			if (!reader.read(captured)) [[unlikely]]
+			{
+				return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+			}
+
+			viewport.m_id = captured.m_id;
+			while (viewport.m_lists.size() < captured.m_lists)
+			{
+				viewport.m_lists.push_back(std::make_unique<ImDrawList>(nullptr));
+			}
+			viewport.m_list_ptrs.clear();
+
+			int total_vtx = 0;
+			int total_idx = 0;
+			for (std::uint32_t list_n = 0; list_n < captured.m_lists; ++list_n)
+			{
+				ImDrawList*		  cmd_list = viewport.m_lists[list_n].get();
+				draw_capture_list list;
+				if (!reader.read(list)) [[unlikely]]
+				{
+					return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+				}
+
+				cmd_list->Flags = static_cast<ImDrawListFlags>(list.m_flags);
+				cmd_list->CmdBuffer.resize(static_cast<int>(list.m_cmds));
+				for (ImDrawCmd& im_cmd : cmd_list->CmdBuffer)
+				{
+					draw_capture_cmd cmd;
+					if (!reader.read(cmd)) [[unlikely]]
+					{
+						return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+					}
+
+					im_cmd				= ImDrawCmd();
+					im_cmd.ClipRect		= ImVec4(cmd.m_clip_rect[0], cmd.m_clip_rect[1], cmd.m_clip_rect[2], cmd.m_clip_rect[3]);
+					im_cmd.TextureId	= resolve ? resolve(cmd.m_texture) : reinterpret_cast<ImTextureID>(static_cast<std::uintptr_t>(cmd.m_texture));
+					im_cmd.VtxOffset	= cmd.m_vtx_offset;
+					im_cmd.IdxOffset	= cmd.m_idx_offset;
+					im_cmd.ElemCount	= cmd.m_elem_count;
+					im_cmd.UserCallback = cmd.m_callback == draw_capture_callback::none				  ? nullptr
+										  : cmd.m_callback == draw_capture_callback::reset_render_state ? ImDrawCallback_ResetRenderState
+										  : cmd.m_callback == draw_capture_callback::primitives			? &gfx_primitives_callback
+																										: &replayed_user_callback;
+				}
+
+				if (!reader.read(cmd_list->VtxBuffer, list.m_vtx) || !reader.read(cmd_list->IdxBuffer, list.m_idx)) [[unlikely]]
+				{
+					return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+				}
+
+				total_vtx += cmd_list->VtxBuffer.Size;
+				total_idx += cmd_list->IdxBuffer.Size;
+				viewport.m_list_ptrs.push_back(cmd_list);
+			}
+
+			ImDrawData& draw_data	   = viewport.m_draw_data;
+			draw_data				   = ImDrawData();
+			draw_data.Valid			   = true;
+			draw_data.CmdLists		   = viewport.m_list_ptrs.data();
+			draw_data.CmdListsCount	   = static_cast<int>(viewport.m_list_ptrs.size());
+			draw_data.TotalVtxCount	   = total_vtx;
+			draw_data.TotalIdxCount	   = total_idx;
+			draw_data.DisplayPos	   = ImVec2(captured.m_display_pos[0], captured.m_display_pos[1]);
+			draw_data.DisplaySize	   = ImVec2(captured.m_display_size[0], captured.m_display_size[1]);
+			draw_data.FramebufferScale = ImVec2(captured.m_framebuffer_scale[0], captured.m_framebuffer_scale[1]);
+		}
+
+		return {};
+	}
+	catch (...)
+	{
+		return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+	}
+} // namespace mu
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <mu_gfx.h>
+
+#include "mapped_file.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace mu
+{
+	// Capture file of the ImDrawData of every viewport, one frame after the other.
+	//
+	// Layout: draw_capture_header, then per frame a draw_capture_frame_header followed by its viewports. Each viewport is a
+	// draw_capture_viewport followed by its lists; each list a draw_capture_list, then its commands, vertices and indices.
+	// Texture ids are stored as the raw values the application used, the player maps them back to live textures.
+	struct draw_capture_header
+	{
+		char		  m_magic[8]	= {'M', 'U', 'G', 'F', 'X', 'D', 'R', 'W'};
+		std::uint32_t m_version		= 1;
+		std::uint32_t m_vertex_size = sizeof(ImDrawVert);
+		std::uint32_t m_index_size	= sizeof(ImDrawIdx);
+		std::uint32_t m_reserved	= 0;
+	};
+
+	struct draw_capture_frame_header
+	{
+		std::uint32_t m_size	  = 0; // in bytes, including this header
+		std::uint32_t m_viewports = 0;
+	};
+
+	struct draw_capture_viewport
+	{
+		std::uint32_t m_id	  = 0;
+		std::uint32_t m_lists = 0;
+		float		  m_display_pos[2];
+		float		  m_display_size[2];
+		float		  m_framebuffer_scale[2];
+	};
+
+	struct draw_capture_list
+	{
+		std::uint32_t m_cmds  = 0;
+		std::uint32_t m_vtx	  = 0;
+		std::uint32_t m_idx	  = 0;
+		std::uint32_t m_flags = 0;
+	};
+
+	enum class draw_capture_callback : std::uint32_t
+	{
+		none,
+		reset_render_state,
+		user,		// replayed as a no-op, the original callback cannot be
+		primitives, // gfx_primitives_callback, replayed as such
+	};
+
+	struct draw_capture_cmd
+	{
+		float				  m_clip_rect[4];
+		std::uint64_t		  m_texture;
+		std::uint32_t		  m_vtx_offset;
+		std::uint32_t		  m_idx_offset;
+		std::uint32_t		  m_elem_count;
+		draw_capture_callback m_callback;
+	};
+
+	struct draw_capture_writer
+	{
+		mapped_file	  m_file;
+		std::size_t	  m_frame_offset{0};
+		std::uint32_t m_frames{0};
+		bool		  m_in_frame{false};
+
+		[[nodiscard]] auto open(const char* path) noexcept -> leaf::result<void>;
+		[[nodiscard]] auto close() noexcept -> leaf::result<void>;
+
+		[[nodiscard]] auto begin_frame() noexcept -> leaf::result<void>;
+		[[nodiscard]] auto add_viewport(ImGuiID id, const ImDrawData* draw_data) noexcept -> leaf::result<void>;
+		[[nodiscard]] auto end_frame() noexcept -> leaf::result<void>;
+
+		// Drops the frame begun, if any, after one of the calls above failed. Readers only ever see complete frames.
+		auto abort_frame() noexcept -> void;
+	};
+
+	// One decoded frame, owning the ImDrawLists its ImDrawData point at.
+	struct draw_capture_frame
+	{
+		struct viewport
+		{
+			ImGuiID									 m_id{0};
+			std::vector<std::unique_ptr<ImDrawList>> m_lists;
+			std::vector<ImDrawList*>				 m_list_ptrs;
+			ImDrawData								 m_draw_data;
+		};
+
+		std::vector<viewport> m_viewports;
+	};
+
+	// A capture file mapped for reading, with its frames indexed up front.
+	struct draw_capture
+	{
+		mapped_file				 m_file;
+		std::vector<std::size_t> m_frame_offsets;
+
+		using texture_resolver = std::function<ImTextureID(std::uint64_t)>;
+
+		[[nodiscard]] auto open(const char* path) noexcept -> leaf::result<void>;
+
+		[[nodiscard]] auto frame_count() const noexcept -> std::size_t
+		{
+			return m_frame_offsets.size();
+		}
+
+		// Decodes frame index into out, reusing its lists' storage. resolve maps captured texture ids to live ones.
+		[[nodiscard]] auto decode(std::size_t index, const texture_resolver& resolve, draw_capture_frame& out) const noexcept -> leaf::result<void>;
+	};
+} // namespace mu
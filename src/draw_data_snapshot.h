@@ -0,0 +1,90 @@
+#pragma once
+
+#include <imgui.h>
+
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace mu
+{
+	// The draw data of every viewport of one frame, taken over from ImGui without copying, or borrowed when it is rendered
+	// before ImGui starts the next frame.
+	//
+	// take() swaps the command, index and vertex buffers of each ImDrawList with lists of its own pool, so ImGui and the snapshot
+	// form a double buffer: ImGui builds the next frame into the buffers the previous snapshot rendered from. ImGui's own lists are
+	// left empty, with the capacity of the previous snapshot's, until the next NewFrame.
+	struct draw_data_snapshot
+	{
+		struct viewport
+		{
+			void*					 m_target{nullptr};
+			std::array<int, 2>		 m_size{0, 0};
+			std::vector<ImDrawList*> m_lists;
+			ImDrawData				 m_draw_data;
+			ImVec4					 m_damage{0.0f, 0.0f, 0.0f, 0.0f}; // what changed since the target's previous frame, see damage_tracker
+		};
+
+		std::vector<viewport>					 m_viewports;
+		std::vector<std::unique_ptr<ImDrawList>> m_pool;
+		std::size_t								 m_pool_used{0};
+
+		auto reset() -> void
+		{
+			m_viewports.clear();
+			m_pool_used = 0;
+		}
+
+		// Refers to ImGui's lists instead of taking them over, only valid until the context's next NewFrame.
+		auto borrow(void* target, std::array<int, 2> size, ImDrawData* source) -> void
+		{
+			if (source == nullptr || !source->Valid)
+			{
+				return;
+			}
+
+			auto& vp	   = m_viewports.emplace_back();
+			vp.m_target	   = target;
+			vp.m_size	   = size;
+			vp.m_draw_data = *source;
+		}
+
+		auto take(void* target, std::array<int, 2> size, ImDrawData* source) -> void
+		{
+			if (source == nullptr || !source->Valid)
+			{
+				return;
+			}
+
+			auto& vp	= m_viewports.emplace_back();
+			vp.m_target = target;
+			vp.m_size	= size;
+			vp.m_lists.reserve(static_cast<std::size_t>(source->CmdListsCount));
+
+			for (int n = 0; n < source->CmdListsCount; ++n)
+			{
+				if (m_pool_used == m_pool.size())
+				{
+					m_pool.push_back(std::make_unique<ImDrawList>(nullptr));
+				}
+
+				ImDrawList* src = source->CmdLists[n];
+				ImDrawList* dst = m_pool[m_pool_used++].get();
+				dst->CmdBuffer.swap(src->CmdBuffer);
+				dst->IdxBuffer.swap(src->IdxBuffer);
+				dst->VtxBuffer.swap(src->VtxBuffer);
+				dst->Flags = src->Flags;
+
+				// Keeps the capacity of the buffers handed back, without the frame before last in them
+				src->CmdBuffer.resize(0);
+				src->IdxBuffer.resize(0);
+				src->VtxBuffer.resize(0);
+				vp.m_lists.push_back(dst);
+			}
+
+			vp.m_draw_data				 = *source;
+			vp.m_draw_data.CmdLists		 = vp.m_lists.data();
+			vp.m_draw_data.CmdListsCount = static_cast<int>(vp.m_lists.size());
+		}
+	};
+} // namespace mu
@@ -0,0 +1,285 @@
+#include "mu_gfx.h"
+#include "mu_gfx_impl.h"
+
+#include "glyph_cache.h"
+#include "imgui_renderer.h"
+
+#include <imgui_internal.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace mu
+{
+	auto gfx_primitives_callback(const ImDrawList*, const ImDrawCmd*) -> void { }
+
+	namespace
+	{
+		[[nodiscard]] auto backend_data() noexcept -> const Diligent::imgui_backend_data*
+		{
+			return static_cast<const Diligent::imgui_backend_data*>(ImGui::GetIO().BackendRendererUserData);
+		}
+
+		[[nodiscard]] auto primitives_supported() noexcept -> bool
+		{
+			const auto* backend = backend_data();
+			return backend != nullptr && backend->m_shared_resources != nullptr && backend->m_shared_resources->m_primitive_pso != nullptr;
+		}
+
+		[[nodiscard]] auto quarter_pixels(float v) noexcept -> ImU32
+		{
+			return static_cast<ImU32>(std::clamp(v * 4.0f + 0.5f, 0.0f, 65535.0f));
+		}
+
+		// Makes room for count primitives at the end of the draw list, in its last batch when nothing was added since and the
+		// texture and clip rect are the same, else in a new one. Returns where their vertices go.
+		auto reserve_primitives(ImDrawList* draw_list, ImTextureID texture, int count) -> ImDrawVert*
+		{
+			const bool push_texture = draw_list->_CmdHeader.TextureId != texture;
+			if (push_texture)
+			{
+				draw_list->PushTextureID(texture);
+			}
+
+			// AddCallback always leaves an empty command after the callback's
+			const int  batch_index = draw_list->CmdBuffer.Size - 2;
+			const bool extend =
+				batch_index >= 0 && draw_list->CmdBuffer[batch_index].UserCallback == &gfx_primitives_callback && draw_list->CmdBuffer.back().ElemCount == 0 &&
+				draw_list->CmdBuffer.back().UserCallback == nullptr &&
+				draw_list->CmdBuffer[batch_index].VtxOffset + draw_list->CmdBuffer[batch_index].ElemCount * 2 == static_cast<unsigned int>(draw_list->VtxBuffer.Size) &&
+				draw_list->CmdBuffer[batch_index].TextureId == texture &&
+				std::memcmp(&draw_list->CmdBuffer[batch_index].ClipRect, &draw_list->_CmdHeader.ClipRect, sizeof(ImVec4)) == 0;
+
+			if (!extend)
+			{
+				draw_list->AddCallback(&gfx_primitives_callback, nullptr);
+				ImDrawCmd& batch = draw_list->CmdBuffer[draw_list->CmdBuffer.Size - 2];
+				batch.VtxOffset	 = static_cast<unsigned int>(draw_list->VtxBuffer.Size);
+				batch.ElemCount	 = 0;
+			}
+
+			// The vertices take index space like any others, so geometry added after them is indexed correctly. PrimReserve moves
+			// the last command's VtxOffset when 16-bit indices run out, the batch stays where it is.
+			draw_list->PrimReserve(0, count * 2);
+			draw_list->CmdBuffer[draw_list->CmdBuffer.Size - 2].ElemCount += static_cast<unsigned int>(count);
+
+			ImDrawVert* vtx = draw_list->_VtxWritePtr;
+			draw_list->_VtxWritePtr += count * 2;
+			draw_list->_VtxCurrentIdx += static_cast<unsigned int>(count * 2);
+
+			if (push_texture)
+			{
+				draw_list->PopTextureID();
+			}
+			return vtx;
+		}
+
+		// Gives back the last count primitives reserved and not written.
+		auto unreserve_primitives(ImDrawList* draw_list, int count) -> void
+		{
+			draw_list->CmdBuffer[draw_list->CmdBuffer.Size - 2].ElemCount -= static_cast<unsigned int>(count);
+			draw_list->VtxBuffer.shrink(draw_list->VtxBuffer.Size - count * 2);
+			draw_list->_VtxWritePtr -= count * 2;
+			draw_list->_VtxCurrentIdx -= static_cast<unsigned int>(count * 2);
+		}
+
+		auto write_primitive(ImDrawVert* vtx, const ImVec2& p_min, const ImVec2& p_max, const ImVec2& uv_min, const ImVec2& uv_max, ImU32 col, float rounding, float thickness)
+			-> void
+		{
+			vtx[0] = ImDrawVert{p_min, uv_min, col};
+			vtx[1] = ImDrawVert{p_max, uv_max, quarter_pixels(rounding) | quarter_pixels(thickness) << 16};
+		}
+
+		auto add_shape(ImDrawList* draw_list, const ImVec2& p_min, const ImVec2& p_max, ImU32 col, float rounding, float thickness) -> void
+		{
+			ImDrawVert* vtx = reserve_primitives(draw_list, draw_list->_Data->Font->ContainerAtlas->TexID, 1);
+			write_primitive(vtx, p_min, p_max, draw_list->_Data->TexUvWhitePixel, draw_list->_Data->TexUvWhitePixel, col, rounding, thickness);
+		}
+	} // namespace
+
+	auto gfx_add_rect(ImDrawList* draw_list, const ImVec2& p_min, const ImVec2& p_max, ImU32 col, float rounding, float thickness) noexcept -> void
+	{
+		if ((col & IM_COL32_A_MASK) == 0 || thickness <= 0.0f)
+		{
+			return;
+		}
+		if (!primitives_supported())
+		{
+			draw_list->AddRect(p_min, p_max, col, rounding, ImDrawFlags_None, thickness);
+			return;
+		}
+
+		// ImDrawList strokes a path half a pixel inside the rect, the outline grows both ways from it
+		const float outset = thickness * 0.5f - 0.5f;
+		add_shape(
+			draw_list,
+			ImVec2(p_min.x - outset, p_min.y - outset),
+			ImVec2(p_max.x + outset, p_max.y + outset),
+			col,
+			rounding > 0.0f ? std::max(rounding + outset, 0.0f) : 0.0f,
+			thickness);
+	}
+
+	auto gfx_add_rect_filled(ImDrawList* draw_list, const ImVec2& p_min, const ImVec2& p_max, ImU32 col, float rounding) noexcept -> void
+	{
+		if ((col & IM_COL32_A_MASK) == 0)
+		{
+			return;
+		}
+		if (!primitives_supported())
+		{
+			draw_list->AddRectFilled(p_min, p_max, col, rounding);
+			return;
+		}
+		add_shape(draw_list, p_min, p_max, col, rounding, 0.0f);
+	}
+
+	auto gfx_add_circle(ImDrawList* draw_list, const ImVec2& center, float radius, ImU32 col, float thickness) noexcept -> void
+	{
+		if ((col & IM_COL32_A_MASK) == 0 || radius <= 0.0f || thickness <= 0.0f)
+		{
+			return;
+		}
+		if (!primitives_supported())
+		{
+			draw_list->AddCircle(center, radius, col, 0, thickness);
+			return;
+		}
+
+		// As ImDrawList, the stroke is centred half a pixel inside the radius
+		const float outer = radius - 0.5f + thickness * 0.5f;
+		add_shape(draw_list, ImVec2(center.x - outer, center.y - outer), ImVec2(center.x + outer, center.y + outer), col, outer, thickness);
+	}
+
+	auto gfx_add_circle_filled(ImDrawList* draw_list, const ImVec2& center, float radius, ImU32 col) noexcept -> void
+	{
+		if ((col & IM_COL32_A_MASK) == 0 || radius <= 0.0f)
+		{
+			return;
+		}
+		if (!primitives_supported())
+		{
+			draw_list->AddCircleFilled(center, radius, col);
+			return;
+		}
+		add_shape(draw_list, ImVec2(center.x - radius, center.y - radius), ImVec2(center.x + radius, center.y + radius), col, radius, 0.0f);
+	}
+
+	auto gfx_add_text(ImDrawList* draw_list, ImFont* font, float font_size, const ImVec2& pos, ImU32 col, const char* text_begin, const char* text_end) noexcept -> void
+	{
+		if ((col & IM_COL32_A_MASK) == 0)
+		{
+			return;
+		}
+		if (text_end == nullptr)
+		{
+			text_end = text_begin + std::strlen(text_begin);
+		}
+		if (text_begin == text_end)
+		{
+			return;
+		}
+
+		// As with AddText, the draw list's current font and size unless given
+		if (font == nullptr)
+		{
+			font = draw_list->_Data->Font;
+		}
+		if (font_size == 0.0f)
+		{
+			font_size = draw_list->_Data->FontSize;
+		}
+
+		if (!primitives_supported())
+		{
+			draw_list->AddText(font, font_size, pos, col, text_begin, text_end);
+			return;
+		}
+
+		const auto*		 backend = backend_data();
+		mu::glyph_cache* cache	 = backend->m_font_resources != nullptr ? backend->m_font_resources->m_glyph_cache.get() : nullptr;
+
+		// At most one glyph per byte, what is not used is given back. Glyphs of the cache are batched with their page.
+		ImTextureID texture	 = font->ContainerAtlas->TexID;
+		int			reserved = static_cast<int>(text_end - text_begin);
+		ImDrawVert* vtx		 = reserve_primitives(draw_list, texture, reserved);
+		int			written	 = 0;
+
+		const ImVec4 clip  = draw_list->_CmdHeader.ClipRect;
+		const float	 scale = font_size / font->FontSize;
+		const float	 x0	   = IM_FLOOR(pos.x);
+		float		 x	   = x0;
+		float		 y	   = IM_FLOOR(pos.y);
+
+		for (const char* s = text_begin; s < text_end;)
+		{
+			const char*	 glyph_begin = s;
+			unsigned int c			 = static_cast<unsigned int>(static_cast<unsigned char>(*s));
+			if (c < 0x80)
+			{
+				s += 1;
+			}
+			else
+			{
+				s += ImTextCharFromUtf8(&c, s, text_end);
+				if (c == 0)
+				{
+					break;
+				}
+			}
+
+			if (c == '\n')
+			{
+				x = x0;
+				y += font_size;
+				continue;
+			}
+			if (c == '\r')
+			{
+				continue;
+			}
+
+			// What the atlas does not have may be in the cache, in the cache's font pixels
+			const ImFontGlyph* glyph		 = font->FindGlyphNoFallback(static_cast<ImWchar>(c));
+			ImTextureID		   glyph_texture = font->ContainerAtlas->TexID;
+			float			   glyph_scale	 = scale;
+			ImFontGlyph		   cached;
+			if (glyph == nullptr && cache != nullptr && cache->find(c, cached, glyph_texture))
+			{
+				glyph		= &cached;
+				glyph_scale = font_size / cache->m_size_pixels;
+			}
+			if (glyph == nullptr)
+			{
+				glyph = font->FallbackGlyph;
+				if (glyph == nullptr)
+				{
+					continue;
+				}
+			}
+
+			const ImVec2 p_min(x + glyph->X0 * glyph_scale, y + glyph->Y0 * glyph_scale);
+			const ImVec2 p_max(x + glyph->X1 * glyph_scale, y + glyph->Y1 * glyph_scale);
+			if (glyph->Visible && p_max.x > clip.x && p_min.x < clip.z && p_max.y > clip.y && p_min.y < clip.w)
+			{
+				if (glyph_texture != texture)
+				{
+					// The rest of the text has at most a glyph per byte left, this one's included
+					unreserve_primitives(draw_list, reserved - written);
+					texture	 = glyph_texture;
+					reserved = static_cast<int>(text_end - glyph_begin);
+					vtx		 = reserve_primitives(draw_list, texture, reserved);
+					written	 = 0;
+				}
+
+				// Coloured glyphs keep their colours, only alpha is applied, as ImFont::RenderText does
+				const ImU32 glyph_col = glyph->Colored ? (col | ~IM_COL32_A_MASK) : col;
+				write_primitive(vtx + written * 2, p_min, p_max, ImVec2(glyph->U0, glyph->V0), ImVec2(glyph->U1, glyph->V1), glyph_col, 0.0f, 0.0f);
+				++written;
+			}
+			x += glyph->AdvanceX * glyph_scale;
+		}
+
+		unreserve_primitives(draw_list, reserved - written);
+	}
+} // namespace mu
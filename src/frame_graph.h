@@ -0,0 +1,214 @@
+#pragma once
+
+#include <mu_gfx.h>
+#include <mu_gfx_trace.h>
+
+#include <memory>
+#include <vector>
+
+namespace mu
+{
+	// The task graphs gfx_interface::run_frame runs the frame stages of its windows with: one small taskflow per window and stage,
+	// built when the set of windows changes and reused by every frame after.
+	//
+	// The sync stages and begin_frame_async, which creates a window's GLFW callbacks and swap chain on its first frame, run on the
+	// calling thread, in window order, as GLFW requires. With MU_GFX_THREAD_LOCAL_IMGUI each window's flows start as soon as its own
+	// sync stage returns, so the calling thread's work for one window overlaps the workers' for the others. Otherwise every thread
+	// shares the current ImGui context, which every stage sets, so they all run on the calling thread one window after the other
+	// and the executor is left idle.
+	//
+	// A window whose stage fails skips its remaining stages up to begin_imgui_sync. Once that succeeded, end_imgui_async,
+	// end_imgui_sync and end_frame always run, so the ImGui frame it opened is closed. The first error of the first window that
+	// failed is what run returns, after every window finished its stages.
+	struct frame_graph
+	{
+		struct window_flows
+		{
+			gfx_window*					m_key{nullptr};	   // what the flows were built for
+			std::shared_ptr<gfx_window> m_window;		   // only while a frame runs, so that closed windows are not kept alive
+			tf::Taskflow				m_imgui;		   // the UI, then end_imgui_async
+			tf::Taskflow				m_end;			   // end_frame
+			leaf::result<void>			m_result;		   // the first error of the frame
+			bool						m_in_imgui{false}; // begin_imgui_sync succeeded
+		};
+
+		std::vector<std::unique_ptr<window_flows>> m_windows;
+		const gfx_ui_callback*					   m_ui{nullptr}; // only while a frame runs
+
+		frame_graph() = default;
+
+		frame_graph(const frame_graph&)			   = delete;
+		frame_graph& operator=(const frame_graph&) = delete;
+
+		[[nodiscard]] auto run([[maybe_unused]] tf::Executor& executor, const std::vector<std::shared_ptr<gfx_window>>& windows, const gfx_ui_callback& ui) noexcept
+			-> leaf::result<void>
+		try
+		{
+			MU_GFX_TRACE_SCOPE("run_frame");
+			if (!built_for(windows))
+			{
+				build(windows);
+			}
+
+			for (std::size_t n = 0; n < windows.size(); n++)
+			{
+				m_windows[n]->m_window	 = windows[n];
+				m_windows[n]->m_result	 = {};
+				m_windows[n]->m_in_imgui = false;
+			}
+			m_ui = &ui;
+
+#ifdef MU_GFX_THREAD_LOCAL_IMGUI
+			std::vector<tf::Future<void>> pending;
+			pending.reserve(m_windows.size());
+			for (auto& w : m_windows)
+			{
+				stage(*w, &gfx_window::begin_frame_async);
+				begin_imgui(*w);
+				pending.push_back(executor.run(w->m_imgui));
+			}
+
+			for (std::size_t n = 0; n < m_windows.size(); n++)
+			{
+				pending[n].wait();
+				closing_stage(*m_windows[n], &gfx_window::end_imgui_sync);
+				pending[n] = executor.run(m_windows[n]->m_end);
+			}
+			wait(pending);
+#else
+			for (auto& w : m_windows)
+			{
+				stage(*w, &gfx_window::begin_frame_async);
+			}
+			for (auto& w : m_windows)
+			{
+				begin_imgui(*w);
+				ui_stage(*w);
+				closing_stage(*w, &gfx_window::end_imgui_async);
+			}
+			for (auto& w : m_windows)
+			{
+				closing_stage(*w, &gfx_window::end_imgui_sync);
+			}
+			for (auto& w : m_windows)
+			{
+				closing_stage(*w, &gfx_window::end_frame);
+			}
+#endif
+
+			leaf::result<void> result;
+			for (auto& w : m_windows)
+			{
+				if (result && !w->m_result) [[unlikely]]
+				{
+					result = std::move(w->m_result);
+				}
+				w->m_result = {};
+				w->m_window.reset();
+			}
+			m_ui = nullptr;
+			return result;
+		}
+		catch (...)
+		{
+			return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+		}
+
+	private:
+		[[nodiscard]] auto built_for(const std::vector<std::shared_ptr<gfx_window>>& windows) const noexcept -> bool
+		{
+			if (windows.size() != m_windows.size())
+			{
+				return false;
+			}
+			for (std::size_t n = 0; n < windows.size(); n++)
+			{
+				if (windows[n].get() != m_windows[n]->m_key)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		auto build(const std::vector<std::shared_ptr<gfx_window>>& windows) -> void
+		{
+			MU_GFX_TRACE_SCOPE("build_frame_graph");
+			m_windows.clear();
+			for (auto& window : windows)
+			{
+				auto  flows = std::make_unique<window_flows>();
+				auto* w		= flows.get();
+				w->m_key	= window.get();
+
+#ifdef MU_GFX_THREAD_LOCAL_IMGUI
+				auto ui		   = w->m_imgui.emplace([this, w]() { ui_stage(*w); }).name("ui");
+				auto end_imgui = w->m_imgui.emplace([w]() { closing_stage(*w, &gfx_window::end_imgui_async); }).name("end_imgui");
+				ui.precede(end_imgui);
+
+				w->m_end.emplace([w]() { closing_stage(*w, &gfx_window::end_frame); }).name("end_frame");
+#endif
+				m_windows.push_back(std::move(flows));
+			}
+		}
+
+		using window_stage = auto (gfx_window::*)() noexcept -> leaf::result<void>;
+
+		// Runs one stage of w up to begin_imgui_sync unless an earlier one failed this frame.
+		static auto stage(window_flows& w, window_stage func) noexcept -> void
+		{
+			if (w.m_result)
+			{
+				w.m_result = (w.m_window.get()->*func)();
+			}
+		}
+
+		static auto begin_imgui(window_flows& w) noexcept -> void
+		{
+			stage(w, &gfx_window::begin_imgui_sync);
+			w.m_in_imgui = static_cast<bool>(w.m_result);
+		}
+
+		// Runs one stage of w from end_imgui_async on, whatever failed since begin_imgui_sync, keeping the first error.
+		static auto closing_stage(window_flows& w, window_stage func) noexcept -> void
+		{
+			if (!w.m_in_imgui)
+			{
+				return;
+			}
+			auto result = (w.m_window.get()->*func)();
+			if (w.m_result && !result) [[unlikely]]
+			{
+				w.m_result = std::move(result);
+			}
+		}
+
+		auto ui_stage(window_flows& w) noexcept -> void
+		try
+		{
+			MU_GFX_TRACE_SCOPE("ui");
+			if (!w.m_result)
+			{
+				return;
+			}
+			if (auto current = w.m_window->make_current(); !current) [[unlikely]]
+			{
+				w.m_result = std::move(current);
+				return;
+			}
+			w.m_result = (*m_ui)(w.m_window);
+		}
+		catch (...)
+		{
+			w.m_result = MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+		}
+
+		static auto wait(std::vector<tf::Future<void>>& pending) -> void
+		{
+			for (auto& f : pending)
+			{
+				f.wait();
+			}
+		}
+	};
+} // namespace mu
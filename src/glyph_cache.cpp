@@ -0,0 +1,389 @@
+#include "mu_gfx_impl.h"
+
+#include "glyph_cache.h"
+#include "imgui_renderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// A private copy, imgui_draw.cpp compiles its own as static as well
+#define STBTT_STATIC
+#define STB_TRUETYPE_IMPLEMENTATION
+#include <imstb_truetype.h>
+
+namespace mu
+{
+	struct glyph_cache::font_face
+	{
+		stbtt_fontinfo m_info{};
+		float		   m_scale{0.0f};
+	};
+
+	namespace
+	{
+		// Shelf packing: glyphs go left to right on a shelf as tall as the tallest of them, a full shelf opens the next one below.
+		[[nodiscard]] auto fit(glyph_cache::page& p, int width, int height, int& x, int& y) noexcept -> bool
+		{
+			if (p.m_shelf_x + width > glyph_cache::s_page_size)
+			{
+				p.m_shelf_y += p.m_shelf_height;
+				p.m_shelf_x		 = 0;
+				p.m_shelf_height = 0;
+			}
+			if (width > glyph_cache::s_page_size || p.m_shelf_y + height > glyph_cache::s_page_size)
+			{
+				return false;
+			}
+
+			x = p.m_shelf_x;
+			y = p.m_shelf_y;
+			p.m_shelf_x += width;
+			p.m_shelf_height = std::max(p.m_shelf_height, height);
+			return true;
+		}
+
+		auto mark_dirty(glyph_cache::page& p, int min_row, int max_row) noexcept -> void
+		{
+			if (p.m_dirty_max <= p.m_dirty_min)
+			{
+				p.m_dirty_min = min_row;
+				p.m_dirty_max = max_row;
+			}
+			else
+			{
+				p.m_dirty_min = std::min(p.m_dirty_min, min_row);
+				p.m_dirty_max = std::max(p.m_dirty_max, max_row);
+			}
+		}
+	} // namespace
+
+	glyph_cache::glyph_cache(Diligent::IRenderDevice* device, float size_pixels, float baseline, int spread, bool alpha8)
+		: m_device(device)
+		, m_size_pixels(size_pixels)
+		, m_baseline(baseline)
+		, m_spread(spread)
+		, m_texel_size(alpha8 ? 1 : 4)
+	{ }
+
+	glyph_cache::~glyph_cache() = default;
+
+	auto glyph_cache::open(const char* path) noexcept -> leaf::result<void>
+	try
+	{
+		MU_LEAF_CHECK(m_file.open_read(path));
+
+		auto		face   = std::make_unique<font_face>();
+		const auto* data   = reinterpret_cast<const unsigned char*>(m_file.m_data);
+		const int	offset = stbtt_GetFontOffsetForIndex(data, 0);
+		if (offset < 0 || !stbtt_InitFont(&face->m_info, data, offset)) [[unlikely]]
+		{
+			return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+		}
+
+		// As ImGui sizes atlas fonts: the size is the height from ascent to descent
+		face->m_scale = stbtt_ScaleForPixelHeight(&face->m_info, m_size_pixels);
+		m_face		  = std::move(face);
+		return {};
+	}
+	catch (...)
+	{
+		return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+	}
+
+	glyph_cache::frame_ticket::frame_ticket(std::shared_ptr<glyph_cache> cache, std::uint64_t ticket) noexcept
+		: m_cache(std::move(cache))
+		, m_ticket(ticket)
+	{ }
+
+	glyph_cache::frame_ticket::frame_ticket(frame_ticket&& other) noexcept
+		: m_cache(std::move(other.m_cache))
+		, m_ticket(other.m_ticket)
+	{ }
+
+	auto glyph_cache::frame_ticket::operator=(frame_ticket&& other) noexcept -> frame_ticket&
+	{
+		if (this != &other)
+		{
+			reset();
+			m_cache	 = std::move(other.m_cache);
+			m_ticket = other.m_ticket;
+		}
+		return *this;
+	}
+
+	glyph_cache::frame_ticket::~frame_ticket()
+	{
+		reset();
+	}
+
+	auto glyph_cache::frame_ticket::reset() noexcept -> void
+	{
+		if (m_cache)
+		{
+			std::unique_lock lock(m_cache->m_mutex);
+			m_cache->m_in_flight.erase(m_ticket);
+			lock.unlock();
+			m_cache.reset();
+		}
+	}
+
+	auto glyph_cache::begin_frame(const void* user) -> frame_ticket
+	{
+		std::unique_lock lock(m_mutex);
+		auto [itor, first] = m_user_frames.try_emplace(user, m_frame);
+		if (!first && itor->second == m_frame)
+		{
+			++m_frame;
+		}
+		itor->second = m_frame;
+
+		m_in_flight.insert(++m_last_ticket);
+		return frame_ticket(shared_from_this(), m_last_ticket);
+	}
+
+	// Neither drawn lately nor by a frame whose draw data may still refer to its texture
+	auto glyph_cache::releasable(const page& p) const noexcept -> bool
+	{
+		return p.m_last_used + s_keep_frames < m_frame && (m_in_flight.empty() || p.m_last_ticket < *m_in_flight.begin());
+	}
+
+	auto glyph_cache::find(unsigned int c, ImFontGlyph& glyph, ImTextureID& texture) noexcept -> bool
+	try
+	{
+		std::unique_lock lock(m_mutex);
+		if (!m_face)
+		{
+			return false;
+		}
+
+		auto itor = m_entries.find(c);
+		if (itor == m_entries.end())
+		{
+			// Without room nothing is remembered, there may be some next frame
+			entry e;
+			if (!rasterise(c, e))
+			{
+				return false;
+			}
+			itor = m_entries.emplace(c, e).first;
+		}
+
+		const entry& e = itor->second;
+		if (!e.m_found)
+		{
+			return false;
+		}
+
+		glyph	= e.m_glyph;
+		texture = nullptr;
+		if (e.m_page >= 0)
+		{
+			auto& p			= m_pages[static_cast<std::size_t>(e.m_page)];
+			p.m_last_used	= m_frame;
+			p.m_last_ticket = m_last_ticket;
+			texture			= (ImTextureID)p.m_srv.RawPtr();
+		}
+		return true;
+	}
+	catch (...)
+	{
+		return false;
+	}
+
+	// Makes e the glyph of c, placed on a page. False when there was no room for it.
+	auto glyph_cache::rasterise(unsigned int c, entry& e) -> bool
+	{
+		const int index = stbtt_FindGlyphIndex(&m_face->m_info, static_cast<int>(c));
+		if (index == 0)
+		{
+			return true;
+		}
+
+		const float scale	= m_face->m_scale;
+		int			advance = 0, lsb = 0;
+		int			x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+		stbtt_GetGlyphHMetrics(&m_face->m_info, index, &advance, &lsb);
+		stbtt_GetGlyphBitmapBox(&m_face->m_info, index, scale, scale, &x0, &y0, &x1, &y1);
+
+		e.m_found			  = true;
+		e.m_glyph.Codepoint	  = c;
+		e.m_glyph.AdvanceX	  = static_cast<float>(advance) * scale;
+		e.m_glyph.Visible	  = x1 > x0 && y1 > y0;
+		if (!e.m_glyph.Visible)
+		{
+			return true;
+		}
+
+		// The distance field needs room around the glyph, a texel more keeps filtering from reaching the next one
+		const int width	 = x1 - x0 + 2 * m_spread;
+		const int height = y1 - y0 + 2 * m_spread;
+		if (width >= s_page_size || height >= s_page_size) [[unlikely]]
+		{
+			e.m_found = false;
+			return true;
+		}
+
+		int x = 0, y = 0;
+		e.m_page = allocate(width + 1, height + 1, x, y);
+		if (e.m_page < 0)
+		{
+			return false;
+		}
+
+		std::vector<unsigned char> coverage(static_cast<std::size_t>(width) * height, 0);
+		stbtt_MakeGlyphBitmap(&m_face->m_info, coverage.data() + m_spread * width + m_spread, x1 - x0, y1 - y0, width, scale, scale, index);
+		if (m_spread > 0)
+		{
+			std::vector<unsigned char> field(coverage.size());
+			Diligent::distance_field(coverage.data(), width, height, m_spread, field.data(), width);
+			coverage.swap(field);
+		}
+
+		auto& p = m_pages[static_cast<std::size_t>(e.m_page)];
+		for (int row = 0; row < height; row++)
+		{
+			unsigned char*		 dst = p.m_pixels.data() + ((y + row) * s_page_size + x) * m_texel_size;
+			const unsigned char* src = coverage.data() + row * width;
+			if (m_texel_size == 1)
+			{
+				std::memcpy(dst, src, static_cast<std::size_t>(width));
+				continue;
+			}
+			for (int col = 0; col < width; col++)
+			{
+				std::memset(dst + col * 4, 255, 3);
+				dst[col * 4 + 3] = src[col];
+			}
+		}
+		mark_dirty(p, y, y + height);
+		p.m_code_points.push_back(c);
+
+		e.m_glyph.X0 = static_cast<float>(x0 - m_spread);
+		e.m_glyph.Y0 = m_baseline + static_cast<float>(y0 - m_spread);
+		e.m_glyph.X1 = static_cast<float>(x1 + m_spread);
+		e.m_glyph.Y1 = m_baseline + static_cast<float>(y1 + m_spread);
+		e.m_glyph.U0 = static_cast<float>(x) / s_page_size;
+		e.m_glyph.V0 = static_cast<float>(y) / s_page_size;
+		e.m_glyph.U1 = static_cast<float>(x + width) / s_page_size;
+		e.m_glyph.V1 = static_cast<float>(y + height) / s_page_size;
+		return true;
+	}
+
+	// Finds room in a page, in a new one or, as a last resort, in the least recently drawn one emptied. Returns its index or -1.
+	auto glyph_cache::allocate(int width, int height, int& x, int& y) -> int
+	{
+		for (std::size_t n = 0; n < m_pages.size(); n++)
+		{
+			if (m_pages[n].m_texture && fit(m_pages[n], width, height, x, y))
+			{
+				return static_cast<int>(n);
+			}
+		}
+
+		// An empty page takes any glyph up to its size, what is larger is not worth creating or emptying one for
+		if (width > s_page_size || height > s_page_size)
+		{
+			return -1;
+		}
+
+		// Trimmed pages leave their slots for new ones
+		auto trimmed = std::find_if(m_pages.begin(), m_pages.end(), [](const page& p) { return !p.m_texture; });
+		if (trimmed != m_pages.end() || m_pages.size() < s_max_pages)
+		{
+			Diligent::TextureDesc desc;
+			desc.Name	   = "Glyph cache page";
+			desc.Type	   = Diligent::RESOURCE_DIM_TEX_2D;
+			desc.Width	   = s_page_size;
+			desc.Height	   = s_page_size;
+			desc.Format	   = m_texel_size == 1 ? Diligent::TEX_FORMAT_R8_UNORM : Diligent::TEX_FORMAT_RGBA8_UNORM;
+			desc.BindFlags = Diligent::BIND_SHADER_RESOURCE;
+			desc.Usage	   = Diligent::USAGE_DEFAULT;
+
+			page p;
+			m_device->CreateTexture(desc, nullptr, &p.m_texture);
+			if (!p.m_texture) [[unlikely]]
+			{
+				return -1;
+			}
+			p.m_srv = p.m_texture->GetDefaultView(Diligent::TEXTURE_VIEW_SHADER_RESOURCE);
+			p.m_pixels.assign(static_cast<std::size_t>(s_page_size) * s_page_size * m_texel_size, 0);
+			mark_dirty(p, 0, s_page_size);
+
+			if (trimmed == m_pages.end())
+			{
+				trimmed = m_pages.insert(m_pages.end(), std::move(p));
+			}
+			else
+			{
+				*trimmed = std::move(p);
+			}
+			return fit(*trimmed, width, height, x, y) ? static_cast<int>(trimmed - m_pages.begin()) : -1;
+		}
+
+		auto lru = std::min_element(m_pages.begin(), m_pages.end(), [](const page& a, const page& b) { return a.m_last_used < b.m_last_used; });
+		if (!releasable(*lru))
+		{
+			return -1;
+		}
+
+		for (unsigned int c : lru->m_code_points)
+		{
+			m_entries.erase(c);
+		}
+		lru->m_code_points.clear();
+		std::fill(lru->m_pixels.begin(), lru->m_pixels.end(), 0);
+		lru->m_shelf_x		= 0;
+		lru->m_shelf_y		= 0;
+		lru->m_shelf_height = 0;
+		mark_dirty(*lru, 0, s_page_size);
+
+		return fit(*lru, width, height, x, y) ? static_cast<int>(lru - m_pages.begin()) : -1;
+	}
+
+	auto glyph_cache::upload(render_context* ctx) noexcept -> void
+	{
+		std::unique_lock lock(m_mutex);
+		for (auto& p : m_pages)
+		{
+			if (p.m_texture && p.m_dirty_max > p.m_dirty_min)
+			{
+				// Whole rows, so the data holds the stride of each
+				const Diligent::Box box(0, s_page_size, static_cast<Diligent::Uint32>(p.m_dirty_min), static_cast<Diligent::Uint32>(p.m_dirty_max));
+				const auto stride = static_cast<Diligent::Uint32>(s_page_size * m_texel_size);
+				ctx->update_texture(p.m_srv, box, p.m_pixels.data() + p.m_dirty_min * stride, stride);
+				p.m_dirty_min = 0;
+				p.m_dirty_max = 0;
+			}
+		}
+	}
+
+	auto glyph_cache::trim() noexcept -> void
+	{
+		std::unique_lock lock(m_mutex);
+		for (auto& p : m_pages)
+		{
+			if (p.m_texture && releasable(p))
+			{
+				for (unsigned int c : p.m_code_points)
+				{
+					m_entries.erase(c);
+				}
+				p = page{};
+			}
+		}
+	}
+
+	auto glyph_cache::memory(std::uint64_t& gpu_bytes, std::uint64_t& cpu_bytes) noexcept -> void
+	{
+		std::unique_lock lock(m_mutex);
+		for (const auto& p : m_pages)
+		{
+			if (p.m_texture)
+			{
+				gpu_bytes += static_cast<std::uint64_t>(s_page_size) * s_page_size * m_texel_size;
+				cpu_bytes += p.m_pixels.capacity();
+			}
+		}
+	}
+} // namespace mu
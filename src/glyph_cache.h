@@ -0,0 +1,126 @@
+#pragma once
+
+#include <mu_gfx.h>
+
+#include "mapped_file.h"
+#include "render_context.h"
+
+#include <Graphics/GraphicsEngine/interface/RenderDevice.h>
+#include <Graphics/GraphicsEngine/interface/Texture.h>
+#include <Graphics/GraphicsEngine/interface/TextureView.h>
+#include <Common/interface/RefCntAutoPtr.hpp>
+
+#include <imgui.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+namespace mu
+{
+	// Glyphs of a font file rasterised the first time gfx_add_text draws them, for the code points the ImGui atlas was not built
+	// with, so the glyphs gfx_add_text draws from such ranges, e.g. CJK, cost time and texture memory only once used. It covers
+	// gfx_add_text only: ImGui's own text still draws from the atlas alone, and shows its fallback glyph for what the atlas lacks.
+	//
+	// Glyphs are packed in shelves into pages of s_page_size texels, kept in memory and uploaded a band of dirty rows per page at a
+	// time. When no page has room the least recently drawn one is emptied, unless it was drawn during the last s_keep_frames frames
+	// or by a frame still in flight, whose draw data may wait to be rendered; a glyph that finds no room is left out like a
+	// missing one. Frames are counted once for all windows, see begin_frame.
+	//
+	// find() runs on the ImGui threads of every window and upload() on the submission thread, both lock.
+	struct glyph_cache : public std::enable_shared_from_this<glyph_cache>
+	{
+		static constexpr int		   s_page_size	 = 512;
+		static constexpr std::size_t   s_max_pages	 = 8;
+		static constexpr std::uint64_t s_keep_frames = 16;
+
+		struct page
+		{
+			Diligent::RefCntAutoPtr<Diligent::ITexture>		m_texture;
+			Diligent::RefCntAutoPtr<Diligent::ITextureView> m_srv;
+			std::vector<unsigned char>						m_pixels;	   // m_texel_size each: white with the coverage or distance in alpha, or that alpha alone
+			std::vector<unsigned int>						m_code_points; // of the glyphs packed here, none once trimmed
+			int												m_shelf_x{0};
+			int												m_shelf_y{0};
+			int												m_shelf_height{0};
+			int												m_dirty_min{0}; // rows not uploaded yet, none when m_dirty_max <= m_dirty_min
+			int												m_dirty_max{0};
+			std::uint64_t									m_last_used{0};	  // frame, see begin_frame
+			std::uint64_t									m_last_ticket{0}; // of the latest frame begun when it was last drawn
+		};
+
+		// One window's frame in flight from begin_frame, as long as it is held: until its draw data is recorded, or dropped.
+		struct frame_ticket
+		{
+			std::shared_ptr<glyph_cache> m_cache;
+			std::uint64_t				 m_ticket{0};
+
+			frame_ticket() = default;
+			frame_ticket(std::shared_ptr<glyph_cache> cache, std::uint64_t ticket) noexcept;
+			frame_ticket(frame_ticket&& other) noexcept;
+			frame_ticket& operator=(frame_ticket&& other) noexcept;
+			~frame_ticket();
+
+			auto reset() noexcept -> void;
+		};
+
+		struct entry
+		{
+			ImFontGlyph m_glyph{};
+			int			m_page{-1}; // -1 when there is nothing to draw: no such glyph, or an invisible one
+			bool		m_found{false};
+		};
+
+		struct font_face; // stb_truetype's view of m_file
+
+		Diligent::RefCntAutoPtr<Diligent::IRenderDevice> m_device;
+		mapped_file										 m_file;
+		std::unique_ptr<font_face>						 m_face;
+		const float										 m_size_pixels;
+		const float										 m_baseline;	// of the atlas font the glyphs line up with, from the top of a line
+		const int										 m_spread;		// distance fields when not 0, see imgui_font_resources
+		const int										 m_texel_size; // 1 for single channel pages, as the atlas with alpha8
+
+		std::mutex									   m_mutex;
+		std::vector<page>							   m_pages;
+		std::unordered_map<unsigned int, entry>		   m_entries;
+		std::uint64_t								   m_frame{0};		 // frames of the window that began the most
+		std::unordered_map<const void*, std::uint64_t> m_user_frames;	 // the frame each window last began
+		std::uint64_t								   m_last_ticket{0}; // of the latest frame begun
+		std::set<std::uint64_t>						   m_in_flight;		 // tickets not given back yet
+
+		glyph_cache(Diligent::IRenderDevice* device, float size_pixels, float baseline, int spread, bool alpha8);
+		~glyph_cache();
+
+		glyph_cache(const glyph_cache&)			   = delete;
+		glyph_cache& operator=(const glyph_cache&) = delete;
+
+		[[nodiscard]] auto open(const char* path) noexcept -> leaf::result<void>;
+
+		// Starts a frame of the window user, before its UI draws with the cache. The frame pages are measured in advances when a
+		// window begins its second frame since the last advance, so it follows the busiest window whatever the number of windows.
+		[[nodiscard]] auto begin_frame(const void* user) -> frame_ticket;
+
+		// The glyph of c in font pixels and the page it is on, rasterised now if it was not yet. Invisible glyphs come with no
+		// texture. False when the font has no such glyph or there is no room for it.
+		[[nodiscard]] auto find(unsigned int c, ImFontGlyph& glyph, ImTextureID& texture) noexcept -> bool;
+
+		// Uploads what find() added since the last call.
+		auto upload(render_context* ctx) noexcept -> void;
+
+		// Frees the pages not drawn during the last s_keep_frames frames nor by a frame in flight, their glyphs are rasterised again
+		// when next drawn.
+		auto trim() noexcept -> void;
+
+		// Bytes of the pages' textures and of their copies in memory.
+		auto memory(std::uint64_t& gpu_bytes, std::uint64_t& cpu_bytes) noexcept -> void;
+
+	private:
+		[[nodiscard]] auto rasterise(unsigned int c, entry& e) -> bool;
+		[[nodiscard]] auto allocate(int width, int height, int& x, int& y) -> int;
+		[[nodiscard]] auto releasable(const page& p) const noexcept -> bool;
+	};
+} // namespace mu
@@ -0,0 +1,110 @@
+#include "mu_gfx_impl.h"
+
+#include "imgui_heap.h"
+
+#include <imgui.h>
+
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+namespace mu
+{
+	namespace
+	{
+		struct heap
+		{
+			std::atomic<std::int64_t> m_bytes{0};
+			std::atomic<bool>		  m_owned{false};
+		};
+
+		std::array<heap, s_imgui_heaps> g_heaps;
+		thread_local std::uint32_t		g_current_heap = 0;
+
+		// Ahead of each allocation: its size and heap, padded so that ImGui's pointer is as aligned as malloc's
+		struct header
+		{
+			std::uint64_t m_size;
+			std::uint32_t m_heap;
+		};
+		static constexpr std::size_t s_header_size = (sizeof(header) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+
+		auto heap_alloc(std::size_t size, void*) -> void*
+		{
+			auto* block = static_cast<unsigned char*>(std::malloc(s_header_size + size));
+			if (block == nullptr) [[unlikely]]
+			{
+				return nullptr;
+			}
+
+			const header h{size, g_current_heap};
+			std::memcpy(block, &h, sizeof(h));
+			g_heaps[h.m_heap].m_bytes.fetch_add(static_cast<std::int64_t>(size), std::memory_order_relaxed);
+			return block + s_header_size;
+		}
+
+		auto heap_free(void* ptr, void*) -> void
+		{
+			if (ptr == nullptr)
+			{
+				return;
+			}
+
+			auto*  block = static_cast<unsigned char*>(ptr) - s_header_size;
+			header h;
+			std::memcpy(&h, block, sizeof(h));
+			g_heaps[h.m_heap].m_bytes.fetch_sub(static_cast<std::int64_t>(h.m_size), std::memory_order_relaxed);
+			std::free(block);
+		}
+	} // namespace
+
+	auto install_imgui_heap() noexcept -> void
+	{
+		static std::once_flag once;
+		std::call_once(once, []() { ImGui::SetAllocatorFunctions(&heap_alloc, &heap_free, nullptr); });
+	}
+
+	auto acquire_imgui_heap() noexcept -> std::uint32_t
+	{
+		for (std::uint32_t n = 1; n < s_imgui_heaps; n++)
+		{
+			bool owned = false;
+			if (g_heaps[n].m_bytes.load(std::memory_order_relaxed) == 0 && g_heaps[n].m_owned.compare_exchange_strong(owned, true))
+			{
+				return n;
+			}
+		}
+		return 0;
+	}
+
+	auto release_imgui_heap(std::uint32_t heap) noexcept -> void
+	{
+		if (heap != 0)
+		{
+			g_heaps[heap].m_owned.store(false);
+		}
+	}
+
+	auto set_current_imgui_heap(std::uint32_t heap) noexcept -> void
+	{
+		g_current_heap = heap;
+	}
+
+	scoped_imgui_heap::scoped_imgui_heap(std::uint32_t heap) noexcept : m_previous(g_current_heap)
+	{
+		g_current_heap = heap;
+	}
+
+	scoped_imgui_heap::~scoped_imgui_heap()
+	{
+		g_current_heap = m_previous;
+	}
+
+	auto imgui_heap_bytes(std::uint32_t heap) noexcept -> std::uint64_t
+	{
+		const auto bytes = g_heaps[heap].m_bytes.load(std::memory_order_relaxed);
+		return bytes > 0 ? static_cast<std::uint64_t>(bytes) : 0;
+	}
+} // namespace mu
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <mu_gfx.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace mu
+{
+	// Counts what ImGui allocates, per heap. An allocation is charged to the heap current on the thread that makes it and given
+	// back to that same heap when freed, on whichever thread. Heap 0 collects what is allocated outside of any window, e.g. by the
+	// shared font atlas, and by windows beyond s_imgui_heaps.
+	//
+	// install_imgui_heap makes ImGui allocate through the counters and must run before ImGui allocates anything, whatever freed
+	// later having to come from them.
+	inline constexpr std::uint32_t s_imgui_heaps = 64;
+
+	auto install_imgui_heap() noexcept -> void;
+
+	// A heap of its own whose previous owner's allocations are all freed, else heap 0.
+	[[nodiscard]] auto acquire_imgui_heap() noexcept -> std::uint32_t;
+	auto			   release_imgui_heap(std::uint32_t heap) noexcept -> void;
+
+	// Charges the calling thread's allocations to heap from now on.
+	auto set_current_imgui_heap(std::uint32_t heap) noexcept -> void;
+
+	// Charges the calling thread's allocations to heap while it lives, then to the heap that was current before again.
+	struct scoped_imgui_heap
+	{
+		explicit scoped_imgui_heap(std::uint32_t heap) noexcept;
+		~scoped_imgui_heap();
+
+		scoped_imgui_heap(const scoped_imgui_heap&)			  = delete;
+		scoped_imgui_heap& operator=(const scoped_imgui_heap&) = delete;
+
+		const std::uint32_t m_previous;
+	};
+
+	[[nodiscard]] auto imgui_heap_bytes(std::uint32_t heap) noexcept -> std::uint64_t;
+} // namespace mu
@@ -28,10 +28,28 @@
 #include <cstddef>
 #include "imgui_renderer.h"
 
-#include <Graphics/GraphicsTools/interface/MapHelper.hpp>
+#include <mu_gfx_trace.h>
+
+#include "glyph_cache.h"
+#include "render_context.h"
+
 #include <Graphics/GraphicsEngine/interface/RenderDevice.h>
 #include <Graphics/GraphicsEngine/interface/DeviceContext.h>
 
+#include <imgui_internal.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#	include <emmintrin.h>
+#	define MU_GFX_SSE2
+#endif
+
 namespace Diligent
 {
 	static const char* g_vertex_shader_hlsl = R"(
@@ -60,6 +78,35 @@ void main(in VSInput VSIn, out PSInput PSIn)
     PSIn.col = VSIn.col;
     PSIn.uv  = VSIn.uv;
 }
+)";
+
+	// Same as g_vertex_shader_hlsl for imgui_compact_vert: quarter pixels from the display origin, which the projection accounts for.
+	static const char* g_vertex_shader_compact_hlsl = R"(
+cbuffer Constants
+{
+    float4x4 ProjectionMatrix;
+}
+
+struct VSInput
+{
+    int2   pos : ATTRIB0;
+    float2 uv  : ATTRIB1;
+    float4 col : ATTRIB2;
+};
+
+struct PSInput
+{
+    float4 pos : SV_POSITION;
+    float4 col : COLOR;
+    float2 uv  : TEXCOORD;
+};
+
+void main(in VSInput VSIn, out PSInput PSIn)
+{
+    PSIn.pos = mul(ProjectionMatrix, float4(float2(VSIn.pos), 0.0, 1.0));
+    PSIn.col = VSIn.col;
+    PSIn.uv  = VSIn.uv;
+}
 )";
 
 	static const char* g_pixel_shader_hlsl = R"(
@@ -77,6 +124,33 @@ float4 main(in PSInput PSIn) : SV_Target
 {
     return PSIn.col * Texture.Sample(Texture_sampler, PSIn.uv);
 }
+)";
+
+	// For a font atlas that is not plain RGBA coverage. With ALPHA8_FONT it is a single channel, read as white with that alpha.
+	// With SDF_FONT it holds distance fields: alpha is 0.5 on a glyph's edge and grows inwards, coverage is taken over the width of
+	// a pixel at whatever size the glyph is drawn. Solid texels such as the white one stay opaque.
+	static const char* g_pixel_shader_font_hlsl = R"(
+struct PSInput
+{
+    float4 pos : SV_POSITION;
+    float4 col : COLOR;
+    float2 uv  : TEXCOORD;
+};
+
+Texture2D    Texture;
+SamplerState Texture_sampler;
+
+float4 main(in PSInput PSIn) : SV_Target
+{
+    float4 texel = Texture.Sample(Texture_sampler, PSIn.uv);
+#ifdef ALPHA8_FONT
+    texel = float4(1.0, 1.0, 1.0, texel.r);
+#endif
+#ifdef SDF_FONT
+    texel.a = saturate((texel.a - 0.5) / max(fwidth(texel.a), 1e-4) + 0.5);
+#endif
+    return PSIn.col * texel;
+}
 )";
 
 	static const char* g_vertex_shader_glsl = R"(
@@ -112,6 +186,42 @@ void main()
     vsout_col = in_col;
     vsout_uv  = in_uv;
 }
+)";
+
+	// Also compiled for Vulkan, there is no precompiled SPIR-V of it.
+	static const char* g_vertex_shader_compact_glsl = R"(
+#ifdef VULKAN
+#   define BINDING(X) layout(binding=X)
+#   define OUT_LOCATION(X) layout(location=X) // Requires separable programs
+#else
+#   define BINDING(X)
+#   define OUT_LOCATION(X)
+#endif
+BINDING(0) uniform Constants
+{
+    mat4 ProjectionMatrix;
+};
+
+layout(location = 0) in ivec2 in_pos;
+layout(location = 1) in vec2 in_uv;
+layout(location = 2) in vec4 in_col;
+
+OUT_LOCATION(0) out vec4 vsout_col;
+OUT_LOCATION(1) out vec2 vsout_uv;
+
+#ifndef GL_ES
+out gl_PerVertex
+{
+    vec4 gl_Position;
+};
+#endif
+
+void main()
+{
+    gl_Position = ProjectionMatrix * vec4(vec2(in_pos), 0.0, 1.0);
+    vsout_col = in_col;
+    vsout_uv  = in_uv;
+}
 )";
 
 	static const char* g_pixel_shader_glsl = R"(
@@ -133,6 +243,220 @@ void main()
 {
     psout_col = vsout_col * texture(Texture, vsout_uv);
 }
+)";
+
+	// Also compiled for Vulkan, there is no precompiled SPIR-V of it.
+	static const char* g_pixel_shader_font_glsl = R"(
+#ifdef VULKAN
+#   define BINDING(X) layout(binding=X)
+#   define IN_LOCATION(X) layout(location=X) // Requires separable programs
+#else
+#   define BINDING(X)
+#   define IN_LOCATION(X)
+#endif
+BINDING(0) uniform sampler2D Texture;
+
+IN_LOCATION(0) in vec4 vsout_col;
+IN_LOCATION(1) in vec2 vsout_uv;
+
+layout(location = 0) out vec4 psout_col;
+
+void main()
+{
+    vec4 texel = texture(Texture, vsout_uv);
+#ifdef ALPHA8_FONT
+    texel = vec4(1.0, 1.0, 1.0, texel.r);
+#endif
+#ifdef SDF_FONT
+    texel.a = clamp((texel.a - 0.5) / max(fwidth(texel.a), 1e-4) + 0.5, 0.0, 1.0);
+#endif
+    psout_col = vsout_col * texel;
+}
+)";
+
+	// The primitive pipeline draws each primitive of mu::gfx_primitives_callback as an instanced quad. An instance is the two corner
+	// vertices of a primitive, the second one's colour holding its rounding and outline thickness in quarter pixels. POS_TYPE and
+	// POS_UNITS, the type of the corner positions and their units per display pixel, are defined for the vertex format in use.
+	static const char* g_primitive_vertex_shader_hlsl = R"(
+cbuffer Constants
+{
+    float4x4 ProjectionMatrix;
+}
+
+struct VSInput
+{
+    POS_TYPE min    : ATTRIB0;
+    float2   uv_min : ATTRIB1;
+    float4   col    : ATTRIB2;
+    POS_TYPE max    : ATTRIB3;
+    float2   uv_max : ATTRIB4;
+    uint2    shape  : ATTRIB5;
+};
+
+struct PSInput
+{
+    float4 pos   : SV_POSITION;
+    float4 col   : COLOR;
+    float2 uv    : TEXCOORD0;
+    float2 local : TEXCOORD1;
+    nointerpolation float4 shape : TEXCOORD2;
+};
+
+void main(in VSInput VSIn, in uint vertex_id : SV_VertexID, out PSInput PSIn)
+{
+    float2 lo        = float2(VSIn.min);
+    float2 hi        = float2(VSIn.max);
+    float  radius    = float(VSIn.shape.x) * 0.25 * POS_UNITS;
+    float  thickness = float(VSIn.shape.y) * 0.25 * POS_UNITS;
+
+    // Antialiased shapes get a pixel of room around them, plain quads such as glyphs are drawn as they are
+    float  expand = (radius > 0.0 || thickness > 0.0) ? POS_UNITS : 0.0;
+    float2 corner = float2(vertex_id & 1, vertex_id >> 1);
+    float2 pos    = lerp(lo - expand, hi + expand, corner);
+
+    PSIn.pos   = mul(ProjectionMatrix, float4(pos, 0.0, 1.0));
+    PSIn.col   = VSIn.col;
+    PSIn.uv    = lerp(VSIn.uv_min, VSIn.uv_max, (pos - lo) / max(hi - lo, 1e-3));
+    PSIn.local = pos - (lo + hi) * 0.5;
+    PSIn.shape = float4((hi - lo) * 0.5, radius, thickness);
+}
+)";
+
+	static const char* g_primitive_pixel_shader_hlsl = R"(
+struct PSInput
+{
+    float4 pos   : SV_POSITION;
+    float4 col   : COLOR;
+    float2 uv    : TEXCOORD0;
+    float2 local : TEXCOORD1;
+    nointerpolation float4 shape : TEXCOORD2;
+};
+
+Texture2D    Texture;
+SamplerState Texture_sampler;
+
+float4 main(in PSInput PSIn) : SV_Target
+{
+    float2 half_size = PSIn.shape.xy;
+    float  radius    = min(PSIn.shape.z, min(half_size.x, half_size.y));
+    float  thickness = PSIn.shape.w;
+
+    // Signed distance to the rounded box, or to the band of its outline
+    float2 q    = abs(PSIn.local) - half_size + radius;
+    float  dist = length(max(q, 0.0)) + min(max(q.x, q.y), 0.0) - radius;
+    if (thickness > 0.0)
+        dist = abs(dist + thickness * 0.5) - thickness * 0.5;
+
+    float4 texel = Texture.Sample(Texture_sampler, PSIn.uv);
+#ifdef ALPHA8_FONT
+    texel = float4(1.0, 1.0, 1.0, texel.r);
+#endif
+#ifdef SDF_FONT
+    texel.a = saturate((texel.a - 0.5) / max(fwidth(texel.a), 1e-4) + 0.5);
+#endif
+
+    float  coverage = (PSIn.shape.z > 0.0 || thickness > 0.0) ? saturate(0.5 - dist / max(fwidth(dist), 1e-4)) : 1.0;
+    float4 col      = PSIn.col * texel;
+    col.a *= coverage;
+    return col;
+}
+)";
+
+	// Also compiled for Vulkan, there is no precompiled SPIR-V of the primitive shaders. ALPHA8_FONT and SDF_FONT are defined as for
+	// the font pixel shader: every texture primitives sample is the font atlas or a glyph cache page.
+	static const char* g_primitive_vertex_shader_glsl = R"(
+#ifdef VULKAN
+#   define BINDING(X) layout(binding=X)
+#   define OUT_LOCATION(X) layout(location=X) // Requires separable programs
+#   define VERTEX_ID gl_VertexIndex
+#else
+#   define BINDING(X)
+#   define OUT_LOCATION(X)
+#   define VERTEX_ID gl_VertexID
+#endif
+BINDING(0) uniform Constants
+{
+    mat4 ProjectionMatrix;
+};
+
+layout(location = 0) in POS_TYPE in_min;
+layout(location = 1) in vec2 in_uv_min;
+layout(location = 2) in vec4 in_col;
+layout(location = 3) in POS_TYPE in_max;
+layout(location = 4) in vec2 in_uv_max;
+layout(location = 5) in uvec2 in_shape;
+
+OUT_LOCATION(0) out vec4 vsout_col;
+OUT_LOCATION(1) out vec2 vsout_uv;
+OUT_LOCATION(2) out vec2 vsout_local;
+OUT_LOCATION(3) flat out vec4 vsout_shape;
+
+#ifndef GL_ES
+out gl_PerVertex
+{
+    vec4 gl_Position;
+};
+#endif
+
+void main()
+{
+    vec2  lo        = vec2(in_min);
+    vec2  hi        = vec2(in_max);
+    float radius    = float(in_shape.x) * 0.25 * POS_UNITS;
+    float thickness = float(in_shape.y) * 0.25 * POS_UNITS;
+
+    float expand = (radius > 0.0 || thickness > 0.0) ? POS_UNITS : 0.0;
+    vec2  corner = vec2(float(VERTEX_ID & 1), float(VERTEX_ID >> 1));
+    vec2  pos    = mix(lo - expand, hi + expand, corner);
+
+    gl_Position = ProjectionMatrix * vec4(pos, 0.0, 1.0);
+    vsout_col   = in_col;
+    vsout_uv    = mix(in_uv_min, in_uv_max, (pos - lo) / max(hi - lo, vec2(1e-3)));
+    vsout_local = pos - (lo + hi) * 0.5;
+    vsout_shape = vec4((hi - lo) * 0.5, radius, thickness);
+}
+)";
+
+	static const char* g_primitive_pixel_shader_glsl = R"(
+#ifdef VULKAN
+#   define BINDING(X) layout(binding=X)
+#   define IN_LOCATION(X) layout(location=X) // Requires separable programs
+#else
+#   define BINDING(X)
+#   define IN_LOCATION(X)
+#endif
+BINDING(0) uniform sampler2D Texture;
+
+IN_LOCATION(0) in vec4 vsout_col;
+IN_LOCATION(1) in vec2 vsout_uv;
+IN_LOCATION(2) in vec2 vsout_local;
+IN_LOCATION(3) flat in vec4 vsout_shape;
+
+layout(location = 0) out vec4 psout_col;
+
+void main()
+{
+    vec2  half_size = vsout_shape.xy;
+    float radius    = min(vsout_shape.z, min(half_size.x, half_size.y));
+    float thickness = vsout_shape.w;
+
+    vec2  q    = abs(vsout_local) - half_size + radius;
+    float dist = length(max(q, 0.0)) + min(max(q.x, q.y), 0.0) - radius;
+    if (thickness > 0.0)
+        dist = abs(dist + thickness * 0.5) - thickness * 0.5;
+
+    vec4 texel = texture(Texture, vsout_uv);
+#ifdef ALPHA8_FONT
+    texel = vec4(1.0, 1.0, 1.0, texel.r);
+#endif
+#ifdef SDF_FONT
+    texel.a = clamp((texel.a - 0.5) / max(fwidth(texel.a), 1e-4) + 0.5, 0.0, 1.0);
+#endif
+
+    float coverage = (vsout_shape.z > 0.0 || thickness > 0.0) ? clamp(0.5 - dist / max(fwidth(dist), 1e-4), 0.0, 1.0) : 1.0;
+    psout_col      = vsout_col * texel;
+    psout_col.a *= coverage;
+}
 )";
 
 	// glslangValidator.exe -V -e main --vn VertexShader_SPIRV ImGUI.vert
@@ -209,6 +533,22 @@ vertex VSOut vs_main(VSIn in [[stage_in]], constant VSConstants& Constants [[buf
     return out;
 }
 
+struct VSInCompact
+{
+    short2 pos [[attribute(0)]];
+    float2 uv  [[attribute(1)]];
+    float4 col [[attribute(2)]];
+};
+
+vertex VSOut vs_main_compact(VSInCompact in [[stage_in]], constant VSConstants& Constants [[buffer(0)]])
+{
+    VSOut out = {};
+    out.pos = Constants.ProjectionMatrix * float4(float2(in.pos), 0.0, 1.0);
+    out.col = in.col;
+    out.uv  = in.uv;
+    return out;
+}
+
 struct PSOut
 {
     float4 col [[color(0)]];
@@ -222,59 +562,84 @@ fragment PSOut ps_main(VSOut in [[stage_in]],
     out.col = in.col * Texture.sample(Texture_sampler, in.uv);
     return out;
 }
+
+float4 alpha8_texel(float4 texel)
+{
+    return float4(1.0, 1.0, 1.0, texel.r);
+}
+
+float4 sdf_texel(float4 texel)
+{
+    texel.a = saturate((texel.a - 0.5) / max(fwidth(texel.a), 1e-4) + 0.5);
+    return texel;
+}
+
+fragment PSOut ps_main_sdf(VSOut in [[stage_in]],
+                           texture2d<float> Texture [[texture(0)]],
+                           sampler Texture_sampler  [[sampler(0)]])
+{
+    PSOut out = {};
+    out.col = in.col * sdf_texel(Texture.sample(Texture_sampler, in.uv));
+    return out;
+}
+
+fragment PSOut ps_main_alpha8(VSOut in [[stage_in]],
+                              texture2d<float> Texture [[texture(0)]],
+                              sampler Texture_sampler  [[sampler(0)]])
+{
+    PSOut out = {};
+    out.col = in.col * alpha8_texel(Texture.sample(Texture_sampler, in.uv));
+    return out;
+}
+
+fragment PSOut ps_main_sdf_alpha8(VSOut in [[stage_in]],
+                                  texture2d<float> Texture [[texture(0)]],
+                                  sampler Texture_sampler  [[sampler(0)]])
+{
+    PSOut out = {};
+    out.col = in.col * sdf_texel(alpha8_texel(Texture.sample(Texture_sampler, in.uv)));
+    return out;
+}
 )";
 } // namespace Diligent
 
 namespace Diligent
 {
-	imgui_shared_resources::imgui_shared_resources(IRenderDevice* render_device, TEXTURE_FORMAT back_buffer_fmt, TEXTURE_FORMAT depth_buffer_fmt, float scale)
+	imgui_shared_resources::imgui_shared_resources(
+		IRenderDevice* render_device, TEXTURE_FORMAT back_buffer_fmt, TEXTURE_FORMAT depth_buffer_fmt, bool compact_vertices, bool sdf_fonts, bool alpha8_fonts)
 		: m_device(render_device)
 		, m_back_buffer_fmt(back_buffer_fmt)
 		, m_depth_buffer_fmt(depth_buffer_fmt)
-		, m_scale(scale)
+		, m_compact_vertices(compact_vertices)
+		, m_sdf_fonts(sdf_fonts)
+		, m_alpha8_fonts(alpha8_fonts)
 	{ }
 
 	auto imgui_shared_resources::invalidate_device_objects() noexcept -> mu::leaf::result<void>
 	{
-		invalidate_font_objects();
-
 		m_vertex_constant_buffer.Release();
 		m_pso.Release();
-		m_font_srv.Release();
 		m_srb.Release();
+		m_texture_var = nullptr;
+		m_font_pso.Release();
+		m_font_srb.Release();
+		m_font_texture_var = nullptr;
+		m_primitive_pso.Release();
+		m_primitive_srb.Release();
+		m_primitive_texture_var = nullptr;
 
 		return {};
 	}
 
-	auto imgui_shared_resources::invalidate_font_objects() noexcept -> mu::leaf::result<void>
-	{
-		m_font_srv.Release();
-		return {};
-	}
-
-	auto imgui_shared_resources::create_device_objects(float scale, bool force) noexcept -> mu::leaf::result<void>
+	auto imgui_shared_resources::create_device_objects(bool force) noexcept -> mu::leaf::result<void>
 	{
-		m_scale = scale;
-
-		bool assets_exist  = m_pso;
-		bool scale_matches = scale == m_scale;
-
-		if (!force && assets_exist && scale_matches) [[likely]]
+		if (!force && m_pso) [[likely]]
 		{
 			return {};
 		}
 
-		if (force || !assets_exist)
-		{
-			MU_LEAF_CHECK(invalidate_device_objects());
-			MU_LEAF_CHECK(create_device_objects());
-		}
-		else if (!scale_matches)
-		{
-			MU_LEAF_CHECK(invalidate_font_objects());
-		}
-
-		MU_LEAF_CHECK(create_fonts_texture(scale));
+		MU_LEAF_CHECK(invalidate_device_objects());
+		MU_LEAF_CHECK(create_device_objects());
 
 		return {};
 	}
@@ -293,23 +658,31 @@ namespace Diligent
 			switch (deviceCaps.DevType)
 			{
 			case RENDER_DEVICE_TYPE_VULKAN:
-				shader_ci.ByteCode	   = g_vertex_shader_spirv;
-				shader_ci.ByteCodeSize = sizeof(g_vertex_shader_spirv);
+				if (m_compact_vertices)
+				{
+					shader_ci.Source		 = g_vertex_shader_compact_glsl;
+					shader_ci.SourceLanguage = SHADER_SOURCE_LANGUAGE_GLSL;
+				}
+				else
+				{
+					shader_ci.ByteCode	   = g_vertex_shader_spirv;
+					shader_ci.ByteCodeSize = sizeof(g_vertex_shader_spirv);
+				}
 				break;
 
 			case RENDER_DEVICE_TYPE_D3D11:
 			case RENDER_DEVICE_TYPE_D3D12:
-				shader_ci.Source = g_vertex_shader_hlsl;
+				shader_ci.Source = m_compact_vertices ? g_vertex_shader_compact_hlsl : g_vertex_shader_hlsl;
 				break;
 
 			case RENDER_DEVICE_TYPE_GL:
 			case RENDER_DEVICE_TYPE_GLES:
-				shader_ci.Source = g_vertex_shader_glsl;
+				shader_ci.Source = m_compact_vertices ? g_vertex_shader_compact_glsl : g_vertex_shader_glsl;
 				break;
 
 			case RENDER_DEVICE_TYPE_METAL:
 				shader_ci.Source	 = g_shaders_msl;
-				shader_ci.EntryPoint = "vs_main";
+				shader_ci.EntryPoint = m_compact_vertices ? "vs_main_compact" : "vs_main";
 				break;
 
 			default:
@@ -319,6 +692,9 @@ namespace Diligent
 		}
 
 		{
+			// The compact vertex shader is compiled from source on Vulkan, the pixel shader never is
+			shader_ci.Source		  = nullptr;
+			shader_ci.SourceLanguage  = SHADER_SOURCE_LANGUAGE_DEFAULT;
 			shader_ci.Desc.ShaderType = SHADER_TYPE_PIXEL;
 			shader_ci.Desc.Name		  = "Imgui PS";
 			switch (deviceCaps.DevType)
@@ -382,8 +758,14 @@ namespace Diligent
 				{1, 0, 2, VT_FLOAT32},	  // uv
 				{2, 0, 4, VT_UINT8, True} // col
 			};
-		gfx_pipeline.InputLayout.NumElements	= _countof(vs_inputs);
-		gfx_pipeline.InputLayout.LayoutElements = vs_inputs;
+		LayoutElement vs_compact_inputs[] //
+			{
+				{0, 0, 2, VT_INT16, False}, // pos, quarter pixels
+				{1, 0, 2, VT_UINT16, True}, // uv
+				{2, 0, 4, VT_UINT8, True}	// col
+			};
+		gfx_pipeline.InputLayout.NumElements	= m_compact_vertices ? _countof(vs_compact_inputs) : _countof(vs_inputs);
+		gfx_pipeline.InputLayout.LayoutElements = m_compact_vertices ? vs_compact_inputs : vs_inputs;
 
 		ShaderResourceVariableDesc variables[] = {
 			{SHADER_TYPE_PIXEL, "Texture", SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC} //
@@ -412,171 +794,654 @@ namespace Diligent
 			m_device->CreateBuffer(buffer_desc, nullptr, &m_vertex_constant_buffer);
 		}
 		m_pso->GetStaticVariableByName(SHADER_TYPE_VERTEX, "Constants")->Set(m_vertex_constant_buffer);
-		return {};
-	}
 
-	auto imgui_shared_resources::create_fonts_texture(float scale) noexcept -> mu::leaf::result<void>
-	{
-		if (m_font_srv)
-		{
-			return {};
-		}
+		m_pso->CreateShaderResourceBinding(&m_srb, true);
+		m_texture_var = m_srb->GetVariableByName(SHADER_TYPE_PIXEL, "Texture");
+		VERIFY_EXPR(m_texture_var != nullptr);
 
-		// Build texture atlas
-		ImGuiIO& io = ImGui::GetIO();
+		const bool		  glsl		   = deviceCaps.DevType != RENDER_DEVICE_TYPE_D3D11 && deviceCaps.DevType != RENDER_DEVICE_TYPE_D3D12;
+		const std::string font_defines = std::string(m_sdf_fonts ? "#define SDF_FONT\n" : "") + (m_alpha8_fonts ? "#define ALPHA8_FONT\n" : "");
+		if (m_sdf_fonts || m_alpha8_fonts)
+		{
+			// Same as the ImGui pipeline but for the pixel shader, compiled from source everywhere
+			const std::string font_ps = font_defines + (glsl ? g_pixel_shader_font_glsl : g_pixel_shader_font_hlsl);
 
-		io.Fonts->ClearFonts();
+			shader_ci.ByteCode		  = nullptr;
+			shader_ci.ByteCodeSize	  = 0;
+			shader_ci.SourceLanguage  = SHADER_SOURCE_LANGUAGE_DEFAULT;
+			shader_ci.Desc.ShaderType = SHADER_TYPE_PIXEL;
+			shader_ci.Desc.Name		  = "Imgui font PS";
+			switch (deviceCaps.DevType)
+			{
+			case RENDER_DEVICE_TYPE_VULKAN:
+			case RENDER_DEVICE_TYPE_GL:
+			case RENDER_DEVICE_TYPE_GLES:
+				shader_ci.Source		 = font_ps.c_str();
+				shader_ci.SourceLanguage = SHADER_SOURCE_LANGUAGE_GLSL;
+				break;
+
+			case RENDER_DEVICE_TYPE_D3D11:
+			case RENDER_DEVICE_TYPE_D3D12:
+				shader_ci.Source = font_ps.c_str();
+				break;
+
+			case RENDER_DEVICE_TYPE_METAL:
+				shader_ci.Source	 = g_shaders_msl;
+				shader_ci.EntryPoint = m_sdf_fonts ? (m_alpha8_fonts ? "ps_main_sdf_alpha8" : "ps_main_sdf") : "ps_main_alpha8";
+				break;
+
+			default:
+				UNEXPECTED("Unknown render device type");
+			}
+			m_device->CreateShader(shader_ci, &m_font_ps);
+
+			pso_create_info.PSODesc.Name = "ImGUI font PSO";
+			pso_create_info.pPS			 = m_font_ps;
+			m_device->CreateGraphicsPipelineState(pso_create_info, &m_font_pso);
+			m_font_pso->GetStaticVariableByName(SHADER_TYPE_VERTEX, "Constants")->Set(m_vertex_constant_buffer);
+
+			m_font_pso->CreateShaderResourceBinding(&m_font_srb, true);
+			m_font_texture_var = m_font_srb->GetVariableByName(SHADER_TYPE_PIXEL, "Texture");
+			VERIFY_EXPR(m_font_texture_var != nullptr);
+		}
+
+		// The primitive pipeline only has HLSL and GLSL shaders; without it gfx_add_* fall back to ImDrawList geometry
+		if (deviceCaps.DevType == RENDER_DEVICE_TYPE_METAL)
+		{
+			return {};
+		}
+
+		const std::string defines =
+			std::string("#define POS_TYPE ") + (m_compact_vertices ? (glsl ? "ivec2" : "int2") : (glsl ? "vec2" : "float2")) + "\n#define POS_UNITS " +
+			(m_compact_vertices ? "4.0" : "1.0") + "\n";
+		const std::string primitive_vs = defines + (glsl ? g_primitive_vertex_shader_glsl : g_primitive_vertex_shader_hlsl);
+		const std::string primitive_ps = font_defines + (glsl ? g_primitive_pixel_shader_glsl : g_primitive_pixel_shader_hlsl);
+
+		ShaderCreateInfo primitive_shader_ci;
+		primitive_shader_ci.UseCombinedTextureSamplers = true;
+		primitive_shader_ci.SourceLanguage			   = glsl ? SHADER_SOURCE_LANGUAGE_GLSL : SHADER_SOURCE_LANGUAGE_HLSL;
+
+		primitive_shader_ci.Desc.ShaderType = SHADER_TYPE_VERTEX;
+		primitive_shader_ci.Desc.Name		= "Imgui primitive VS";
+		primitive_shader_ci.Source			= primitive_vs.c_str();
+		m_device->CreateShader(primitive_shader_ci, &m_primitive_vs);
+
+		primitive_shader_ci.Desc.ShaderType = SHADER_TYPE_PIXEL;
+		primitive_shader_ci.Desc.Name		= "Imgui primitive PS";
+		primitive_shader_ci.Source			= primitive_ps.c_str();
+		m_device->CreateShader(primitive_shader_ci, &m_primitive_ps);
+
+		// Same state as the ImGui pipeline, but a quad per instance read straight from the corner vertices
+		pso_create_info.PSODesc.Name   = "ImGUI primitive PSO";
+		pso_create_info.pVS			   = m_primitive_vs;
+		pso_create_info.pPS			   = m_primitive_ps;
+		gfx_pipeline.PrimitiveTopology = PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+
+		const auto	  corner_offset	  = static_cast<Uint32>(m_compact_vertices ? sizeof(imgui_compact_vert) : sizeof(ImDrawVert));
+		const auto	  instance_stride = corner_offset * 2;
+		const auto	  pos_type		  = m_compact_vertices ? VT_INT16 : VT_FLOAT32;
+		const auto	  uv_type		  = m_compact_vertices ? VT_UINT16 : VT_FLOAT32;
+		const auto	  uv_offset		  = static_cast<Uint32>(m_compact_vertices ? offsetof(imgui_compact_vert, m_uv) : offsetof(ImDrawVert, uv));
+		const auto	  col_offset	  = static_cast<Uint32>(m_compact_vertices ? offsetof(imgui_compact_vert, m_col) : offsetof(ImDrawVert, col));
+		LayoutElement primitive_inputs[] //
+			{
+				{0, 0, 2, pos_type, False, 0, instance_stride, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE},								  // min
+				{1, 0, 2, uv_type, True, uv_offset, instance_stride, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE},						  // uv_min
+				{2, 0, 4, VT_UINT8, True, col_offset, instance_stride, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE},						  // col
+				{3, 0, 2, pos_type, False, corner_offset, instance_stride, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE},					  // max
+				{4, 0, 2, uv_type, True, corner_offset + uv_offset, instance_stride, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE},		  // uv_max
+				{5, 0, 2, VT_UINT16, False, corner_offset + col_offset, instance_stride, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE} // rounding, thickness
+			};
+		gfx_pipeline.InputLayout.NumElements	= _countof(primitive_inputs);
+		gfx_pipeline.InputLayout.LayoutElements = primitive_inputs;
+
+		m_device->CreateGraphicsPipelineState(pso_create_info, &m_primitive_pso);
+		m_primitive_pso->GetStaticVariableByName(SHADER_TYPE_VERTEX, "Constants")->Set(m_vertex_constant_buffer);
+
+		m_primitive_pso->CreateShaderResourceBinding(&m_primitive_srb, true);
+		m_primitive_texture_var = m_primitive_srb->GetVariableByName(SHADER_TYPE_PIXEL, "Texture");
+		VERIFY_EXPR(m_primitive_texture_var != nullptr);
+		return {};
+	}
+
+	auto distance_field(const unsigned char* coverage, int width, int height, int spread, unsigned char* out, int out_stride) noexcept -> void
+	{
+		auto inside = [&](int x, int y) -> bool
+		{
+			return x >= 0 && y >= 0 && x < width && y < height && coverage[y * width + x] >= 128;
+		};
+
+		for (int y = 0; y < height; y++)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				// Squared distance to the nearest texel on the other side of the edge, as far as the spread reaches
+				const bool in	   = inside(x, y);
+				int		   nearest = (spread + 1) * (spread + 1);
+				for (int dy = -spread; dy <= spread; dy++)
+				{
+					for (int dx = -spread; dx <= spread; dx++)
+					{
+						if (inside(x + dx, y + dy) != in)
+						{
+							nearest = std::min(nearest, dx * dx + dy * dy);
+						}
+					}
+				}
+
+				// Right next to the edge the texel's coverage places it better than distances between texels do
+				const float distance =
+					nearest == 1 ? coverage[y * width + x] / 255.0f - 0.5f : (in ? 1.0f : -1.0f) * (std::sqrt(static_cast<float>(nearest)) - 0.5f);
+				out[y * out_stride + x] = static_cast<unsigned char>(std::lround(std::clamp(127.5f + distance * 127.5f / spread, 0.0f, 255.0f)));
+			}
+		}
+	}
+
+	// Replaces the coverage of every visible glyph in atlas' alpha texture by its distance field, growing the glyph by spread texels
+	// on each side, clamped to the texture, to make room for it. Glyphs must be packed at least twice spread apart. Custom rects,
+	// such as the white texel and the mouse cursors, keep their coverage.
+	static auto build_distance_fields(ImFontAtlas* atlas, unsigned char* alpha, int width, int height, int spread) -> void
+	{
+		std::vector<unsigned char> custom;
+		for (const ImFontAtlasCustomRect& rect : atlas->CustomRects)
+		{
+			for (int y = rect.Y; rect.IsPacked() && y < rect.Y + rect.Height; y++)
+			{
+				custom.insert(custom.end(), alpha + y * width + rect.X, alpha + y * width + rect.X + rect.Width);
+			}
+		}
+
+		std::vector<unsigned char> coverage;
+		for (ImFont* font : atlas->Fonts)
+		{
+			for (ImFontGlyph& glyph : font->Glyphs)
+			{
+				const int x0 = static_cast<int>(std::lround(glyph.U0 * width));
+				const int y0 = static_cast<int>(std::lround(glyph.V0 * height));
+				const int x1 = static_cast<int>(std::lround(glyph.U1 * width));
+				const int y1 = static_cast<int>(std::lround(glyph.V1 * height));
+				if (!glyph.Visible || x1 <= x0 || y1 <= y0)
+				{
+					continue;
+				}
+
+				const int gx0 = std::max(x0 - spread, 0);
+				const int gy0 = std::max(y0 - spread, 0);
+				const int gx1 = std::min(x1 + spread, width);
+				const int gy1 = std::min(y1 + spread, height);
+				const int gw  = gx1 - gx0;
+				const int gh  = gy1 - gy0;
+
+				coverage.resize(static_cast<std::size_t>(gw) * gh);
+				for (int y = 0; y < gh; y++)
+				{
+					std::memcpy(coverage.data() + y * gw, alpha + (gy0 + y) * width + gx0, gw);
+				}
+				distance_field(coverage.data(), gw, gh, spread, alpha + gy0 * width + gx0, width);
+
+				const float units_x = (glyph.X1 - glyph.X0) / static_cast<float>(x1 - x0);
+				const float units_y = (glyph.Y1 - glyph.Y0) / static_cast<float>(y1 - y0);
+				glyph.X0 -= (x0 - gx0) * units_x;
+				glyph.Y0 -= (y0 - gy0) * units_y;
+				glyph.X1 += (gx1 - x1) * units_x;
+				glyph.Y1 += (gy1 - y1) * units_y;
+				glyph.U0 = static_cast<float>(gx0) / width;
+				glyph.V0 = static_cast<float>(gy0) / height;
+				glyph.U1 = static_cast<float>(gx1) / width;
+				glyph.V1 = static_cast<float>(gy1) / height;
+			}
+		}
+
+		const unsigned char* saved = custom.data();
+		for (const ImFontAtlasCustomRect& rect : atlas->CustomRects)
+		{
+			for (int y = rect.Y; rect.IsPacked() && y < rect.Y + rect.Height; y++)
+			{
+				std::memcpy(alpha + y * width + rect.X, saved, rect.Width);
+				saved += rect.Width;
+			}
+		}
+	}
+
+	imgui_font_resources::imgui_font_resources(IRenderDevice* render_device, bool sdf, bool alpha8, std::string glyph_font)
+		: m_device(render_device)
+		, m_sdf(sdf)
+		, m_alpha8(alpha8)
+		, m_glyph_font(std::move(glyph_font))
+	{ }
+
+	auto imgui_font_resources::invalidate_font_objects() noexcept -> mu::leaf::result<void>
+	{
+		m_font_srv.Release();
+		m_font_tex.Release();
+		m_glyph_cache.reset();
+		return {};
+	}
+
+	auto imgui_font_resources::create_fonts_texture(float scale, bool force) noexcept -> mu::leaf::result<void>
+	try
+	{
+		if (!force && m_font_srv && (m_sdf || scale == m_scale)) [[likely]]
+		{
+			return {};
+		}
+
+		MU_LEAF_CHECK(invalidate_font_objects());
+
+		// Build texture atlas
+		ImFontAtlas* atlas = m_atlas.get();
+
+		atlas->ClearFonts();
+
+		// Distance fields are drawn at any size, they are only ever built at s_sdf_scale
+		if (m_sdf)
+		{
+			scale = s_sdf_scale;
+		}
 
 		ImFontConfig cfg;
 		cfg.SizePixels = 13 * scale;
-		io.Fonts->AddFontDefault(&cfg);
+		atlas->AddFontDefault(&cfg);
 
 		unsigned char* pixels = nullptr;
 		int			   width = 0, height = 0;
-		io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+		if (m_sdf)
+		{
+			// Room around each glyph for its field, and no baked lines, whose ramps would be read as distances
+			atlas->Flags |= ImGuiFontAtlasFlags_NoBakedLines;
+			atlas->TexGlyphPadding = 2 * s_sdf_spread;
+			atlas->GetTexDataAsAlpha8(&pixels, &width, &height);
+			build_distance_fields(atlas, pixels, width, height, s_sdf_spread);
+		}
+
+		// Made from the alpha texture as it is now, when there is one. A single channel is expanded by the font pipeline.
+		if (m_alpha8)
+		{
+			atlas->GetTexDataAsAlpha8(&pixels, &width, &height);
+		}
+		else
+		{
+			atlas->GetTexDataAsRGBA32(&pixels, &width, &height);
+		}
 
 		TextureDesc font_tex_desc;
 		font_tex_desc.Name		= "Imgui font texture";
 		font_tex_desc.Type		= RESOURCE_DIM_TEX_2D;
 		font_tex_desc.Width		= static_cast<Uint32>(width);
 		font_tex_desc.Height	= static_cast<Uint32>(height);
-		font_tex_desc.Format	= TEX_FORMAT_RGBA8_UNORM;
+		font_tex_desc.Format	= m_alpha8 ? TEX_FORMAT_R8_UNORM : TEX_FORMAT_RGBA8_UNORM;
 		font_tex_desc.BindFlags = BIND_SHADER_RESOURCE;
 		font_tex_desc.Usage		= USAGE_IMMUTABLE;
 
-		TextureSubResData mip_0_data[] = {{pixels, font_tex_desc.Width * 4}};
+		TextureSubResData mip_0_data[] = {{pixels, font_tex_desc.Width * (m_alpha8 ? 1 : 4)}};
 		TextureData		  init_data(mip_0_data, _countof(mip_0_data));
 
 		m_device->CreateTexture(font_tex_desc, &init_data, &m_font_tex);
-		m_scale = scale;
+		m_scale	   = scale;
+		m_white_uv = atlas->TexUvWhitePixel;
 
-		m_font_srv = m_font_tex->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+		m_font_srv	 = m_font_tex->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+		atlas->TexID = (ImTextureID)m_font_srv;
 
-		m_srb.Release();
-		m_pso->CreateShaderResourceBinding(&m_srb, true);
-		m_texture_var = m_srb->GetVariableByName(SHADER_TYPE_PIXEL, "Texture");
-		VERIFY_EXPR(m_texture_var != nullptr);
+		if (!m_glyph_font.empty())
+		{
+			auto cache = std::make_shared<mu::glyph_cache>(m_device, cfg.SizePixels, std::round(atlas->Fonts[0]->Ascent), m_sdf ? s_sdf_spread : 0, m_alpha8);
+			MU_LEAF_CHECK(cache->open(m_glyph_font.c_str()));
+			m_glyph_cache = std::move(cache);
+		}
 
 		return {};
 	}
+	catch (...)
+	{
+		return MU_LEAF_NEW_ERROR(mu::gfx_error::not_specified{});
+	}
 
 } // namespace Diligent
 
 namespace Diligent
 {
-	inline float4 transform_clip_rect(SURFACE_TRANSFORM surface_pre_transform, const ImVec2& display_size, const float4& rect)
+	// How a surface pre-transform maps a scissor rect (min_x, min_y, max_x, max_y) of the unrotated image: component n of the
+	// result is s_offset_x[n] * display width + s_offset_y[n] * display height + s_sign[n] * component s_lanes[n] of the rect.
+	template<SURFACE_TRANSFORM Transform>
+	struct clip_transform;
+
+	template<>
+	struct clip_transform<SURFACE_TRANSFORM_IDENTITY>
 	{
-		switch (surface_pre_transform)
-		{
-		case SURFACE_TRANSFORM_IDENTITY:
-			return rect;
+		static constexpr int   s_lanes[4]	 = {0, 1, 2, 3};
+		static constexpr float s_sign[4]	 = {1.0f, 1.0f, 1.0f, 1.0f};
+		static constexpr float s_offset_x[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+		static constexpr float s_offset_y[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+	};
+
+	// Content rotated 90 degrees clockwise, origin in the top left corner: (height - max_y, min_x, height - min_y, max_x)
+	template<>
+	struct clip_transform<SURFACE_TRANSFORM_ROTATE_90>
+	{
+		static constexpr int   s_lanes[4]	 = {3, 0, 1, 2};
+		static constexpr float s_sign[4]	 = {-1.0f, 1.0f, -1.0f, 1.0f};
+		static constexpr float s_offset_x[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+		static constexpr float s_offset_y[4] = {1.0f, 0.0f, 1.0f, 0.0f};
+	};
+
+	// Content rotated 180 degrees: (width - max_x, height - max_y, width - min_x, height - min_y)
+	template<>
+	struct clip_transform<SURFACE_TRANSFORM_ROTATE_180>
+	{
+		static constexpr int   s_lanes[4]	 = {2, 3, 0, 1};
+		static constexpr float s_sign[4]	 = {-1.0f, -1.0f, -1.0f, -1.0f};
+		static constexpr float s_offset_x[4] = {1.0f, 0.0f, 1.0f, 0.0f};
+		static constexpr float s_offset_y[4] = {0.0f, 1.0f, 0.0f, 1.0f};
+	};
+
+	// Content rotated 270 degrees clockwise: (min_y, width - max_x, max_y, width - min_x)
+	template<>
+	struct clip_transform<SURFACE_TRANSFORM_ROTATE_270>
+	{
+		static constexpr int   s_lanes[4]	 = {1, 2, 3, 0};
+		static constexpr float s_sign[4]	 = {1.0f, -1.0f, 1.0f, -1.0f};
+		static constexpr float s_offset_x[4] = {0.0f, 1.0f, 0.0f, 1.0f};
+		static constexpr float s_offset_y[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+	};
+
+	// Turns the clip rects of a frame into scissor rects, with everything that does not change per command computed once.
+	template<SURFACE_TRANSFORM Transform>
+	struct clip_transformer
+	{
+		using traits = clip_transform<Transform>;
 
-		case SURFACE_TRANSFORM_ROTATE_90:
-		{
-			// The image content is rotated 90 degrees clockwise. The origin is in the left-top corner.
-			//
-			//                                                             DsplSz.y
-			//                a.x                                            -a.y     a.y     Old origin
-			//              0---->|                                       0------->|<------| /
-			//           0__|_____|____________________                0__|________|_______|/
-			//            | |     '                    |                | |        '       |
-			//        a.y | |     '                    |            a.x | |        '       |
-			//           _V_|_ _ _a____b               |               _V_|_ _d'___a'      |
-			//            A |     |    |               |                  |   |    |       |
-			//  DsplSz.y  | |     |____|               |                  |   |____|       |
-			//    -a.y    | |     d    c               |                  |   c'   b'      |
-			//           _|_|__________________________|                  |                |
-			//              A                                             |                |
-			//              |-----> Y'                                    |                |
-			//         New Origin                                         |________________|
-			//
-			float2 a{rect.x, rect.y};
-			float2 c{rect.z, rect.w};
-			return float4{
-				display_size.y - c.y, // min_x = c'.x
-				a.x,				  // min_y = a'.y
-				display_size.y - a.y, // max_x = a'.x
-				c.x					  // max_y = c'.y
-			};
-		}
+		float m_bounds[4]; // display coordinates, what can be drawn at all
+		float m_origin[4]; // DisplayPos, twice
+		float m_scale[4];  // FramebufferScale, twice
+		float m_offset[4];
 
-		case SURFACE_TRANSFORM_ROTATE_180:
+		clip_transformer(const ImDrawData* draw_data, const ImVec4& bounds) noexcept
+			: m_bounds{bounds.x, bounds.y, bounds.z, bounds.w}
+			, m_origin{draw_data->DisplayPos.x, draw_data->DisplayPos.y, draw_data->DisplayPos.x, draw_data->DisplayPos.y}
+			, m_scale{draw_data->FramebufferScale.x, draw_data->FramebufferScale.y, draw_data->FramebufferScale.x, draw_data->FramebufferScale.y}
 		{
-			// The image content is rotated 180 degrees clockwise. The origin is in the left-top corner.
-			//
-			//                a.x                                               DsplSz.x - a.x
-			//              0---->|                                         0------------------>|
-			//           0__|_____|____________________                 0_ _|___________________|______
-			//            | |     '                    |                  | |                   '      |
-			//        a.y | |     '                    |        DsplSz.y  | |              c'___d'     |
-			//           _V_|_ _ _a____b               |          -a.y    | |              |    |      |
-			//              |     |    |               |                 _V_|_ _ _ _ _ _ _ |____|      |
-			//              |     |____|               |                    |              b'   a'     |
-			//              |     d    c               |                    |                          |
-			//              |__________________________|                    |__________________________|
-			//                                         A                                               A
-			//                                         |                                               |
-			//                                     New Origin                                      Old Origin
-			float2 a{rect.x, rect.y};
-			float2 c{rect.z, rect.w};
-			return float4{
-				display_size.x - c.x, // min_x = c'.x
-				display_size.y - c.y, // min_y = c'.y
-				display_size.x - a.x, // max_x = a'.x
-				display_size.y - a.y  // max_y = a'.y
-			};
+			for (int n = 0; n < 4; n++)
+			{
+				m_offset[n] = traits::s_offset_x[n] * draw_data->DisplaySize.x + traits::s_offset_y[n] * draw_data->DisplaySize.y;
+			}
 		}
 
-		case SURFACE_TRANSFORM_ROTATE_270:
+		// Clips rect to the bounds and maps it to pixels of the pre-transformed surface. False when nothing of it is left.
+		[[nodiscard]] auto operator()(const ImVec4& rect, Int32 (&scissor)[4]) const noexcept -> bool
 		{
-			// The image content is rotated 270 degrees clockwise. The origin is in the left-top corner.
-			//
-			//              0  a.x     DsplSz.x-a.x   New Origin              a.y
-			//              |---->|<-------------------|                    0----->|
-			//          0_ _|_____|____________________V                 0 _|______|_________
-			//            | |     '                    |                  | |      '         |
-			//            | |     '                    |                  | |      '         |
-			//        a.y_V_|_ _ _a____b               |        DsplSz.x  | |      '         |
-			//              |     |    |               |          -a.x    | |      '         |
-			//              |     |____|               |                  | |      b'___c'   |
-			//              |     d    c               |                  | |      |    |    |
-			//  DsplSz.y _ _|__________________________|                 _V_|_ _ _ |____|    |
-			//                                                              |      a'   d'   |
-			//                                                              |                |
-			//                                                              |________________|
-			//                                                              A
-			//                                                              |
-			//                                                            Old origin
-			float2 a{rect.x, rect.y};
-			float2 c{rect.z, rect.w};
-			return float4{
-				a.y,				  // min_x = a'.x
-				display_size.x - c.x, // min_y = c'.y
-				c.y,				  // max_x = c'.x
-				display_size.x - a.x  // max_y = a'.y
-			};
+#ifdef MU_GFX_SSE2
+			const __m128 bounds = _mm_loadu_ps(m_bounds);
+			const __m128 lo		= _mm_movelh_ps(bounds, _mm_set1_ps(-FLT_MAX));
+			const __m128 hi		= _mm_movehl_ps(bounds, _mm_set1_ps(FLT_MAX));
+			const __m128 clip	= _mm_min_ps(_mm_max_ps(_mm_loadu_ps(&rect.x), lo), hi);
+
+			// min_x < max_x and min_y < max_y
+			if ((_mm_movemask_ps(_mm_cmplt_ps(clip, _mm_movehl_ps(clip, clip))) & 3) != 3)
+			{
+				return false;
+			}
+
+			const __m128 pixels = _mm_mul_ps(_mm_sub_ps(clip, _mm_loadu_ps(m_origin)), _mm_loadu_ps(m_scale));
+			const __m128 moved	= _mm_shuffle_ps(pixels, pixels, _MM_SHUFFLE(traits::s_lanes[3], traits::s_lanes[2], traits::s_lanes[1], traits::s_lanes[0]));
+			const __m128 result = _mm_add_ps(_mm_loadu_ps(m_offset), _mm_mul_ps(_mm_loadu_ps(traits::s_sign), moved));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(scissor), _mm_cvttps_epi32(result));
+#else
+			const float clip[4] = {
+				std::max(rect.x, m_bounds[0]),
+				std::max(rect.y, m_bounds[1]),
+				std::min(rect.z, m_bounds[2]),
+				std::min(rect.w, m_bounds[3])};
+			if (clip[2] <= clip[0] || clip[3] <= clip[1])
+			{
+				return false;
+			}
+
+			float pixels[4];
+			for (int n = 0; n < 4; n++)
+			{
+				pixels[n] = (clip[n] - m_origin[n]) * m_scale[n];
+			}
+			for (int n = 0; n < 4; n++)
+			{
+				scissor[n] = static_cast<Int32>(m_offset[n] + traits::s_sign[n] * pixels[traits::s_lanes[n]]);
+			}
+#endif
+			// Less than a pixel wide once truncated, the rasterizer would not draw anything
+			return scissor[0] < scissor[2] && scissor[1] < scissor[3];
 		}
+	};
 
-		case SURFACE_TRANSFORM_OPTIMAL:
-			UNEXPECTED("SURFACE_TRANSFORM_OPTIMAL is only valid as parameter during swap chain initialization.");
-			return rect;
+	constexpr VALUE_TYPE s_index_type = sizeof(ImDrawIdx) == 2 ? VT_UINT16 : VT_UINT32;
 
-		case SURFACE_TRANSFORM_HORIZONTAL_MIRROR:
-		case SURFACE_TRANSFORM_HORIZONTAL_MIRROR_ROTATE_90:
-		case SURFACE_TRANSFORM_HORIZONTAL_MIRROR_ROTATE_180:
-		case SURFACE_TRANSFORM_HORIZONTAL_MIRROR_ROTATE_270:
-			UNEXPECTED("Mirror transforms are not supported");
-			return rect;
+	// Fills items with what render_draw_data has to do for draw_data, in order: the background quad when there is one, then the
+	// callbacks and every command, primitive batches included, that has something of its clip rect inside bounds. Returns how many
+	// commands were dropped.
+	template<SURFACE_TRANSFORM Transform>
+	auto prepare_draw_items(const ImDrawData* draw_data, const ImVec4& bounds, bool background, std::vector<imgui_draw_item>& items) -> Uint32
+	{
+		MU_GFX_TRACE_SCOPE("prepare_draw_items");
 
-		default:
-			UNEXPECTED("Unknown transform");
-			return rect;
+		const clip_transformer<Transform> transform(draw_data, bounds);
+
+		items.clear();
+		if (background)
+		{
+			imgui_draw_item item{nullptr, static_cast<Uint32>(draw_data->CmdListsCount)};
+			if (transform(bounds, item.m_scissor))
+			{
+				items.push_back(item);
+			}
 		}
+
+		Uint32 culled = 0;
+		for (int n = 0; n < draw_data->CmdListsCount; n++)
+		{
+			for (const ImDrawCmd& cmd : draw_data->CmdLists[n]->CmdBuffer)
+			{
+				imgui_draw_item item{&cmd, static_cast<Uint32>(n)};
+				const bool		callback = cmd.UserCallback != nullptr && cmd.UserCallback != &mu::gfx_primitives_callback;
+				if (callback || (cmd.ElemCount > 0 && transform(cmd.ClipRect, item.m_scissor)))
+				{
+					items.push_back(item);
+				}
+				else
+				{
+					++culled;
+				}
+			}
+		}
+		return culled;
 	}
 } // namespace Diligent
 
 namespace Diligent
 {
+	auto compact_vertices(const ImDrawVert* src, int count, ImVec2 origin, imgui_compact_vert* dst) noexcept -> void
+	{
+		int n = 0;
+#ifdef MU_GFX_SSE2
+		// x, y in quarter pixels from origin and u, v over [0, 65535] moved down by 32768, so all four lanes fit one signed pack;
+		// the xor moves u, v back up
+		const __m128  scale	 = _mm_setr_ps(4.0f, 4.0f, 65535.0f, 65535.0f);
+		const __m128  offset = _mm_setr_ps(-4.0f * origin.x, -4.0f * origin.y, -32768.0f, -32768.0f);
+		const __m128  lo	 = _mm_set1_ps(-32768.0f);
+		const __m128  hi	 = _mm_set1_ps(32767.0f);
+		const __m128i flip	 = _mm_setr_epi16(0, 0, -32768, -32768, 0, 0, -32768, -32768);
+		for (; n + 2 <= count; n += 2)
+		{
+			const __m128  a		 = _mm_min_ps(_mm_max_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&src[n].pos.x), scale), offset), lo), hi);
+			const __m128  b		 = _mm_min_ps(_mm_max_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&src[n + 1].pos.x), scale), offset), lo), hi);
+			const __m128i packed = _mm_xor_si128(_mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b)), flip);
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(dst[n].m_pos), packed);
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(dst[n + 1].m_pos), _mm_srli_si128(packed, 8));
+			dst[n].m_col	 = src[n].col;
+			dst[n + 1].m_col = src[n + 1].col;
+		}
+#endif
+
+		auto quantize = [](float v, float lo, float hi) -> long
+		{
+			return std::lround(std::clamp(v, lo, hi));
+		};
+
+		for (; n < count; n++)
+		{
+			dst[n].m_pos[0] = static_cast<Int16>(quantize((src[n].pos.x - origin.x) * 4.0f, -32768.0f, 32767.0f));
+			dst[n].m_pos[1] = static_cast<Int16>(quantize((src[n].pos.y - origin.y) * 4.0f, -32768.0f, 32767.0f));
+			dst[n].m_uv[0]	= static_cast<Uint16>(quantize(src[n].uv.x * 65535.0f, 0.0f, 65535.0f));
+			dst[n].m_uv[1]	= static_cast<Uint16>(quantize(src[n].uv.y * 65535.0f, 0.0f, 65535.0f));
+			dst[n].m_col	= src[n].col;
+		}
+	}
+
+	auto range_allocator::reset(Uint32 capacity) -> void
+	{
+		m_free.clear();
+		if (capacity > 0)
+		{
+			m_free.emplace_back(0, capacity);
+		}
+	}
+
+	auto range_allocator::allocate(Uint32 size, Uint32& offset) -> bool
+	{
+		if (size == 0)
+		{
+			offset = 0;
+			return true;
+		}
+
+		for (auto itor = m_free.begin(); itor != m_free.end(); ++itor)
+		{
+			if (itor->second >= size)
+			{
+				offset = itor->first;
+				itor->first += size;
+				itor->second -= size;
+				if (itor->second == 0)
+				{
+					m_free.erase(itor);
+				}
+				return true;
+			}
+		}
+		return false;
+	}
+
+	auto range_allocator::free(Uint32 offset, Uint32 size) -> void
+	{
+		if (size == 0)
+		{
+			return;
+		}
+
+		auto next = std::lower_bound(m_free.begin(), m_free.end(), std::make_pair(offset, Uint32{0}));
+		if (next != m_free.begin())
+		{
+			auto prev = std::prev(next);
+			if (prev->first + prev->second == offset)
+			{
+				prev->second += size;
+				if (next != m_free.end() && prev->first + prev->second == next->first)
+				{
+					prev->second += next->second;
+					m_free.erase(next);
+				}
+				return;
+			}
+		}
+
+		if (next != m_free.end() && offset + size == next->first)
+		{
+			next->first = offset;
+			next->second += size;
+			return;
+		}
+
+		m_free.emplace(next, offset, size);
+	}
+
+	auto imgui_geometry_cache::reset(Uint32 vertex_capacity, Uint32 index_capacity) -> void
+	{
+		m_entries.clear();
+		m_vertices.reset(vertex_capacity);
+		m_indices.reset(index_capacity);
+		m_vertex_capacity = vertex_capacity;
+		m_index_capacity  = index_capacity;
+	}
+
+	auto imgui_geometry_cache::evict() -> bool
+	{
+		bool evicted = false;
+		for (auto itor = m_entries.begin(); itor != m_entries.end();)
+		{
+			if (itor->second.m_frame != m_frame)
+			{
+				m_vertices.free(itor->second.m_vtx_offset, itor->first.m_vtx_count);
+				m_indices.free(itor->second.m_idx_offset, itor->first.m_idx_count);
+				itor	= m_entries.erase(itor);
+				evicted = true;
+			}
+			else
+			{
+				++itor;
+			}
+		}
+		return evicted;
+	}
+
+	auto covers_viewport(const ImDrawData* draw_data, ImTextureID white_texture, ImVec2 white_uv) noexcept -> bool
+	{
+		const ImVec2 min = draw_data->DisplayPos;
+		const ImVec2 max = ImVec2(draw_data->DisplayPos.x + draw_data->DisplaySize.x, draw_data->DisplayPos.y + draw_data->DisplaySize.y);
+
+		for (int n = 0; n < draw_data->CmdListsCount; n++)
+		{
+			const ImDrawList* cmd_list = draw_data->CmdLists[n];
+			for (int cmd_i = 0; cmd_i < cmd_list->CmdBuffer.Size; cmd_i++)
+			{
+				const ImDrawCmd& cmd = cmd_list->CmdBuffer[cmd_i];
+				if (cmd.ElemCount == 0 && cmd.UserCallback == nullptr)
+				{
+					continue;
+				}
+
+				// Only the first draw counts, whatever it is
+				if (cmd.UserCallback != nullptr || cmd.ElemCount < 6 || cmd.TextureId != white_texture || cmd.ClipRect.x > min.x || cmd.ClipRect.y > min.y ||
+					cmd.ClipRect.z < max.x || cmd.ClipRect.w < max.y)
+				{
+					return false;
+				}
+
+				// Its first two triangles must be a solid, opaque quad (ImDrawList::PrimRect) with a corner at each corner of the viewport
+				const ImDrawIdx* idx		= cmd_list->IdxBuffer.Data + cmd.IdxOffset;
+				int				 corners	= 0;
+				for (int i = 0; i < 6; i++)
+				{
+					const ImDrawVert& v = cmd_list->VtxBuffer[static_cast<int>(cmd.VtxOffset + idx[i])];
+					if ((v.col >> IM_COL32_A_SHIFT & 0xFF) != 0xFF || v.uv.x != white_uv.x || v.uv.y != white_uv.y)
+					{
+						return false;
+					}
+
+					const bool left	  = v.pos.x <= min.x;
+					const bool right  = v.pos.x >= max.x;
+					const bool top	  = v.pos.y <= min.y;
+					const bool bottom = v.pos.y >= max.y;
+					if ((!left && !right) || (!top && !bottom))
+					{
+						return false;
+					}
+					corners |= 1 << ((right ? 1 : 0) | (bottom ? 2 : 0));
+				}
+				return corners == 0xF;
+			}
+		}
+
+		return false;
+	}
+
 	imgui_renderer::imgui_renderer(std::shared_ptr<imgui_shared_resources> shared_resources, Uint32 initial_vertex_buffer_size, Uint32 initial_index_buffer_size, float scale)
 		: m_shared_resources(shared_resources)
 		, m_vertex_buffer_size{initial_vertex_buffer_size}
@@ -586,64 +1451,304 @@ namespace Diligent
 
 	imgui_renderer::~imgui_renderer() { }
 
-	auto imgui_renderer::render_draw_data(SURFACE_TRANSFORM surface_pre_transform, Uint32 render_surface_width, Uint32 render_surface_height, IDeviceContext* ctx, ImDrawData* draw_data) noexcept -> mu::leaf::result<void>
+	auto imgui_renderer::trim() noexcept -> bool
+	{
+		// The same rule as render_draw_data's growth, from below
+		auto fit = [](Uint32 size, Uint32 count) -> Uint32
+		{
+			while (size / 2 >= s_min_buffer_size && size / 2 >= count * 2)
+			{
+				size /= 2;
+			}
+			return size;
+		};
+
+		const Uint32 vertex_size = fit(m_vertex_buffer_size, m_last_vtx_count);
+		const Uint32 index_size	 = fit(m_index_buffer_size, m_last_idx_count);
+		if (vertex_size == m_vertex_buffer_size && index_size == m_index_buffer_size)
+		{
+			return false;
+		}
+
+		// Still referenced by the last frame's commands, the device keeps them until the GPU is done with them
+		m_vertex_buffer_size = vertex_size;
+		m_index_buffer_size	 = index_size;
+		m_vertex_buffer.Release();
+		m_index_buffer.Release();
+		m_vertex_staging.Release();
+		m_index_staging.Release();
+		m_vertex_staging_size = 0;
+		m_index_staging_size  = 0;
+		m_cache.reset(0, 0);
+		return true;
+	}
+
+	auto imgui_renderer::buffer_bytes() const noexcept -> Uint64
 	{
+		const Uint64 vertex_size = m_shared_resources->m_compact_vertices ? sizeof(imgui_compact_vert) : sizeof(ImDrawVert);
+		return (m_vertex_buffer ? Uint64{m_vertex_buffer_size} * vertex_size : 0) + (m_index_buffer ? Uint64{m_index_buffer_size} * sizeof(ImDrawIdx) : 0);
+	}
+
+	auto imgui_renderer::upload_placed(mu::render_context* ctx, ImVec2 display_pos) -> void
+	{
+		if (m_uploads.empty())
+		{
+			return;
+		}
+
+		IRenderDevice* device	   = m_shared_resources->m_device;
+		const bool	   compact	   = m_shared_resources->m_compact_vertices;
+		const Uint32   vertex_size = compact ? sizeof(imgui_compact_vert) : sizeof(ImDrawVert);
+
+		Uint32 vtx_count = 0;
+		Uint32 idx_count = 0;
+		for (const auto& upload : m_uploads)
+		{
+			vtx_count += upload.m_vtx_count;
+			idx_count += upload.m_idx_count;
+		}
+
+		auto reserve = [&](RefCntAutoPtr<IBuffer>& buffer, Uint32& size, Uint32 count, Uint32 element_size, BIND_FLAGS bind_flags, const char* name) -> void
+		{
+			if (count <= size && (buffer || !device))
+			{
+				return;
+			}
+			size = std::max(size, s_min_buffer_size);
+			while (size < count)
+			{
+				size *= 2;
+			}
+
+			buffer.Release();
+			BufferDesc desc;
+			desc.Name			= name;
+			desc.BindFlags		= bind_flags;
+			desc.uiSizeInBytes	= size * element_size;
+			desc.Usage			= USAGE_DYNAMIC;
+			desc.CPUAccessFlags = CPU_ACCESS_WRITE;
+			if (device)
+			{
+				device->CreateBuffer(desc, nullptr, &buffer);
+			}
+		};
+		reserve(m_vertex_staging, m_vertex_staging_size, vtx_count, vertex_size, BIND_VERTEX_BUFFER, "Imgui vertex staging buffer");
+		reserve(m_index_staging, m_index_staging_size, idx_count, sizeof(ImDrawIdx), BIND_INDEX_BUFFER, "Imgui index staging buffer");
+
+		{
+			mu::mapped_buffer<unsigned char> vtx_dst(ctx, m_vertex_staging, vtx_count * vertex_size);
+			mu::mapped_buffer<ImDrawIdx>	 idx_dst(ctx, m_index_staging, idx_count);
+			unsigned char*					 vtx_out = vtx_dst;
+			ImDrawIdx*						 idx_out = idx_dst;
+			for (const auto& upload : m_uploads)
+			{
+				if (compact)
+				{
+					compact_vertices(upload.m_vtx, static_cast<int>(upload.m_vtx_count), display_pos, reinterpret_cast<imgui_compact_vert*>(vtx_out));
+				}
+				else
+				{
+					std::memcpy(vtx_out, upload.m_vtx, upload.m_vtx_count * sizeof(ImDrawVert));
+				}
+				std::memcpy(idx_out, upload.m_idx, upload.m_idx_count * sizeof(ImDrawIdx));
+				vtx_out += upload.m_vtx_count * vertex_size;
+				idx_out += upload.m_idx_count;
+			}
+		}
+
+		// Lists placed next to each other in the buffers, as the ones of a frame filling freed space often are, are copied at once
+		auto copy = [&](IBuffer* staging, IBuffer* buffer, Uint32 element_size, auto count_of, auto offset_of) -> void
+		{
+			Uint32 src = 0;
+			Uint32 dst = 0;
+			Uint32 run = 0;
+			for (const auto& upload : m_uploads)
+			{
+				if (run != 0 && offset_of(upload) != dst + run)
+				{
+					ctx->copy_buffer(staging, src * element_size, buffer, dst * element_size, run * element_size);
+					src += run;
+					run = 0;
+				}
+				if (run == 0)
+				{
+					dst = offset_of(upload);
+				}
+				run += count_of(upload);
+			}
+			if (run != 0)
+			{
+				ctx->copy_buffer(staging, src * element_size, buffer, dst * element_size, run * element_size);
+			}
+		};
+		copy(
+			m_vertex_staging,
+			m_vertex_buffer,
+			vertex_size,
+			[](const pending_upload& upload) { return upload.m_vtx_count; },
+			[](const pending_upload& upload) { return upload.m_vtx_offset; });
+		copy(
+			m_index_staging,
+			m_index_buffer,
+			sizeof(ImDrawIdx),
+			[](const pending_upload& upload) { return upload.m_idx_count; },
+			[](const pending_upload& upload) { return upload.m_idx_offset; });
+	}
+
+	auto imgui_renderer::render_draw_data(
+		SURFACE_TRANSFORM	surface_pre_transform,
+		Uint32				render_surface_width,
+		Uint32				render_surface_height,
+		mu::render_context* ctx,
+		ImDrawData*			draw_data,
+		const imgui_damage* damage) noexcept -> mu::leaf::result<void>
+	try
+	{
+		MU_GFX_TRACE_SCOPE("render_draw_data");
+
 		// Avoid rendering when minimized
 		if (draw_data->DisplaySize.x <= 0.0f || draw_data->DisplaySize.y <= 0.0f)
 		{
 			return {};
 		}
 
-		// Create and grow vertex/index buffers if needed
-		if (!m_vertex_buffer || static_cast<int>(m_vertex_buffer_size) < draw_data->TotalVtxCount)
+		m_stats = imgui_render_stats{};
+
+		// The background fill of a partial redraw is one more quad after the lists' geometry
+		const bool fill_background = damage != nullptr && damage->m_white_texture != nullptr;
+		const int  total_vtx_count = draw_data->TotalVtxCount + (fill_background ? 4 : 0);
+		const int  total_idx_count = draw_data->TotalIdxCount + (fill_background ? 6 : 0);
+		m_last_vtx_count		   = static_cast<Uint32>(total_vtx_count);
+		m_last_idx_count		   = static_cast<Uint32>(total_idx_count);
+
+		// Without a device (benchmarks against a null context) buffers are never created and maps are served by the context.
+		IRenderDevice* device = m_shared_resources->m_device;
+
+		const bool	 compact	 = m_shared_resources->m_compact_vertices;
+		const Uint32 vertex_size = compact ? sizeof(imgui_compact_vert) : sizeof(ImDrawVert);
+
+		// The buffers keep room for lists of earlier frames next to the current one's
+		while (static_cast<int>(m_vertex_buffer_size) < total_vtx_count * 2)
+		{
+			m_vertex_buffer_size *= 2;
+		}
+		while (static_cast<int>(m_index_buffer_size) < total_idx_count * 2)
+		{
+			m_index_buffer_size *= 2;
+		}
+
+		auto create_buffers = [&]() -> void
 		{
 			m_vertex_buffer.Release();
-			while (static_cast<int>(m_vertex_buffer_size) < draw_data->TotalVtxCount)
+			m_index_buffer.Release();
+
+			BufferDesc vb_desc;
+			vb_desc.Name		  = "Imgui vertex buffer";
+			vb_desc.BindFlags	  = BIND_VERTEX_BUFFER;
+			vb_desc.uiSizeInBytes = m_vertex_buffer_size * vertex_size;
+			vb_desc.Usage		  = USAGE_DEFAULT;
+
+			BufferDesc ib_desc;
+			ib_desc.Name		  = "Imgui index buffer";
+			ib_desc.BindFlags	  = BIND_INDEX_BUFFER;
+			ib_desc.uiSizeInBytes = m_index_buffer_size * sizeof(ImDrawIdx);
+			ib_desc.Usage		  = USAGE_DEFAULT;
+
+			if (device)
 			{
-				m_vertex_buffer_size *= 2;
+				device->CreateBuffer(vb_desc, nullptr, &m_vertex_buffer);
+				device->CreateBuffer(ib_desc, nullptr, &m_index_buffer);
 			}
+			m_cache.reset(m_vertex_buffer_size, m_index_buffer_size);
+		};
 
-			BufferDesc vb_desc;
-			vb_desc.Name		   = "Imgui vertex buffer";
-			vb_desc.BindFlags	   = BIND_VERTEX_BUFFER;
-			vb_desc.uiSizeInBytes  = m_vertex_buffer_size * sizeof(ImDrawVert);
-			vb_desc.Usage		   = USAGE_DYNAMIC;
-			vb_desc.CPUAccessFlags = CPU_ACCESS_WRITE;
-			m_shared_resources->m_device->CreateBuffer(vb_desc, nullptr, &m_vertex_buffer);
+		if ((device && !m_vertex_buffer) || m_cache.m_vertex_capacity != m_vertex_buffer_size || m_cache.m_index_capacity != m_index_buffer_size)
+		{
+			create_buffers();
 		}
 
-		if (!m_index_buffer || static_cast<int>(m_index_buffer_size) < draw_data->TotalIdxCount)
+		// Finds each list's geometry in the cache or uploads it, the background quad of a partial redraw last
+		ImDrawVert quad_vtx[4];
+		ImDrawIdx  quad_idx[6] = {0, 1, 2, 0, 2, 3};
+		if (fill_background)
 		{
-			m_index_buffer.Release();
-			while (static_cast<int>(m_index_buffer_size) < draw_data->TotalIdxCount)
+			const ImVec4& rect = damage->m_rect;
+			quad_vtx[0]		   = ImDrawVert{ImVec2(rect.x, rect.y), damage->m_white_uv, damage->m_background};
+			quad_vtx[1]		   = ImDrawVert{ImVec2(rect.z, rect.y), damage->m_white_uv, damage->m_background};
+			quad_vtx[2]		   = ImDrawVert{ImVec2(rect.z, rect.w), damage->m_white_uv, damage->m_background};
+			quad_vtx[3]		   = ImDrawVert{ImVec2(rect.x, rect.w), damage->m_white_uv, damage->m_background};
+		}
+
+		// Compact positions are relative to the display, so the same list elsewhere is different geometry
+		const ImU32 vtx_seed = compact ? ImHashData(&draw_data->DisplayPos, sizeof(ImVec2), 0) : 0;
+
+		auto place = [&](const ImDrawVert* vtx, int vtx_count, const ImDrawIdx* idx, int idx_count, imgui_geometry_cache::entry& placement) -> bool
+		{
+			const imgui_geometry_cache::key key{
+				ImHashData(vtx, static_cast<std::size_t>(vtx_count) * sizeof(ImDrawVert), vtx_seed),
+				ImHashData(idx, static_cast<std::size_t>(idx_count) * sizeof(ImDrawIdx), 0),
+				static_cast<Uint32>(vtx_count),
+				static_cast<Uint32>(idx_count)};
+
+			if (auto itor = m_cache.m_entries.find(key); itor != m_cache.m_entries.end())
 			{
-				m_index_buffer_size *= 2;
+				itor->second.m_frame = m_cache.m_frame;
+				placement			 = itor->second;
+				++m_stats.m_lists_cached;
+				return true;
 			}
 
-			BufferDesc ib_desc;
-			ib_desc.Name		   = "Imgui index buffer";
-			ib_desc.BindFlags	   = BIND_INDEX_BUFFER;
-			ib_desc.uiSizeInBytes  = m_index_buffer_size * sizeof(ImDrawIdx);
-			ib_desc.Usage		   = USAGE_DYNAMIC;
-			ib_desc.CPUAccessFlags = CPU_ACCESS_WRITE;
-			m_shared_resources->m_device->CreateBuffer(ib_desc, nullptr, &m_index_buffer);
-		}
+			auto allocate = [&]() -> bool
+			{
+				if (!m_cache.m_vertices.allocate(key.m_vtx_count, placement.m_vtx_offset))
+				{
+					return false;
+				}
+				if (!m_cache.m_indices.allocate(key.m_idx_count, placement.m_idx_offset))
+				{
+					m_cache.m_vertices.free(placement.m_vtx_offset, key.m_vtx_count);
+					return false;
+				}
+				return true;
+			};
 
-		{
-			MapHelper<ImDrawVert> verts(ctx, m_vertex_buffer, MAP_WRITE, MAP_FLAG_DISCARD);
-			MapHelper<ImDrawIdx>  idxs(ctx, m_index_buffer, MAP_WRITE, MAP_FLAG_DISCARD);
+			if (!allocate() && !(m_cache.evict() && allocate()))
+			{
+				return false;
+			}
+
+			placement.m_frame = m_cache.m_frame;
+			m_cache.m_entries.emplace(key, placement);
+			m_uploads.push_back({vtx, idx, key.m_vtx_count, key.m_idx_count, placement.m_vtx_offset, placement.m_idx_offset});
+			m_stats.m_bytes_uploaded += key.m_vtx_count * vertex_size + key.m_idx_count * sizeof(ImDrawIdx);
+			++m_stats.m_lists_uploaded;
+			return true;
+		};
 
-			ImDrawVert* vtx_dst = verts;
-			ImDrawIdx*	idx_dst = idxs;
+		auto place_all = [&]() -> bool
+		{
+			++m_cache.m_frame;
+			m_uploads.clear();
+			m_placements.resize(static_cast<std::size_t>(draw_data->CmdListsCount) + 1);
 			for (int n = 0; n < draw_data->CmdListsCount; n++)
 			{
 				const ImDrawList* cmd_list = draw_data->CmdLists[n];
-				memcpy(vtx_dst, cmd_list->VtxBuffer.Data, cmd_list->VtxBuffer.Size * sizeof(ImDrawVert));
-				memcpy(idx_dst, cmd_list->IdxBuffer.Data, cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx));
-				vtx_dst += cmd_list->VtxBuffer.Size;
-				idx_dst += cmd_list->IdxBuffer.Size;
+				if (!place(cmd_list->VtxBuffer.Data, cmd_list->VtxBuffer.Size, cmd_list->IdxBuffer.Data, cmd_list->IdxBuffer.Size, m_placements[n]))
+				{
+					return false;
+				}
 			}
+			return !fill_background || place(quad_vtx, 4, quad_idx, 6, m_placements.back());
+		};
+
+		while (!place_all())
+		{
+			// Too fragmented even without the lists of earlier frames, start over in larger buffers
+			m_vertex_buffer_size *= 2;
+			m_index_buffer_size *= 2;
+			create_buffers();
 		}
+		upload_placed(ctx, draw_data->DisplayPos);
 
 		// Setup orthographic projection matrix into our constant buffer
 		// Our visible imgui space lies from pDrawData->DisplayPos (top left) to pDrawData->DisplayPos+data_data->DisplaySize (bottom right).
@@ -651,10 +1756,11 @@ namespace Diligent
 		{
 			// DisplaySize always refers to the logical dimensions that account for pre-transform, hence
 			// the aspect ratio will be correct after applying appropriate rotation.
-			float L = draw_data->DisplayPos.x;
-			float R = draw_data->DisplayPos.x + draw_data->DisplaySize.x;
-			float T = draw_data->DisplayPos.y;
-			float B = draw_data->DisplayPos.y + draw_data->DisplaySize.y;
+			// Compact vertices are already relative to DisplayPos, in quarter pixels
+			float L = compact ? 0.0f : draw_data->DisplayPos.x;
+			float R = compact ? draw_data->DisplaySize.x * 4.0f : draw_data->DisplayPos.x + draw_data->DisplaySize.x;
+			float T = compact ? 0.0f : draw_data->DisplayPos.y;
+			float B = compact ? draw_data->DisplaySize.y * 4.0f : draw_data->DisplayPos.y + draw_data->DisplaySize.y;
 
 			float4x4 projection{2.0f / (R - L), 0.0f, 0.0f, 0.0f, 0.0f, 2.0f / (T - B), 0.0f, 0.0f, 0.0f, 0.0f, 0.5f, 0.0f, (R + L) / (L - R), (T + B) / (B - T), 0.5f, 1.0f};
 
@@ -695,21 +1801,20 @@ namespace Diligent
 				UNEXPECTED("Unknown transform");
 			}
 
-			MapHelper<float4x4> cb_data(ctx, m_shared_resources->m_vertex_constant_buffer, MAP_WRITE, MAP_FLAG_DISCARD);
+			mu::mapped_buffer<float4x4> cb_data(ctx, m_shared_resources->m_vertex_constant_buffer, 1);
 			*cb_data = projection;
+			m_stats.m_bytes_uploaded += sizeof(float4x4);
 		}
 
 		auto setup_render_state = [&]() -> void
 		{
 			// Setup shader and vertex buffers
-			Uint32	 offsets[]		  = {0};
-			IBuffer* vertex_buffers[] = {m_vertex_buffer};
-			ctx->SetVertexBuffers(0, 1, vertex_buffers, offsets, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, SET_VERTEX_BUFFERS_FLAG_RESET);
-			ctx->SetIndexBuffer(m_index_buffer, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
-			ctx->SetPipelineState(m_shared_resources->m_pso);
+			ctx->set_vertex_buffer(m_vertex_buffer, 0);
+			ctx->set_index_buffer(m_index_buffer, 0);
+			ctx->set_pipeline_state(m_shared_resources->m_pso);
 
 			const float blend_factor[4] = {0.f, 0.f, 0.f, 0.f};
-			ctx->SetBlendFactors(blend_factor);
+			ctx->set_blend_factors(blend_factor);
 
 			Viewport vp;
 			vp.Width	= static_cast<float>(render_surface_width) * draw_data->FramebufferScale.x;
@@ -717,85 +1822,161 @@ namespace Diligent
 			vp.MinDepth = 0.0f;
 			vp.MaxDepth = 1.0f;
 			vp.TopLeftX = vp.TopLeftY = 0;
-			ctx->SetViewports(
-				1,
-				&vp,
+			ctx->set_viewport(
+				vp,
 				static_cast<Uint32>(render_surface_width * draw_data->FramebufferScale.x),
 				static_cast<Uint32>(render_surface_height * draw_data->FramebufferScale.y));
 		};
 
 		setup_render_state();
 
-		// Render command lists
-		// (Because we merged all buffers into a single one, we maintain our own offset into them)
-		int global_idx_offset = 0;
-		int global_vtx_offset = 0;
+		// Everything outside the display, and outside the damage of a partial redraw, is dropped before any draw is issued
+		ImVec4 bounds{draw_data->DisplayPos.x, draw_data->DisplayPos.y, draw_data->DisplayPos.x + draw_data->DisplaySize.x, draw_data->DisplayPos.y + draw_data->DisplaySize.y};
+		if (damage != nullptr)
+		{
+			bounds = ImVec4(
+				std::max(bounds.x, damage->m_rect.x),
+				std::max(bounds.y, damage->m_rect.y),
+				std::min(bounds.z, damage->m_rect.z),
+				std::min(bounds.w, damage->m_rect.w));
+		}
+
+		switch (surface_pre_transform)
+		{
+		case SURFACE_TRANSFORM_ROTATE_90:
+			m_stats.m_culled = prepare_draw_items<SURFACE_TRANSFORM_ROTATE_90>(draw_data, bounds, fill_background, m_items);
+			break;
+
+		case SURFACE_TRANSFORM_ROTATE_180:
+			m_stats.m_culled = prepare_draw_items<SURFACE_TRANSFORM_ROTATE_180>(draw_data, bounds, fill_background, m_items);
+			break;
 
+		case SURFACE_TRANSFORM_ROTATE_270:
+			m_stats.m_culled = prepare_draw_items<SURFACE_TRANSFORM_ROTATE_270>(draw_data, bounds, fill_background, m_items);
+			break;
+
+		default:
+			// Transforms other than rotations were reported with the projection
+			m_stats.m_culled = prepare_draw_items<SURFACE_TRANSFORM_IDENTITY>(draw_data, bounds, fill_background, m_items);
+			break;
+		}
+
+		const auto surface_width  = static_cast<Uint32>(render_surface_width * draw_data->FramebufferScale.x);
+		const auto surface_height = static_cast<Uint32>(render_surface_height * draw_data->FramebufferScale.y);
+
+		// Without a primitive pipeline on a device, primitive batches are left out
+		const bool draw_primitives = device == nullptr || m_shared_resources->m_primitive_pso != nullptr;
+
+		// Render the items, each command from wherever the cache placed its list's geometry
 		ITextureView* last_texture_view = nullptr;
-		for (int n = 0; n < draw_data->CmdListsCount; n++)
+		bool		  primitives_bound	= false;
+		bool		  font_bound		= false;
+		for (const imgui_draw_item& item : m_items)
 		{
-			const ImDrawList* cmd_list = draw_data->CmdLists[n];
-			for (int cmd_i = 0; cmd_i < cmd_list->CmdBuffer.Size; cmd_i++)
+			const ImDrawCmd* im_cmd	   = item.m_cmd;
+			const auto&		 placement = m_placements[item.m_list];
+			if (im_cmd != nullptr && im_cmd->UserCallback == &mu::gfx_primitives_callback)
 			{
-				const ImDrawCmd* im_cmd = &cmd_list->CmdBuffer[cmd_i];
-				if (im_cmd->UserCallback != NULL)
+				if (!draw_primitives)
 				{
-					// User callback, registered via ImDrawList::AddCallback()
-					// (ImDrawCallback_ResetRenderState is a special callback value used by the user to request the renderer to reset render state.)
-					if (im_cmd->UserCallback == ImDrawCallback_ResetRenderState)
-					{
-						setup_render_state();
-					}
-					else
-					{
-						im_cmd->UserCallback(cmd_list, im_cmd);
-					}
+					continue;
+				}
+
+				// Switching pipelines needs the texture committed again, through the other SRB
+				if (!primitives_bound)
+				{
+					ctx->set_pipeline_state(m_shared_resources->m_primitive_pso);
+					primitives_bound  = true;
+					last_texture_view = nullptr;
+				}
+
+				ctx->set_scissor_rect(Rect{item.m_scissor[0], item.m_scissor[1], item.m_scissor[2], item.m_scissor[3]}, surface_width, surface_height);
+				ctx->set_vertex_buffer(m_vertex_buffer, (placement.m_vtx_offset + im_cmd->VtxOffset) * vertex_size);
+
+				auto* texture_view = reinterpret_cast<ITextureView*>(im_cmd->TextureId);
+				if (texture_view != last_texture_view)
+				{
+					last_texture_view = texture_view;
+					ctx->commit_texture(m_shared_resources->m_primitive_srb, m_shared_resources->m_primitive_texture_var, texture_view);
+					++m_stats.m_texture_binds;
+				}
+
+				ctx->draw(DrawAttribs(4, DRAW_FLAG_VERIFY_STATES, im_cmd->ElemCount));
+				++m_stats.m_draws;
+				m_stats.m_primitives += im_cmd->ElemCount;
+				continue;
+			}
+
+			if (primitives_bound)
+			{
+				ctx->set_pipeline_state(m_shared_resources->m_pso);
+				ctx->set_vertex_buffer(m_vertex_buffer, 0);
+				primitives_bound  = false;
+				font_bound		  = false;
+				last_texture_view = nullptr;
+			}
+
+			if (im_cmd != nullptr && im_cmd->UserCallback != nullptr)
+			{
+				// User callback, registered via ImDrawList::AddCallback()
+				// (ImDrawCallback_ResetRenderState is a special callback value used by the user to request the renderer to reset render state.)
+				if (im_cmd->UserCallback == ImDrawCallback_ResetRenderState)
+				{
+					setup_render_state();
+					font_bound		  = false;
+					last_texture_view = nullptr;
 				}
 				else
 				{
-					// Apply scissor/clipping rectangle
-					float4 clip_rect{
-						(im_cmd->ClipRect.x - draw_data->DisplayPos.x) * draw_data->FramebufferScale.x,
-						(im_cmd->ClipRect.y - draw_data->DisplayPos.y) * draw_data->FramebufferScale.y,
-						(im_cmd->ClipRect.z - draw_data->DisplayPos.x) * draw_data->FramebufferScale.x,
-						(im_cmd->ClipRect.w - draw_data->DisplayPos.y) * draw_data->FramebufferScale.y //
-					};
-
-					// Apply pretransform
-					clip_rect = transform_clip_rect(surface_pre_transform, draw_data->DisplaySize, clip_rect);
-
-					Rect r{
-						static_cast<Int32>(clip_rect.x), static_cast<Int32>(clip_rect.y), static_cast<Int32>(clip_rect.z),
-						static_cast<Int32>(clip_rect.w) //
-					};
-					ctx->SetScissorRects(
-						1,
-						&r,
-						static_cast<Uint32>(render_surface_width * draw_data->FramebufferScale.x),
-						static_cast<Uint32>(render_surface_height * draw_data->FramebufferScale.y));
-
-					// Bind texture
-					auto* texture_view = reinterpret_cast<ITextureView*>(im_cmd->TextureId);
-					VERIFY_EXPR(texture_view);
-					if (texture_view != last_texture_view)
-					{
-						last_texture_view = texture_view;
-						m_shared_resources->m_texture_var->Set(texture_view);
-						ctx->CommitShaderResources(m_shared_resources->m_srb, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
-					}
+					im_cmd->UserCallback(draw_data->CmdLists[item.m_list], im_cmd);
+				}
+				++m_stats.m_callbacks;
+				continue;
+			}
+
+			ctx->set_scissor_rect(Rect{item.m_scissor[0], item.m_scissor[1], item.m_scissor[2], item.m_scissor[3]}, surface_width, surface_height);
+
+			// Bind texture
+			auto* texture_view = im_cmd != nullptr ? reinterpret_cast<ITextureView*>(im_cmd->TextureId) : damage->m_white_texture;
+			VERIFY_EXPR(texture_view);
 
-					// Draw
-					DrawIndexedAttribs draw_attribs(im_cmd->ElemCount, sizeof(ImDrawIdx) == 2 ? VT_UINT16 : VT_UINT32, DRAW_FLAG_VERIFY_STATES);
-					draw_attribs.FirstIndexLocation = im_cmd->IdxOffset + global_idx_offset;
-					draw_attribs.BaseVertex			= im_cmd->VtxOffset + global_vtx_offset;
-					ctx->DrawIndexed(draw_attribs);
+			// A font atlas of distance fields or of a single channel, which is also what untextured shapes sample, has its own
+			// pipeline; user textures keep the ImGui one
+			const bool font = m_font_texture != nullptr && texture_view == m_font_texture;
+			if (font != font_bound)
+			{
+				ctx->set_pipeline_state(font ? m_shared_resources->m_font_pso : m_shared_resources->m_pso);
+				font_bound		  = font;
+				last_texture_view = nullptr;
+			}
+
+			if (texture_view != last_texture_view)
+			{
+				last_texture_view = texture_view;
+				if (font)
+				{
+					ctx->commit_texture(m_shared_resources->m_font_srb, m_shared_resources->m_font_texture_var, texture_view);
 				}
+				else
+				{
+					ctx->commit_texture(m_shared_resources->m_srb, m_shared_resources->m_texture_var, texture_view);
+				}
+				++m_stats.m_texture_binds;
 			}
-			global_idx_offset += cmd_list->IdxBuffer.Size;
-			global_vtx_offset += cmd_list->VtxBuffer.Size;
+
+			// Draw
+			DrawIndexedAttribs draw_attribs(im_cmd != nullptr ? im_cmd->ElemCount : 6, s_index_type, DRAW_FLAG_VERIFY_STATES);
+			draw_attribs.FirstIndexLocation = (im_cmd != nullptr ? im_cmd->IdxOffset : 0) + placement.m_idx_offset;
+			draw_attribs.BaseVertex			= (im_cmd != nullptr ? im_cmd->VtxOffset : 0) + placement.m_vtx_offset;
+			ctx->draw_indexed(draw_attribs);
+			++m_stats.m_draws;
 		}
 
 		return {};
 	}
+	catch (...)
+	{
+		return MU_LEAF_NEW_ERROR(mu::gfx_error::not_specified{});
+	}
 
 } // namespace Diligent
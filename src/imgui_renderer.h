@@ -1,6 +1,13 @@
+#pragma once
+
 #include <mu_stdlib.h>
 
 #include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <Primitives/interface/BasicTypes.h>
 #include <Common/interface/BasicMath.hpp>
@@ -11,6 +18,12 @@
 
 struct ImDrawData;
 
+namespace mu
+{
+	struct render_context;
+	struct glyph_cache;
+}
+
 namespace Diligent
 {
 	struct IRenderDevice;
@@ -25,29 +38,201 @@ namespace Diligent
 	enum TEXTURE_FORMAT : Uint16;
 	enum SURFACE_TRANSFORM : Uint32;
 
+	// Device objects every window can share: shaders, PSOs, constant buffer and the SRBs textures are bound through.
 	struct imgui_shared_resources
 	{
-		imgui_shared_resources(IRenderDevice* render_device, TEXTURE_FORMAT back_buffer_fmt, TEXTURE_FORMAT depth_buffer_fmt, float scale);
+		imgui_shared_resources(
+			IRenderDevice* render_device,
+			TEXTURE_FORMAT back_buffer_fmt,
+			TEXTURE_FORMAT depth_buffer_fmt,
+			bool		   compact_vertices = false,
+			bool		   sdf_fonts		= false,
+			bool		   alpha8_fonts		= false);
 
 		auto invalidate_device_objects() noexcept -> mu::leaf::result<void>;
-		auto invalidate_font_objects() noexcept -> mu::leaf::result<void>;
-		auto create_device_objects(float scale, bool force) noexcept -> mu::leaf::result<void>;
+		auto create_device_objects(bool force) noexcept -> mu::leaf::result<void>;
 		auto create_device_objects() noexcept -> mu::leaf::result<void>;
-		auto create_fonts_texture(float scale) noexcept -> mu::leaf::result<void>;
 
 		RefCntAutoPtr<IRenderDevice>		  m_device;
-		RefCntAutoPtr<ITexture>				  m_font_tex;
 		RefCntAutoPtr<IBuffer>				  m_vertex_constant_buffer;
 		RefCntAutoPtr<IPipelineState>		  m_pso;
-		RefCntAutoPtr<ITextureView>			  m_font_srv;
 		RefCntAutoPtr<IShaderResourceBinding> m_srb;
 		RefCntAutoPtr<IShader>				  m_vs;
 		RefCntAutoPtr<IShader>				  m_ps;
 		IShaderResourceVariable*			  m_texture_var = nullptr;
 
-		float				 m_scale = 1.0f;
+		// The ImGui pipeline for a font atlas of distance fields or of a single channel, see imgui_font_resources. Only created with
+		// sdf_fonts or alpha8_fonts.
+		RefCntAutoPtr<IPipelineState>		  m_font_pso;
+		RefCntAutoPtr<IShaderResourceBinding> m_font_srb;
+		RefCntAutoPtr<IShader>				  m_font_ps;
+		IShaderResourceVariable*			  m_font_texture_var = nullptr;
+
+		// Draws the batches of mu::gfx_primitives_callback, one instance per primitive. Not created on Metal.
+		RefCntAutoPtr<IPipelineState>		  m_primitive_pso;
+		RefCntAutoPtr<IShaderResourceBinding> m_primitive_srb;
+		RefCntAutoPtr<IShader>				  m_primitive_vs;
+		RefCntAutoPtr<IShader>				  m_primitive_ps;
+		IShaderResourceVariable*			  m_primitive_texture_var = nullptr;
+
 		const TEXTURE_FORMAT m_back_buffer_fmt;
 		const TEXTURE_FORMAT m_depth_buffer_fmt;
+		const bool			 m_compact_vertices; // the pipeline takes imgui_compact_vert instead of ImDrawVert
+		const bool			 m_sdf_fonts;		 // the primitive pipeline samples a font atlas of distance fields
+		const bool			 m_alpha8_fonts;	 // the primitive pipeline samples single channel textures
+	};
+
+	// ImDrawVert in 12 bytes instead of 20: the position in quarter pixels from the display's top left corner, 16-bit normalized
+	// texture coordinates and the colour as is. Positions further than 8191 pixels from that corner and texture coordinates
+	// outside [0, 1] are clamped.
+	struct imgui_compact_vert
+	{
+		Int16  m_pos[2];
+		Uint16 m_uv[2];
+		ImU32  m_col;
+	};
+	static_assert(sizeof(imgui_compact_vert) == 12);
+
+	// Converts count vertices of a display whose top left corner is origin, two at a time with SSE2 where available.
+	auto compact_vertices(const ImDrawVert* src, int count, ImVec2 origin, imgui_compact_vert* dst) noexcept -> void;
+
+	// Writes the distance field of width x height coverage texels to out, rows out_stride bytes apart: 0.5 on the edge of what is
+	// covered, spanning [0, 1] over spread texels either side of it.
+	auto distance_field(const unsigned char* coverage, int width, int height, int spread, unsigned char* out, int out_stride) noexcept -> void;
+
+	// A font atlas and its texture, built at one scale and shared by the ImGui contexts drawing at it. NewFrame and EndFrame of
+	// those contexts all toggle m_atlas' Locked flag, so they hold m_atlas_mutex.
+	//
+	// With sdf, the glyphs are stored as signed distance fields at s_sdf_scale, whatever the scale asked for, and drawn at any
+	// size through the SDF pipeline: alpha 0.5 on a glyph's edge, s_sdf_spread atlas pixels either side of it spanning [0, 1].
+	// Everything else in the atlas, e.g. the white texel, keeps its coverage.
+	//
+	// With alpha8, the atlas is an R8 texture of coverage or distances, a quarter of RGBA's memory, expanded to white with that
+	// alpha by the font pipeline. Coloured glyphs lose their colours.
+	//
+	// With a glyph font, the glyphs gfx_add_text needs beyond the atlas' ranges come from m_glyph_cache, lined up with the atlas font
+	// and built the same way.
+	struct imgui_font_resources
+	{
+		static constexpr float s_sdf_scale	= 2.0f;
+		static constexpr int   s_sdf_spread = 4;
+
+		explicit imgui_font_resources(IRenderDevice* render_device, bool sdf = false, bool alpha8 = false, std::string glyph_font = {});
+
+		auto invalidate_font_objects() noexcept -> mu::leaf::result<void>;
+
+		// Builds m_atlas at scale, unless it already was. The previous texture must no longer be in use.
+		auto create_fonts_texture(float scale, bool force) noexcept -> mu::leaf::result<void>;
+
+		std::shared_ptr<ImFontAtlas>	 m_atlas = std::make_shared<ImFontAtlas>();
+		std::mutex						 m_atlas_mutex;
+		RefCntAutoPtr<IRenderDevice>	 m_device;
+		RefCntAutoPtr<ITexture>			 m_font_tex;
+		RefCntAutoPtr<ITextureView>		 m_font_srv;
+		std::shared_ptr<mu::glyph_cache> m_glyph_cache;
+
+		const bool		  m_sdf;
+		const bool		  m_alpha8;
+		const std::string m_glyph_font; // path of a font file, none when empty
+		float			  m_scale = 0.0f;
+		ImVec2			  m_white_uv; // the atlas' solid white texel, what ImGui samples for untextured shapes
+	};
+
+	// What gfx_add_* find behind ImGuiIO::BackendRendererUserData: the renderer's pipelines and the fonts of the window's context.
+	struct imgui_backend_data
+	{
+		imgui_shared_resources* m_shared_resources = nullptr;
+		imgui_font_resources*	m_font_resources   = nullptr;
+	};
+
+	// True when the first thing draw_data draws is an opaque quad covering its whole display area, e.g. a fullscreen window
+	// background, so clearing the target beforehand would be wasted. Does not touch the ImGui context.
+	[[nodiscard]] auto covers_viewport(const ImDrawData* draw_data, ImTextureID white_texture, ImVec2 white_uv) noexcept -> bool;
+
+	// What the last render_draw_data call did, for benchmarks and diagnostics.
+	struct imgui_render_stats
+	{
+		Uint64 m_bytes_uploaded = 0;
+		Uint32 m_draws			= 0;
+		Uint32 m_callbacks		= 0;
+		Uint32 m_texture_binds	= 0;
+		Uint32 m_culled			= 0; // commands with nothing to draw inside the display or the damage
+		Uint32 m_lists_cached	= 0; // drawn from geometry uploaded by an earlier frame
+		Uint32 m_lists_uploaded = 0;
+		Uint32 m_primitives		= 0; // instances drawn by the primitive pipeline
+	};
+
+	// First fit sub-allocation of element ranges in a buffer. Freed ranges merge with their free neighbours.
+	struct range_allocator
+	{
+		std::vector<std::pair<Uint32, Uint32>> m_free; // offset, size; sorted by offset
+
+		auto reset(Uint32 capacity) -> void;
+		[[nodiscard]] auto allocate(Uint32 size, Uint32& offset) -> bool;
+		auto free(Uint32 offset, Uint32 size) -> void;
+	};
+
+	// The geometry of recently drawn lists, left in the renderer's buffers and keyed by content, so that a list which is the same
+	// as one drawn before is not uploaded again. Buffer updates are ordered with the draws on the GPU, so a range can be reused
+	// as soon as no list of the current frame refers to it.
+	struct imgui_geometry_cache
+	{
+		struct key
+		{
+			Uint32 m_vtx_hash  = 0;
+			Uint32 m_idx_hash  = 0;
+			Uint32 m_vtx_count = 0;
+			Uint32 m_idx_count = 0;
+
+			auto operator==(const key&) const -> bool = default;
+		};
+
+		struct key_hash
+		{
+			auto operator()(const key& k) const noexcept -> std::size_t
+			{
+				return (static_cast<std::size_t>(k.m_vtx_hash) << 32 | k.m_idx_hash) ^ (static_cast<std::size_t>(k.m_vtx_count) << 16) ^ k.m_idx_count;
+			}
+		};
+
+		struct entry
+		{
+			Uint32 m_vtx_offset = 0; // elements
+			Uint32 m_idx_offset = 0;
+			Uint64 m_frame		= 0; // last frame the entry was drawn in
+		};
+
+		std::unordered_map<key, entry, key_hash> m_entries;
+		range_allocator							 m_vertices;
+		range_allocator							 m_indices;
+		Uint32									 m_vertex_capacity = 0;
+		Uint32									 m_index_capacity  = 0;
+		Uint64									 m_frame		   = 0;
+
+		auto reset(Uint32 vertex_capacity, Uint32 index_capacity) -> void;
+
+		// Frees every entry the current frame has not drawn. False when there was none.
+		auto evict() -> bool;
+	};
+
+	// Restricts render_draw_data to the part of the target that changed, every other pixel keeps what the previous frame drew.
+	struct imgui_damage
+	{
+		ImVec4 m_rect; // display coordinates, like ImDrawCmd::ClipRect
+
+		// When set, m_rect is first filled with m_background, standing in for the clear of a full redraw
+		ITextureView* m_white_texture = nullptr;
+		ImVec2		  m_white_uv;
+		ImU32		  m_background = 0;
+	};
+
+	// What render_draw_data issues for one command: a callback, or a draw with its clip rect already made a scissor rect. The
+	// background quad of a partial redraw has no command and the index of the placement after the lists.
+	struct imgui_draw_item
+	{
+		const ImDrawCmd* m_cmd	= nullptr;
+		Uint32			 m_list = 0; // index into ImDrawData::CmdLists and imgui_renderer::m_placements
+		Int32			 m_scissor[4]{}; // left, top, right, bottom in pixels of the pre-transformed surface
 	};
 
 	struct imgui_renderer
@@ -56,15 +241,59 @@ namespace Diligent
 
 		~imgui_renderer();
 
-		[[nodiscard]] auto render_draw_data(SURFACE_TRANSFORM surface_pre_transform, Uint32 render_surface_width, Uint32 render_surface_height, IDeviceContext* ctx, ImDrawData* draw_data) noexcept
-			-> mu::leaf::result<void>;
+		[[nodiscard]] auto render_draw_data(
+			SURFACE_TRANSFORM	surface_pre_transform,
+			Uint32				render_surface_width,
+			Uint32				render_surface_height,
+			mu::render_context* ctx,
+			ImDrawData*			draw_data,
+			const imgui_damage* damage = nullptr) noexcept -> mu::leaf::result<void>;
+
+		// Shrinks the buffers to the smallest that render_draw_data would grow them to for the last frame, but no smaller than
+		// s_min_buffer_size elements. They are created again, empty of cached geometry, by the next frame. False when they were
+		// already that small.
+		auto trim() noexcept -> bool;
+
+		// Bytes of the vertex and index buffers.
+		[[nodiscard]] auto buffer_bytes() const noexcept -> Uint64;
+
+		// Writes the geometry placed by the current frame into the staging buffers, one map each, then copies it into place.
+		auto upload_placed(mu::render_context* ctx, ImVec2 display_pos) -> void;
+
+		static constexpr Uint32 s_min_buffer_size = 4096;
 
 		std::shared_ptr<imgui_shared_resources> m_shared_resources;
 
+		ITextureView* m_font_texture = nullptr; // drawn through the font pipeline: the font atlas, unless it is plain RGBA coverage
+
+		// Geometry of a list placed by the current frame that is not in the buffers yet
+		struct pending_upload
+		{
+			const ImDrawVert* m_vtx		   = nullptr;
+			const ImDrawIdx*  m_idx		   = nullptr;
+			Uint32			  m_vtx_count  = 0;
+			Uint32			  m_idx_count  = 0;
+			Uint32			  m_vtx_offset = 0; // elements
+			Uint32			  m_idx_offset = 0;
+		};
+
 		RefCntAutoPtr<IBuffer> m_vertex_buffer;
 		RefCntAutoPtr<IBuffer> m_index_buffer;
+		RefCntAutoPtr<IBuffer> m_vertex_staging; // dynamic, so each frame maps fresh memory of the context's upload ring
+		RefCntAutoPtr<IBuffer> m_index_staging;
 
 		Uint32			  m_vertex_buffer_size	  = 0;
 		Uint32			  m_index_buffer_size	  = 0;
+		Uint32			  m_last_vtx_count		  = 0; // what the last frame drew, the background quad included
+		Uint32			  m_last_idx_count		  = 0;
+		Uint32			  m_vertex_staging_size	  = 0; // elements
+		Uint32			  m_index_staging_size	  = 0;
+
+		imgui_geometry_cache					 m_cache;
+		std::vector<imgui_geometry_cache::entry> m_placements; // of each list of the frame being drawn, then the background quad
+		std::vector<pending_upload>				 m_uploads;	   // of the frame being drawn
+		std::vector<imgui_draw_item>			 m_items;	   // of the frame being drawn
+
+		imgui_render_stats m_stats;
 	};
 } // namespace Diligent
@@ -0,0 +1,192 @@
+#include "mu_gfx_impl.h"
+
+#include "input_recording.h"
+
+#include <GLFW/glfw3.h>
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+namespace mu
+{
+	auto apply_key_event(ImGuiIO& io, int key, int action) noexcept -> void
+	{
+		if (key < 0 || key >= IM_ARRAYSIZE(io.KeysDown)) [[unlikely]]
+		{
+			return;
+		}
+
+		if (action == GLFW_PRESS)
+		{
+			io.KeysDown[key] = true;
+		}
+
+		if (action == GLFW_RELEASE)
+		{
+			io.KeysDown[key] = false;
+		}
+
+		// Modifiers are not reliable across systems
+		io.KeyCtrl	= io.KeysDown[GLFW_KEY_LEFT_CONTROL] || io.KeysDown[GLFW_KEY_RIGHT_CONTROL];
+		io.KeyShift = io.KeysDown[GLFW_KEY_LEFT_SHIFT] || io.KeysDown[GLFW_KEY_RIGHT_SHIFT];
+		io.KeyAlt	= io.KeysDown[GLFW_KEY_LEFT_ALT] || io.KeysDown[GLFW_KEY_RIGHT_ALT];
+#ifdef _WIN32
+		io.KeySuper = false;
+#else
+		io.KeySuper = io.KeysDown[GLFW_KEY_LEFT_SUPER] || io.KeysDown[GLFW_KEY_RIGHT_SUPER];
+#endif
+	}
+
+	auto apply_input_event(ImGuiIO& io, const input_event& event) noexcept -> void
+	{
+		switch (event.m_type)
+		{
+		case input_event_type::scroll:
+			io.MouseWheelH += event.m_x;
+			io.MouseWheel += event.m_y;
+			break;
+
+		case input_event_type::key:
+			apply_key_event(io, event.m_a, event.m_b);
+			break;
+
+		case input_event_type::character:
+			io.AddInputCharacter(static_cast<unsigned int>(event.m_a));
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	auto input_recorder::record(input_event event) noexcept -> void
+	try
+	{
+		// Queued events carry the time they were received, anything else is stamped now
+		const auto start = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(m_start.time_since_epoch()).count());
+		const auto now	 = event.m_time_ns != 0
+							   ? event.m_time_ns
+							   : static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+
+		event.m_frame	= m_frame;
+		event.m_time_ns = now > start ? now - start : 0;
+		m_events.push_back(event);
+	}
+	catch (...)
+	{
+		MU_LEAF_LOG_ERROR(gfx_error::not_specified{});
+	}
+
+	auto input_recorder::record_frame(const ImGuiIO& io) noexcept -> void
+	{
+		input_event event;
+		event.m_type	 = input_event_type::frame;
+		event.m_x		 = io.MousePos.x;
+		event.m_y		 = io.MousePos.y;
+		event.m_z		 = io.DisplaySize.x;
+		event.m_w		 = io.DisplaySize.y;
+		event.m_viewport = io.MouseHoveredViewport;
+		for (int i = 0; i < IM_ARRAYSIZE(io.MouseDown); i++)
+		{
+			event.m_a |= io.MouseDown[i] ? (1 << i) : 0;
+		}
+
+		// The frame event closes the frame, discrete events recorded after it belong to the next one
+		record(event);
+		++m_frame;
+	}
+
+	auto input_recorder::save(const char* path) const noexcept -> leaf::result<void>
+	{
+		auto file = std::unique_ptr<std::FILE, int (*)(std::FILE*)>(std::fopen(path, "wb"), &std::fclose);
+		if (!file) [[unlikely]]
+		{
+			return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+		}
+
+		input_recording_header header;
+		header.m_events = static_cast<std::uint32_t>(m_events.size());
+		if (std::fwrite(&header, sizeof(header), 1, file.get()) != 1 ||
+			(!m_events.empty() && std::fwrite(m_events.data(), sizeof(input_event), m_events.size(), file.get()) != m_events.size())) [[unlikely]]
+		{
+			return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+		}
+
+		if (std::fclose(file.release()) != 0) [[unlikely]]
+		{
+			return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+		}
+		return {};
+	}
+
+	auto input_player::load(const char* path) noexcept -> leaf::result<void>
+	try
+	{
+		auto file = std::unique_ptr<std::FILE, int (*)(std::FILE*)>(std::fopen(path, "rb"), &std::fclose);
+		if (!file) [[unlikely]]
+		{
+			return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+		}
+
+		input_recording_header header;
+		input_recording_header expected;
+		if (std::fread(&header, sizeof(header), 1, file.get()) != 1 || std::memcmp(header.m_magic, expected.m_magic, sizeof(header.m_magic)) != 0 ||
+			header.m_version != expected.m_version) [[unlikely]]
+		{
+			return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+		}
+
+		m_events.resize(header.m_events);
+		if (!m_events.empty() && std::fread(m_events.data(), sizeof(input_event), m_events.size(), file.get()) != m_events.size()) [[unlikely]]
+		{
+			return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+		}
+
+		m_next	= 0;
+		m_frame = 0;
+		m_content_scales.clear();
+		return {};
+	}
+	catch (...)
+	{
+		return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+	}
+
+	auto input_player::apply_frame(ImGuiIO& io) noexcept -> void
+	{
+		io.DeltaTime = m_delta_time;
+
+		while (m_next < m_events.size() && m_events[m_next].m_frame == m_frame)
+		{
+			const auto& event = m_events[m_next++];
+			switch (event.m_type)
+			{
+			case input_event_type::frame:
+				io.DisplaySize			= ImVec2(event.m_z, event.m_w);
+				io.MousePos				= ImVec2(event.m_x, event.m_y);
+				io.MouseHoveredViewport = event.m_viewport;
+				for (int i = 0; i < IM_ARRAYSIZE(io.MouseDown); i++)
+				{
+					io.MouseDown[i] = (event.m_a & (1 << i)) != 0;
+				}
+				break;
+
+			case input_event_type::mouse_button:
+				// Already folded into the frame's button state, like m_mouse_just_pressed is live
+				break;
+
+			case input_event_type::content_scale:
+				// Taken up by the viewport's update_dpi
+				m_content_scales[event.m_viewport] = event.m_x;
+				break;
+
+			default:
+				apply_input_event(io, event);
+				break;
+			}
+		}
+
+		++m_frame;
+	}
+} // namespace mu
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <mu_gfx.h>
+
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace mu
+{
+	enum class input_event_type : std::uint32_t
+	{
+		frame,		   // per frame state polled by new_frame_sync: display size, mouse position/buttons, hovered viewport
+		mouse_button,  // m_a = button, m_b = action
+		scroll,		   // m_x, m_y = offsets
+		key,		   // m_a = key, m_b = action
+		character,	   // m_a = code point
+		content_scale, // m_x, m_y = scale, m_viewport = the viewport's id
+
+		// Window state for the per-viewport input cache. Never recorded, the frame event carries its effect.
+		cursor_pos,	  // m_x, m_y = window relative position
+		cursor_enter, // m_a = entered
+		focus,		  // m_a = focused
+		window_pos,	  // m_a, m_b = client area position
+	};
+
+	struct input_event
+	{
+		std::uint32_t	 m_frame{0};
+		input_event_type m_type{input_event_type::frame};
+		std::uint64_t	 m_time_ns{0}; // steady clock when queued, since the start of the recording once recorded
+		std::int32_t	 m_a{0};
+		std::int32_t	 m_b{0};
+		float			 m_x{0.0f};
+		float			 m_y{0.0f};
+		float			 m_z{0.0f}; // frame: display width
+		float			 m_w{0.0f}; // frame: display height
+		std::uint32_t	 m_viewport{0};
+	};
+
+	struct input_recording_header
+	{
+		char		  m_magic[8] = {'M', 'U', 'G', 'F', 'X', 'I', 'N', 'P'};
+		std::uint32_t m_version	 = 1;
+		std::uint32_t m_events	 = 0;
+	};
+
+	// Applies a key transition to io.
+	auto apply_key_event(ImGuiIO& io, int key, int action) noexcept -> void;
+
+	// Applies a scroll, key or character event to io. Mouse buttons and frame state are up to the caller.
+	auto apply_input_event(ImGuiIO& io, const input_event& event) noexcept -> void;
+
+	// Collects the input events of an application state in memory, written out on save so recording does no I/O per frame.
+	struct input_recorder
+	{
+		std::vector<input_event>			  m_events;
+		std::chrono::steady_clock::time_point m_start{std::chrono::steady_clock::now()};
+		std::uint32_t						  m_frame{0};
+
+		auto record(input_event event) noexcept -> void;
+		auto record_frame(const ImGuiIO& io) noexcept -> void;
+
+		[[nodiscard]] auto save(const char* path) const noexcept -> leaf::result<void>;
+	};
+
+	// Feeds a recording back into ImGui one frame at a time, with a fixed delta time instead of the wall clock.
+	struct input_player
+	{
+		std::vector<input_event> m_events;
+		std::size_t				 m_next{0};
+		std::uint32_t			 m_frame{0};
+		float					 m_delta_time{1.0f / 60.0f};
+
+		std::unordered_map<ImGuiID, float> m_content_scales; // the last replayed of each viewport
+
+		[[nodiscard]] auto load(const char* path) noexcept -> leaf::result<void>;
+
+		[[nodiscard]] auto finished() const noexcept -> bool
+		{
+			return m_next >= m_events.size();
+		}
+
+		// Injects every event of the next recorded frame into io, including its DeltaTime.
+		auto apply_frame(ImGuiIO& io) noexcept -> void;
+	};
+} // namespace mu
@@ -0,0 +1,273 @@
+#include "mu_gfx_impl.h"
+
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace mu
+{
+	mapped_file::~mapped_file()
+	{
+		if (auto res = close(); !res) [[unlikely]]
+		{
+			MU_LEAF_LOG_ERROR(gfx_error::not_specified{});
+		}
+	}
+
+#ifdef _WIN32
+	auto mapped_file::map(std::size_t capacity) noexcept -> leaf::result<void>
+	{
+		const auto protect = m_writable ? PAGE_READWRITE : PAGE_READONLY;
+		m_mapping		   = CreateFileMappingA(
+			 static_cast<HANDLE>(m_file),
+			 nullptr,
+			 protect,
+			 static_cast<DWORD>(static_cast<std::uint64_t>(capacity) >> 32),
+			 static_cast<DWORD>(capacity & 0xffffffffu),
+			 nullptr);
+		if (m_mapping == nullptr) [[unlikely]]
+		{
+			return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+		}
+
+		m_data = static_cast<std::byte*>(MapViewOfFile(static_cast<HANDLE>(m_mapping), m_writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, capacity));
+		if (m_data == nullptr) [[unlikely]]
+		{
+			CloseHandle(static_cast<HANDLE>(m_mapping));
+			m_mapping = nullptr;
+			return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+		}
+
+		m_capacity = capacity;
+		return {};
+	}
+
+	auto mapped_file::unmap() noexcept -> void
+	{
+		if (m_data != nullptr)
+		{
+			UnmapViewOfFile(m_data);
+			m_data = nullptr;
+		}
+		if (m_mapping != nullptr)
+		{
+			CloseHandle(static_cast<HANDLE>(m_mapping));
+			m_mapping = nullptr;
+		}
+	}
+
+	auto mapped_file::open_read(const char* path) noexcept -> leaf::result<void>
+	{
+		MU_LEAF_CHECK(close());
+
+		auto file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) [[unlikely]]
+		{
+			return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+		}
+		m_file	   = file;
+		m_writable = false;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) [[unlikely]]
+		{
+			MU_LEAF_CHECK(close());
+			return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+		}
+
+		if (auto res = map(static_cast<std::size_t>(size.QuadPart)); !res) [[unlikely]]
+		{
+			MU_LEAF_CHECK(close());
+			return res;
+		}
+		m_size = m_capacity;
+		return {};
+	}
+
+	auto mapped_file::open_append(const char* path, std::size_t initial_capacity) noexcept -> leaf::result<void>
+	{
+		MU_LEAF_CHECK(close());
+
+		auto file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) [[unlikely]]
+		{
+			return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+		}
+		m_file	   = file;
+		m_writable = true;
+		m_size	   = 0;
+
+		if (auto res = map(std::max<std::size_t>(initial_capacity, 4096)); !res) [[unlikely]]
+		{
+			MU_LEAF_CHECK(close());
+			return res;
+		}
+		return {};
+	}
+
+	auto mapped_file::close() noexcept -> leaf::result<void>
+	{
+		unmap();
+
+		bool failed = false;
+		if (m_file != nullptr)
+		{
+			if (m_writable)
+			{
+				LARGE_INTEGER size;
+				size.QuadPart = static_cast<LONGLONG>(m_size);
+				failed |= !SetFilePointerEx(static_cast<HANDLE>(m_file), size, nullptr, FILE_BEGIN) || !SetEndOfFile(static_cast<HANDLE>(m_file));
+			}
+			CloseHandle(static_cast<HANDLE>(m_file));
+			m_file = nullptr;
+		}
+
+		m_size	   = 0;
+		m_capacity = 0;
+		if (failed) [[unlikely]]
+		{
+			return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+		}
+		return {};
+	}
+#else
+	auto mapped_file::map(std::size_t capacity) noexcept -> leaf::result<void>
+	{
+		if (m_writable && ::ftruncate(m_fd, static_cast<off_t>(capacity)) != 0) [[unlikely]]
+		{
+			return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+		}
+
+		auto data = ::mmap(nullptr, capacity, m_writable ? PROT_READ | PROT_WRITE : PROT_READ, m_writable ? MAP_SHARED : MAP_PRIVATE, m_fd, 0);
+		if (data == MAP_FAILED) [[unlikely]]
+		{
+			return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+		}
+
+		m_data	   = static_cast<std::byte*>(data);
+		m_capacity = capacity;
+		return {};
+	}
+
+	auto mapped_file::unmap() noexcept -> void
+	{
+		if (m_data != nullptr)
+		{
+			::munmap(m_data, m_capacity);
+			m_data = nullptr;
+		}
+	}
+
+	auto mapped_file::open_read(const char* path) noexcept -> leaf::result<void>
+	{
+		MU_LEAF_CHECK(close());
+
+		m_fd = ::open(path, O_RDONLY);
+		if (m_fd < 0) [[unlikely]]
+		{
+			return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+		}
+		m_writable = false;
+
+		struct stat st;
+		if (::fstat(m_fd, &st) != 0 || st.st_size == 0) [[unlikely]]
+		{
+			MU_LEAF_CHECK(close());
+			return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+		}
+
+		if (auto res = map(static_cast<std::size_t>(st.st_size)); !res) [[unlikely]]
+		{
+			MU_LEAF_CHECK(close());
+			return res;
+		}
+		m_size = m_capacity;
+		return {};
+	}
+
+	auto mapped_file::open_append(const char* path, std::size_t initial_capacity) noexcept -> leaf::result<void>
+	{
+		MU_LEAF_CHECK(close());
+
+		m_fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (m_fd < 0) [[unlikely]]
+		{
+			return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+		}
+		m_writable = true;
+		m_size	   = 0;
+
+		if (auto res = map(std::max<std::size_t>(initial_capacity, 4096)); !res) [[unlikely]]
+		{
+			MU_LEAF_CHECK(close());
+			return res;
+		}
+		return {};
+	}
+
+	auto mapped_file::close() noexcept -> leaf::result<void>
+	{
+		unmap();
+
+		bool failed = false;
+		if (m_fd >= 0)
+		{
+			if (m_writable)
+			{
+				failed |= ::ftruncate(m_fd, static_cast<off_t>(m_size)) != 0;
+			}
+			failed |= ::close(m_fd) != 0;
+			m_fd = -1;
+		}
+
+		m_size	   = 0;
+		m_capacity = 0;
+		if (failed) [[unlikely]]
+		{
+			return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+		}
+		return {};
+	}
+#endif
+
+	auto mapped_file::append(const void* data, std::size_t size) noexcept -> leaf::result<std::size_t>
+	{
+		if (!m_writable || m_data == nullptr) [[unlikely]]
+		{
+			return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+		}
+
+		if (m_size + size > m_capacity)
+		{
+			auto capacity = m_capacity;
+			while (m_size + size > capacity)
+			{
+				capacity *= 2;
+			}
+
+			unmap();
+			MU_LEAF_CHECK(map(capacity));
+		}
+
+		const auto offset = m_size;
+		std::memcpy(m_data + offset, data, size);
+		m_size += size;
+		return offset;
+	}
+} // namespace mu
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <mu_gfx.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace mu
+{
+	// A file accessed through a memory mapping, either read-only or as an append-only writer.
+	//
+	// Writers reserve address space ahead of the data and remap at twice the capacity when an append does not fit, so appending is
+	// a memcpy in the common case. close() truncates the file to the bytes actually appended.
+	struct mapped_file
+	{
+		std::byte*	m_data{nullptr};
+		std::size_t m_size{0};
+		std::size_t m_capacity{0};
+		bool		m_writable{false};
+
+#ifdef _WIN32
+		void* m_file{nullptr};
+		void* m_mapping{nullptr};
+#else
+		int m_fd{-1};
+#endif
+
+		mapped_file() = default;
+		~mapped_file();
+
+		mapped_file(const mapped_file&)			   = delete;
+		mapped_file& operator=(const mapped_file&) = delete;
+
+		[[nodiscard]] auto open_read(const char* path) noexcept -> leaf::result<void>;
+		[[nodiscard]] auto open_append(const char* path, std::size_t initial_capacity = 16 * 1024 * 1024) noexcept -> leaf::result<void>;
+		[[nodiscard]] auto close() noexcept -> leaf::result<void>;
+
+		// Returns the offset the data was written at.
+		[[nodiscard]] auto append(const void* data, std::size_t size) noexcept -> leaf::result<std::size_t>;
+
+		template<typename T>
+		[[nodiscard]] auto append(const T& value) noexcept -> leaf::result<std::size_t>
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			return append(&value, sizeof(T));
+		}
+
+		[[nodiscard]] auto is_open() const noexcept -> bool
+		{
+			return m_data != nullptr;
+		}
+
+	private:
+		[[nodiscard]] auto map(std::size_t capacity) noexcept -> leaf::result<void>;
+		auto			   unmap() noexcept -> void;
+	};
+} // namespace mu
@@ -1,13 +1,23 @@
 #pragma once
 
 #include <mu_stdlib.h>
+#include <mu_gfx.h>
+#include <mu_gfx_trace.h>
 
 #include <Graphics/GraphicsEngineD3D12/interface/EngineFactoryD3D12.h>
 #include <Graphics/GraphicsEngine/interface/RenderDevice.h>
 #include <Graphics/GraphicsEngine/interface/DeviceContext.h>
 #include <Graphics/GraphicsEngine/interface/SwapChain.h>
+#include <Graphics/GraphicsAccessories/interface/GraphicsAccessories.hpp>
 #include <Common/interface/RefCntAutoPtr.hpp>
 
+#include "render_context.h"
+#include "submission_queue.h"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+
 namespace mu
 {
 	// TODO: glfw error type using glfwGetError(const char** description);
@@ -17,17 +27,31 @@ namespace mu
 		Diligent::RefCntAutoPtr<Diligent::IRenderDevice>	   m_device;
 		Diligent::RefCntAutoPtr<Diligent::IDeviceContext>	   m_immediate_context;
 		Diligent::RefCntAutoPtr<Diligent::IEngineFactoryD3D12> m_engine_factory;
+		std::unique_ptr<submission_queue>					   m_submission_queue; // the only user of m_immediate_context once frames run
+		const gfx_render_options							   m_render_options;
 
-		diligent_globals()
+		explicit diligent_globals(const gfx_render_options& render_options = {}) : m_render_options(render_options)
 		{
 			m_engine_factory = Diligent::GetEngineFactoryD3D12();
 
 			Diligent::EngineD3D12CreateInfo EngineCI;
 			m_engine_factory->CreateDeviceAndContextsD3D12(EngineCI, &m_device, &m_immediate_context);
+
+			m_submission_queue = std::make_unique<submission_queue>();
 		}
 
 		~diligent_globals()
 		{
+			try
+			{
+				// Drains, queued jobs still use the device
+				m_submission_queue.reset();
+			}
+			catch (...)
+			{
+				MU_LEAF_LOG_ERROR(mu::gfx_error::not_specified{});
+			}
+
 			try
 			{
 				m_device.Release();
@@ -50,16 +74,72 @@ namespace mu
 
 	struct diligent_window
 	{
-		std::shared_ptr<diligent_globals>				  m_globals;
-		Diligent::RefCntAutoPtr<Diligent::ISwapChain>	  m_swap_chain;
+		std::shared_ptr<diligent_globals>			  m_globals;
+		Diligent::RefCntAutoPtr<Diligent::ISwapChain> m_swap_chain;
+		gfx_resize_policy							  m_resize_policy;
+		std::array<int, 2>							  m_requested_size{0, 0};
+		int											  m_stable_frames{0}; // frames m_requested_size has not changed for
+
+		// With gfx_render_options::m_partial_redraw frames are drawn here and copied to the back buffer, whose contents do not
+		// survive a flip. Lost until a frame was fully drawn into it.
+		Diligent::RefCntAutoPtr<Diligent::ITexture> m_canvas;
+		bool										m_canvas_lost{true};
+
+		static constexpr float s_clear_color[4] = {0.350f, 0.350f, 0.350f, 1.000f};
+
+		[[nodiscard]] static auto round_up(int size, int bucket) noexcept -> Diligent::Uint32
+		{
+			bucket = bucket > 1 ? bucket : 1;
+			return static_cast<Diligent::Uint32>((size + bucket - 1) / bucket * bucket);
+		}
 
+		// Grows the swap chain at once when the size does not fit, otherwise waits for the size to settle before resizing, see
+		// gfx_resize_policy. Rendering into a corner of a larger buffer relies on the swap chain presenting without scaling, which is
+		// how Diligent creates swap chains for Win32 windows (DXGI_SCALING_NONE).
 		[[nodiscard]] auto create_resources(int sizeX, int sizeY) noexcept -> mu::leaf::result<void>
 		try
 		{
+			// Minimized
+			if (sizeX <= 0 || sizeY <= 0)
+			{
+				return {};
+			}
+
+			if (m_requested_size[0] != sizeX || m_requested_size[1] != sizeY)
+			{
+				m_requested_size = {sizeX, sizeY};
+				m_stable_frames	 = 0;
+			}
+			else if (m_stable_frames < m_resize_policy.m_stable_frames)
+			{
+				++m_stable_frames;
+			}
+
 			const auto& swapchain_desc = m_swap_chain->GetDesc();
-			if (swapchain_desc.Width != sizeX || swapchain_desc.Height != sizeY)
+			const auto	width		   = round_up(sizeX, m_resize_policy.m_bucket);
+			const auto	height		   = round_up(sizeY, m_resize_policy.m_bucket);
+			const bool	fits		   = swapchain_desc.Width >= static_cast<Diligent::Uint32>(sizeX) && swapchain_desc.Height >= static_cast<Diligent::Uint32>(sizeY);
+			const bool	settled		   = m_stable_frames >= m_resize_policy.m_stable_frames;
+			if ((!fits || settled) && (swapchain_desc.Width != width || swapchain_desc.Height != height))
 			{
-				m_swap_chain->Resize(sizeX, sizeY);
+				MU_GFX_TRACE_SCOPE("Resize");
+				m_swap_chain->Resize(width, height);
+			}
+
+			if (m_globals->m_render_options.m_partial_redraw &&
+				(!m_canvas || m_canvas->GetDesc().Width != swapchain_desc.Width || m_canvas->GetDesc().Height != swapchain_desc.Height))
+			{
+				Diligent::TextureDesc canvas_desc;
+				canvas_desc.Name	  = "Canvas";
+				canvas_desc.Type	  = Diligent::RESOURCE_DIM_TEX_2D;
+				canvas_desc.Width	  = swapchain_desc.Width;
+				canvas_desc.Height	  = swapchain_desc.Height;
+				canvas_desc.Format	  = swapchain_desc.ColorBufferFormat;
+				canvas_desc.BindFlags = Diligent::BIND_RENDER_TARGET;
+
+				m_canvas.Release();
+				m_globals->m_device->CreateTexture(canvas_desc, nullptr, &m_canvas);
+				m_canvas_lost = true;
 			}
 
 			return {};
@@ -69,22 +149,49 @@ namespace mu
 			return MU_LEAF_NEW_ERROR(mu::gfx_error::not_specified{});
 		}
 
-		[[nodiscard]] auto clear() noexcept -> mu::leaf::result<void>
+		// What frames are drawn into: the canvas when there is one, otherwise the current back buffer.
+		[[nodiscard]] auto target_rtv() noexcept -> Diligent::ITextureView*
+		{
+			return m_canvas ? m_canvas->GetDefaultView(Diligent::TEXTURE_VIEW_RENDER_TARGET) : m_swap_chain->GetCurrentBackBufferRTV();
+		}
+
+		// Binds the render target. clear_color is false when the frame is known to overwrite every pixel anyway, or to redraw only
+		// part of the canvas.
+		[[nodiscard]] auto clear(render_context* ctx, bool clear_color = true) noexcept -> mu::leaf::result<void>
 		try
 		{
 			// Set render targets before issuing any draw command.
 			// Note that Present() unbinds the back buffer if it is set as render target.
-			Diligent::ITextureView* last_backbuffer_rtv	 = m_swap_chain->GetCurrentBackBufferRTV();
-			Diligent::ITextureView* last_depthbuffer_rtv = m_swap_chain->GetDepthBufferDSV();
-			m_globals->m_immediate_context->SetRenderTargets(1, &last_backbuffer_rtv, last_depthbuffer_rtv, Diligent::RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
-
-			// Clear the back buffer
-			const float clear_color[] = {0.350f, 0.350f, 0.350f, 1.000f};
+			Diligent::ITextureView* last_backbuffer_rtv	 = target_rtv();
+			Diligent::ITextureView* last_depthbuffer_rtv = m_swap_chain->GetDepthBufferDSV(); // null without a depth buffer
+			ctx->set_render_target(last_backbuffer_rtv, last_depthbuffer_rtv);
 
 			// Let the engine perform required state transitions
-			m_globals->m_immediate_context->ClearRenderTarget(last_backbuffer_rtv, clear_color, Diligent::RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
-			m_globals->m_immediate_context->ClearDepthStencil(last_depthbuffer_rtv, Diligent::CLEAR_DEPTH_FLAG, 1.f, 0, Diligent::RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+			if (clear_color)
+			{
+				ctx->clear_render_target(last_backbuffer_rtv, s_clear_color);
+			}
 
+			if (last_depthbuffer_rtv != nullptr)
+			{
+				ctx->clear_depth(last_depthbuffer_rtv, 1.f);
+			}
+
+			return {};
+		}
+		catch (...)
+		{
+			return MU_LEAF_NEW_ERROR(mu::gfx_error::not_specified{});
+		}
+
+		// Copies the canvas to the back buffer, once the frame is drawn.
+		[[nodiscard]] auto resolve(render_context* ctx) noexcept -> mu::leaf::result<void>
+		try
+		{
+			if (m_canvas)
+			{
+				ctx->copy_texture(m_canvas->GetDefaultView(Diligent::TEXTURE_VIEW_RENDER_TARGET), m_swap_chain->GetCurrentBackBufferRTV());
+			}
 			return {};
 		}
 		catch (...)
@@ -92,10 +199,33 @@ namespace mu
 			return MU_LEAF_NEW_ERROR(mu::gfx_error::not_specified{});
 		}
 
-		[[nodiscard]] auto present() noexcept -> mu::leaf::result<void>
+		[[nodiscard]] static auto texture_bytes(Diligent::Uint32 width, Diligent::Uint32 height, Diligent::TEXTURE_FORMAT format) noexcept -> std::uint64_t
+		{
+			const auto& attribs = Diligent::GetTextureFormatAttribs(format);
+			return static_cast<std::uint64_t>(width) * height * attribs.ComponentSize * attribs.NumComponents;
+		}
+
+		// Adds the swap chain's buffers and the canvas to stats.
+		auto memory_stats(gfx_memory_stats& stats) const noexcept -> void
+		{
+			const auto& desc = m_swap_chain->GetDesc();
+			stats.m_swap_chains += texture_bytes(desc.Width, desc.Height, desc.ColorBufferFormat) * desc.BufferCount;
+			if (desc.DepthBufferFormat != Diligent::TEX_FORMAT_UNKNOWN)
+			{
+				stats.m_depth_buffers += texture_bytes(desc.Width, desc.Height, desc.DepthBufferFormat);
+			}
+			if (m_canvas)
+			{
+				const auto& canvas_desc = m_canvas->GetDesc();
+				stats.m_canvases += texture_bytes(canvas_desc.Width, canvas_desc.Height, canvas_desc.Format);
+			}
+		}
+
+		[[nodiscard]] auto present(render_context* ctx) noexcept -> mu::leaf::result<void>
 		try
 		{
-			m_swap_chain->Present();
+			MU_GFX_TRACE_SCOPE("Present");
+			ctx->present(m_swap_chain, 1);
 			return {};
 		}
 		catch (...)
@@ -106,6 +236,10 @@ namespace mu
 		diligent_window(Diligent::Win32NativeWindow native_wnd, std::shared_ptr<diligent_globals> globals) : m_globals(globals)
 		{
 			Diligent::SwapChainDesc swapchain_desc;
+			if (!m_globals->m_render_options.m_depth_buffer)
+			{
+				swapchain_desc.DepthBufferFormat = Diligent::TEX_FORMAT_UNKNOWN;
+			}
 			m_globals->m_engine_factory->CreateSwapChainD3D12(m_globals->m_device, m_globals->m_immediate_context, swapchain_desc, Diligent::FullScreenModeDesc{}, native_wnd, &m_swap_chain);
 		}
 
@@ -113,6 +247,7 @@ namespace mu
 		{
 			try
 			{
+				m_canvas.Release();
 				m_swap_chain.Release();
 				m_globals.reset();
 			}
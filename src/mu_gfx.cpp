@@ -11,27 +11,154 @@
 
 #include "mu_diligent.h"
 #include "imgui_renderer.h"
-
+#include "glyph_cache.h"
+#include "command_log.h"
+#include "draw_capture.h"
+#include "input_recording.h"
+#include "spsc_queue.h"
+#include "draw_data_snapshot.h"
+#include "damage_tracker.h"
+#include "imgui_heap.h"
+#include "frame_graph.h"
+
+#include <imgui_internal.h>
+
+#include <map>
+#include <mutex>
 #include <unordered_map>
 
 namespace mu
 {
 	namespace details
 	{
+		// Bumped by the monitor callback, each application state refreshes its monitor list when it sees a new value.
+		inline std::atomic<std::uint32_t> g_monitor_generation{0};
+
 		struct glfw_system
 		{
 			int m_glfw_status = GLFW_FALSE;
 
-			//std::weak_ptr<diligent_globals> m_renderer_globals;
+			// Device, immediate context, ImGui pipeline and fonts, shared by every window. Only weakly held here, so they are created
+			// by the first window to need them and torn down with the last one.
+			std::mutex										m_renderer_mutex;
+			std::weak_ptr<diligent_globals>					m_renderer_globals;
+			std::weak_ptr<Diligent::imgui_shared_resources> m_imgui_shared_resources;
+			gfx_render_options								m_render_options; // applied when the device is created
+
+			// Font atlases and their textures by the scale they are built at, weakly held and guarded by m_renderer_mutex like the above.
+			std::map<float, std::weak_ptr<Diligent::imgui_font_resources>> m_imgui_font_resources;
+
+			// Standard cursors, created once for every window and viewport.
+			std::array<GLFWcursor*, ImGuiMouseCursor_COUNT> m_mouse_cursors{};
+
+			// The atlas and texture for windows at scale, built at that scale so that text stays sharp, unless another window already
+			// built them. Distance fields are built once, at their own scale, and drawn at any.
+			[[nodiscard]] auto imgui_font_resources(std::shared_ptr<diligent_globals> globals, float scale) noexcept
+				-> leaf::result<std::shared_ptr<Diligent::imgui_font_resources>>
+			try
+			{
+				std::unique_lock lock(m_renderer_mutex);
+				if (globals->m_render_options.m_sdf_fonts)
+				{
+					scale = Diligent::imgui_font_resources::s_sdf_scale;
+				}
+
+				auto& weak		= m_imgui_font_resources[scale];
+				auto  resources = weak.lock();
+				if (!resources)
+				{
+					resources = std::make_shared<Diligent::imgui_font_resources>(
+						globals->m_device,
+						globals->m_render_options.m_sdf_fonts,
+						globals->m_render_options.m_alpha8_fonts,
+						globals->m_render_options.m_glyph_font);
+
+					// Shared by the windows at scale, so charged to none of them
+					scoped_imgui_heap shared_heap(0);
+					MU_LEAF_CHECK(resources->create_fonts_texture(scale, true));
+					weak = resources;
+				}
+
+				std::erase_if(m_imgui_font_resources, [](const auto& entry) { return entry.second.expired(); });
+				return resources;
+			}
+			catch (...)
+			{
+				return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+			}
+
+			[[nodiscard]] auto renderer_globals() noexcept -> leaf::result<std::shared_ptr<diligent_globals>>
+			try
+			{
+				std::unique_lock lock(m_renderer_mutex);
+				auto			 globals = m_renderer_globals.lock();
+				if (!globals)
+				{
+					globals			   = std::make_shared<diligent_globals>(m_render_options);
+					m_renderer_globals = globals;
+				}
+				return globals;
+			}
+			catch (...)
+			{
+				return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+			}
+
+			// All swap chains are created with the same default formats, so one pipeline serves every window.
+			[[nodiscard]] auto imgui_shared_resources(std::shared_ptr<diligent_globals> globals, const Diligent::SwapChainDesc& swapchain_desc) noexcept
+				-> leaf::result<std::shared_ptr<Diligent::imgui_shared_resources>>
+			try
+			{
+				std::unique_lock lock(m_renderer_mutex);
+				auto			 resources = m_imgui_shared_resources.lock();
+				if (!resources)
+				{
+					resources = std::make_shared<Diligent::imgui_shared_resources>(
+						globals->m_device,
+						swapchain_desc.ColorBufferFormat,
+						swapchain_desc.DepthBufferFormat,
+						globals->m_render_options.m_compact_vertices,
+						globals->m_render_options.m_sdf_fonts,
+						globals->m_render_options.m_alpha8_fonts);
+					MU_LEAF_CHECK(resources->create_device_objects(true));
+					m_imgui_shared_resources = resources;
+				}
+				return resources;
+			}
+			catch (...)
+			{
+				return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+			}
 
 			glfw_system()
 			{
+				// Before any ImGui context allocates
+				install_imgui_heap();
+
 				m_glfw_status = glfwInit();
 
 				if (m_glfw_status != GLFW_TRUE) [[likely]]
 				{
 					MU_LEAF_THROW_EXCEPTION(gfx_error::not_specified{});
 				}
+
+				glfwSetMonitorCallback([](GLFWmonitor*, int) -> void { g_monitor_generation.fetch_add(1, std::memory_order_relaxed); });
+
+				// Create mouse cursors
+				// (By design, on X11 cursors are user configurable and some cursors may be missing. When a cursor doesn't exist,
+				// GLFW will emit an error which will often be printed by the app, so we temporarily disable error reporting.
+				// Missing cursors will return NULL and update_cursor will use the Arrow cursor instead.)
+				GLFWerrorfun prev_error_callback				= glfwSetErrorCallback(nullptr);
+				m_mouse_cursors[ImGuiMouseCursor_Arrow]			= glfwCreateStandardCursor(GLFW_ARROW_CURSOR);
+				m_mouse_cursors[ImGuiMouseCursor_TextInput]		= glfwCreateStandardCursor(GLFW_IBEAM_CURSOR);
+				m_mouse_cursors[ImGuiMouseCursor_ResizeNS]		= glfwCreateStandardCursor(GLFW_VRESIZE_CURSOR);
+				m_mouse_cursors[ImGuiMouseCursor_ResizeEW]		= glfwCreateStandardCursor(GLFW_HRESIZE_CURSOR);
+				m_mouse_cursors[ImGuiMouseCursor_Hand]			= glfwCreateStandardCursor(GLFW_HAND_CURSOR);
+				m_mouse_cursors[ImGuiMouseCursor_ResizeAll]		= glfwCreateStandardCursor(GLFW_RESIZE_ALL_CURSOR);
+				m_mouse_cursors[ImGuiMouseCursor_ResizeNESW]	= glfwCreateStandardCursor(GLFW_RESIZE_NESW_CURSOR);
+				m_mouse_cursors[ImGuiMouseCursor_ResizeNWSE]	= glfwCreateStandardCursor(GLFW_RESIZE_NWSE_CURSOR);
+				m_mouse_cursors[ImGuiMouseCursor_NotAllowed]	= glfwCreateStandardCursor(GLFW_NOT_ALLOWED_CURSOR);
+				glfwSetErrorCallback(prev_error_callback);
 			}
 
 			virtual ~glfw_system()
@@ -41,6 +168,14 @@ namespace mu
 					m_glfw_status = GLFW_FALSE;
 					try
 					{
+						for (auto& cursor : m_mouse_cursors)
+						{
+							if (cursor != nullptr)
+							{
+								glfwDestroyCursor(std::exchange(cursor, nullptr));
+							}
+						}
+
 						glfwTerminate();
 					}
 					catch (...)
@@ -57,21 +192,255 @@ namespace mu
 {
 	namespace details
 	{
+		// What update_mouse needs to know about one viewport's GLFW window, kept current by its callbacks instead of polled every frame.
+		struct viewport_input_state
+		{
+			bool		  m_focused{false};
+			bool		  m_hovered{false};
+			bool		  m_passthrough{false}; // last GLFW_MOUSE_PASSTHROUGH value set
+			std::uint32_t m_buttons{0};			// bit per mouse button held
+			double		  m_cursor_x{0.0};
+			double		  m_cursor_y{0.0};
+			int			  m_pos_x{0};
+			int			  m_pos_y{0};
+
+			// Seeds the cache, the callbacks keep it current afterwards. Seeded again when the input queue overflowed.
+			auto init(GLFWwindow* window) noexcept -> void
+			{
+				m_focused	  = glfwGetWindowAttrib(window, GLFW_FOCUSED) != 0;
+				m_hovered	  = glfwGetWindowAttrib(window, GLFW_HOVERED) != 0;
+				m_passthrough = glfwGetWindowAttrib(window, GLFW_MOUSE_PASSTHROUGH) != 0;
+				glfwGetCursorPos(window, &m_cursor_x, &m_cursor_y);
+				glfwGetWindowPos(window, &m_pos_x, &m_pos_y);
+
+				m_buttons = 0;
+				for (int i = 0; i < ImGuiMouseButton_COUNT; i++)
+				{
+					m_buttons |= glfwGetMouseButton(window, i) != 0 ? (1u << i) : 0u;
+				}
+			}
+
+			auto apply(const input_event& event) noexcept -> void
+			{
+				switch (event.m_type)
+				{
+				case input_event_type::mouse_button:
+					if (event.m_a >= 0 && event.m_a < 32)
+					{
+						const auto bit = 1u << event.m_a;
+						m_buttons	   = event.m_b == GLFW_RELEASE ? (m_buttons & ~bit) : (m_buttons | bit);
+					}
+					break;
+
+				case input_event_type::cursor_pos:
+					m_cursor_x = event.m_x;
+					m_cursor_y = event.m_y;
+					break;
+
+				case input_event_type::cursor_enter:
+					m_hovered = event.m_a != 0;
+					break;
+
+				case input_event_type::focus:
+					m_focused = event.m_a != 0;
+					break;
+
+				case input_event_type::window_pos:
+					m_pos_x = event.m_a;
+					m_pos_y = event.m_b;
+					break;
+
+				default:
+					break;
+				}
+			}
+		};
+
+		// Window geometry kept current by the window's callbacks, so the per-frame code and the Platform hooks need not ask GLFW.
+		// Callbacks run inside pump(), never concurrently with the frame stages that read this.
+		struct window_metrics
+		{
+			std::array<int, 2> m_framebuffer_size{0, 0};
+			std::array<int, 2> m_window_size{0, 0};
+			std::array<int, 2> m_pos{0, 0};
+			bool			   m_dpi_changed{true}; // content scale changed since update_dpi last ran
+
+			auto init(GLFWwindow* window) noexcept -> void
+			{
+				glfwGetFramebufferSize(window, &m_framebuffer_size[0], &m_framebuffer_size[1]);
+				glfwGetWindowSize(window, &m_window_size[0], &m_window_size[1]);
+				glfwGetWindowPos(window, &m_pos[0], &m_pos[1]);
+				m_dpi_changed = true;
+			}
+		};
+
+		struct queued_input
+		{
+			GLFWwindow* m_window{nullptr};
+			input_event m_event;
+		};
+
 		struct gfx_application_state
 		{
-			gfx_application_state() : m_imgui_lib_context(ImGui::CreateContext(), ImGui::DestroyContext) { }
+			// The context is charged to its own heap from its creation on
+			gfx_application_state()
+				: m_font_atlas(std::make_shared<ImFontAtlas>())
+				, m_imgui_heap(acquire_imgui_heap())
+				, m_imgui_lib_context((set_current_imgui_heap(m_imgui_heap), ImGui::CreateContext(m_font_atlas.get())), ImGui::DestroyContext)
+			{
+			}
+
+			// The thread goes back to the heap it had before, unless that is the one released here
+			~gfx_application_state()
+			{
+				std::uint32_t previous_heap = 0;
+				{
+					scoped_imgui_heap heap(m_imgui_heap);
+					previous_heap = heap.m_previous;
+					m_imgui_lib_context.reset();
+				}
+				if (previous_heap == m_imgui_heap)
+				{
+					set_current_imgui_heap(0);
+				}
+				release_imgui_heap(m_imgui_heap);
+			}
+
+			gfx_application_state(const gfx_application_state&)			   = delete;
+			gfx_application_state& operator=(const gfx_application_state&) = delete;
+
+			// Draws with atlas from the next NewFrame on. The context does not own its atlas, which is why it can be swapped.
+			auto use_font_atlas(std::shared_ptr<ImFontAtlas> atlas) -> void
+			{
+				ImGui::GetIO().Fonts = atlas.get();
+				m_font_atlas		 = std::move(atlas);
+			}
 
+			std::shared_ptr<ImFontAtlas>					m_font_atlas; // a placeholder without fonts until use_font_atlas, outlives m_imgui_lib_context
+			const std::uint32_t								m_imgui_heap; // what the context allocates is counted in, see imgui_heap.h
 			std::shared_ptr<ImGuiContext>					m_imgui_lib_context;
-			std::array<GLFWcursor*, ImGuiMouseCursor_COUNT> m_mouse_cursors;
 			std::array<bool, ImGuiMouseButton_COUNT>		m_mouse_just_pressed;
 			bool											m_want_update_monitors{false};
+			std::uint32_t									m_monitor_generation{0};
 			time::moment									m_timer;
 			bool											m_timer_ready = false;
+			std::unique_ptr<input_recorder>					m_input_recorder;
+			std::unique_ptr<input_player>					m_input_player;
+
+			// Filled by the GLFW callbacks during pump, drained by new_frame_sync; callbacks never touch ImGui state.
+			spsc_queue<queued_input, 1024> m_input_queue;
+			std::atomic<std::uint32_t>	   m_input_dropped{0};
+
+			auto push_input(GLFWwindow* window, input_event event) noexcept -> void
+			{
+				event.m_time_ns = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+				if (!m_input_queue.push(queued_input{window, event})) [[unlikely]]
+				{
+					m_input_dropped.fetch_add(1, std::memory_order_relaxed);
+				}
+			}
+
+			// Applies queued input to the current context and, through state_of, to the cache of the viewport viewport_of finds it
+			// came from. Live input is dropped while a recording is replayed, and recorded while recording. True when events were
+			// lost to a full queue since the last call, see reseed_keys.
+			template<typename ViewportOf, typename StateOf>
+			[[nodiscard]] auto drain_input(ImGuiIO& io, ViewportOf&& viewport_of, StateOf&& state_of) noexcept -> bool
+			{
+				m_input_queue.drain(
+					[&](const queued_input& queued) noexcept
+					{
+						auto event = queued.m_event;
+						if (event.m_type == input_event_type::mouse_button || event.m_type >= input_event_type::cursor_pos)
+						{
+							// Looked up rather than stored, the viewport may have been destroyed since
+							if (viewport_input_state* state = state_of(viewport_of(queued.m_window)))
+							{
+								state->apply(event);
+							}
+
+							if (event.m_type != input_event_type::mouse_button)
+							{
+								return;
+							}
+						}
+
+						if (m_input_player)
+						{
+							return;
+						}
+
+						if (m_input_recorder)
+						{
+							// Scales are per viewport, replayed to the viewport of the same id
+							if (event.m_type == input_event_type::content_scale)
+							{
+								const ImGuiViewport* viewport = viewport_of(queued.m_window);
+								event.m_viewport			  = viewport != nullptr ? viewport->ID : 0;
+							}
+							m_input_recorder->record(event);
+						}
+
+						if (event.m_type == input_event_type::mouse_button)
+						{
+							if (event.m_b == GLFW_PRESS && event.m_a >= 0 && event.m_a < m_mouse_just_pressed.size())
+							{
+								m_mouse_just_pressed[event.m_a] = true;
+							}
+						}
+						else
+						{
+							apply_input_event(io, event);
+						}
+					});
+
+				if (const auto dropped = m_input_dropped.exchange(0, std::memory_order_relaxed); dropped > 0) [[unlikely]]
+				{
+					debug::logger()->stderr_logger()->warn("{0} input events dropped, the input queue was full", dropped);
+					return true;
+				}
+				return false;
+			}
+
+			// Sends the keys whose GLFW state differs from io's as if their events had arrived, so that a release lost to a full queue
+			// does not leave a key held. Goes through the recorder like live events, not while replaying.
+			auto reseed_keys(ImGuiIO& io, GLFWwindow* focused) noexcept -> void
+			{
+				if (m_input_player)
+				{
+					return;
+				}
+
+				for (int key = GLFW_KEY_SPACE; key <= GLFW_KEY_LAST && key < IM_ARRAYSIZE(io.KeysDown); key++)
+				{
+					const bool down = focused != nullptr && glfwGetKey(focused, key) == GLFW_PRESS;
+					if (down != io.KeysDown[key])
+					{
+						const input_event event{.m_type = input_event_type::key, .m_a = key, .m_b = down ? GLFW_PRESS : GLFW_RELEASE};
+						if (m_input_recorder)
+						{
+							m_input_recorder->record(event);
+						}
+						apply_input_event(io, event);
+					}
+				}
+			}
+
+			// The content scale a replayed recording gives viewport, 0 when it gave none so far.
+			[[nodiscard]] auto replayed_content_scale(ImGuiID viewport) const noexcept -> float
+			{
+				if (!m_input_player)
+				{
+					return 0.0f;
+				}
+				const auto itor = m_input_player->m_content_scales.find(viewport);
+				return itor != m_input_player->m_content_scales.end() ? itor->second : 0.0f;
+			}
 
 			[[nodiscard]] auto make_current() noexcept -> leaf::result<void>
 			try
 			{
 				ImGui::SetCurrentContext(m_imgui_lib_context.get());
+				set_current_imgui_heap(m_imgui_heap);
 				return {};
 			}
 			catch (...)
@@ -80,46 +449,119 @@ namespace mu
 			}
 		};
 
+		// Draws one viewport of a snapshot into window, with the immediate context, see submit_frame. With a canvas only the
+		// viewport's damage is redrawn, unless the canvas lost its contents.
+		[[nodiscard]] auto record_viewport(
+			render_context*					ctx,
+			diligent_window&				window,
+			Diligent::imgui_renderer&		renderer,
+			Diligent::imgui_font_resources& fonts,
+			draw_data_snapshot::viewport&	vp) noexcept -> mu::leaf::result<void>
+		{
+			MU_LEAF_CHECK(window.create_resources(vp.m_size[0], vp.m_size[1]));
+
+			ImDrawData* draw_data = &vp.m_draw_data;
+			const bool	minimized = vp.m_size[0] <= 0 || vp.m_size[1] <= 0 || draw_data->DisplaySize.x <= 0.0f || draw_data->DisplaySize.y <= 0.0f;
+			const bool	partial	  = window.m_canvas && !window.m_canvas_lost && !minimized;
+
+			// The colour clear is wasted when the first draw paints every pixel anyway
+			const bool covered = window.m_globals->m_render_options.m_elide_clear && Diligent::covers_viewport(draw_data, (ImTextureID)fonts.m_font_srv, fonts.m_white_uv);
+
+			if (!partial || !damage_tracker::empty(vp.m_damage))
+			{
+				Diligent::imgui_damage damage;
+				if (partial)
+				{
+					damage.m_rect = vp.m_damage;
+					if (!covered)
+					{
+						const auto& color	   = diligent_window::s_clear_color;
+						damage.m_white_texture = fonts.m_font_srv;
+						damage.m_white_uv	   = fonts.m_white_uv;
+						damage.m_background	   = ImGui::ColorConvertFloat4ToU32(ImVec4(color[0], color[1], color[2], color[3]));
+					}
+				}
+
+				renderer.m_font_texture = fonts.m_sdf || fonts.m_alpha8 ? fonts.m_font_srv.RawPtr() : nullptr;
+
+				MU_LEAF_CHECK(window.clear(ctx, !partial && !covered));
+				MU_LEAF_CHECK(renderer.render_draw_data(
+					Diligent::SURFACE_TRANSFORM::SURFACE_TRANSFORM_OPTIMAL,
+					vp.m_size[0],
+					vp.m_size[1],
+					ctx,
+					draw_data,
+					partial ? &damage : nullptr));
+			}
+
+			// A frame that was not drawn leaves its changes out of the canvas
+			window.m_canvas_lost = minimized;
+			return window.resolve(ctx);
+		}
+
+		// Adds what a viewport's swap chain, canvas and renderer hold to stats, either may not be created yet.
+		auto viewport_memory_stats(const diligent_window* window, const Diligent::imgui_renderer* renderer, gfx_memory_stats& stats) noexcept -> void
+		{
+			if (window != nullptr && window->m_swap_chain)
+			{
+				window->memory_stats(stats);
+			}
+			if (renderer != nullptr)
+			{
+				stats.m_geometry_buffers += renderer->buffer_bytes();
+			}
+		}
+
 		struct gfx_child_window
 		{
 			std::shared_ptr<gfx_application_state>	  m_application_state;
 			std::shared_ptr<GLFWwindow>				  m_window;
 			std::shared_ptr<diligent_window>		  m_diligent_window;
 			std::shared_ptr<Diligent::imgui_renderer> m_imgui_renderer;
+			const ImGuiID							  m_viewport_id;
 
-			std::array<int, 2> m_display_size{0, 0};
-			float			   m_dpi_scale{1.0f};
-			bool			   m_ready{false};
+			std::array<int, 2>	 m_display_size{0, 0};
+			float				 m_dpi_scale{1.0f};
+			viewport_input_state m_input_state;
+			window_metrics		 m_metrics;
+			damage_tracker		 m_damage_tracker; // frame thread
 
+			// Reads the cached metrics; the DPI scale is only queried again after a content scale change. A replayed recording brings
+			// its own scale, as it does its display size.
 			[[nodiscard]] auto update_dpi() noexcept -> mu::leaf::result<void>
 			{
-#ifdef _WINDOWS_
-				try
+				if (const float scale = m_application_state->replayed_content_scale(m_viewport_id); scale > 0.0f)
 				{
-					auto native_handle = glfwGetWin32Window(m_window.get());
-					m_dpi_scale		   = get_dpi_scale_for_hwnd(native_handle);
+					// Queried again once the replay is over
+					m_dpi_scale				= scale;
+					m_metrics.m_dpi_changed = true;
 				}
-				catch (...)
+				else if (m_metrics.m_dpi_changed)
 				{
-					return MU_LEAF_NEW_ERROR(mu::gfx_error::not_specified{});
-				}
+#ifdef _WINDOWS_
+					try
+					{
+						auto native_handle = glfwGetWin32Window(m_window.get());
+						m_dpi_scale		   = get_dpi_scale_for_hwnd(native_handle);
+					}
+					catch (...)
+					{
+						return MU_LEAF_NEW_ERROR(mu::gfx_error::not_specified{});
+					}
 
 #else  // #ifdef _WINDOWS_
-				m_dpi_scale = 1.0f; // TODO
+					m_dpi_scale = 1.0f; // TODO
 #endif // #else // #ifdef _WINDOWS_
-				try
-				{
-					glfwGetFramebufferSize(m_window.get(), &m_display_size[0], &m_display_size[1]);
-				}
-				catch (...)
-				{
-					return MU_LEAF_NEW_ERROR(mu::gfx_error::not_specified{});
+					m_metrics.m_dpi_changed = false;
 				}
+
+				m_display_size = m_metrics.m_framebuffer_size;
 				return {};
 			}
 
 			gfx_child_window(std::shared_ptr<gfx_application_state> application_state, ImGuiViewport* viewport, int posX, int posY, int sizeX, int sizeY)
 				: m_application_state(application_state)
+				, m_viewport_id(viewport->ID)
 			{
 				MU_LEAF_AUTO_THROW(new_window, create_window(viewport, posX, posY, sizeX, sizeY));
 
@@ -141,11 +583,7 @@ namespace mu
 					[](GLFWwindow* window, int button, int action, int mods) -> void
 					{
 						auto self = reinterpret_cast<gfx_child_window*>(glfwGetWindowUserPointer(window));
-						MU_LEAF_RETHROW(self->m_application_state->make_current());
-						if (action == GLFW_PRESS && button >= 0 && button < self->m_application_state->m_mouse_just_pressed.size())
-						{
-							self->m_application_state->m_mouse_just_pressed[button] = true;
-						}
+						self->m_application_state->push_input(window, {.m_type = input_event_type::mouse_button, .m_a = button, .m_b = action});
 					});
 
 				glfwSetScrollCallback(
@@ -153,10 +591,7 @@ namespace mu
 					[](GLFWwindow* window, double xoffset, double yoffset) -> void
 					{
 						auto self = reinterpret_cast<gfx_child_window*>(glfwGetWindowUserPointer(window));
-						MU_LEAF_RETHROW(self->m_application_state->make_current());
-						ImGuiIO& io = ImGui::GetIO();
-						io.MouseWheelH += (float)xoffset;
-						io.MouseWheel += (float)yoffset;
+						self->m_application_state->push_input(window, {.m_type = input_event_type::scroll, .m_x = (float)xoffset, .m_y = (float)yoffset});
 					});
 
 				glfwSetKeyCallback(
@@ -164,27 +599,7 @@ namespace mu
 					[](GLFWwindow* window, int key, int scancode, int action, int mods) -> void
 					{
 						auto self = reinterpret_cast<gfx_child_window*>(glfwGetWindowUserPointer(window));
-						MU_LEAF_RETHROW(self->m_application_state->make_current());
-						ImGuiIO& io = ImGui::GetIO();
-						if (action == GLFW_PRESS)
-						{
-							io.KeysDown[key] = true;
-						}
-
-						if (action == GLFW_RELEASE)
-						{
-							io.KeysDown[key] = false;
-						}
-
-						// Modifiers are not reliable across systems
-						io.KeyCtrl	= io.KeysDown[GLFW_KEY_LEFT_CONTROL] || io.KeysDown[GLFW_KEY_RIGHT_CONTROL];
-						io.KeyShift = io.KeysDown[GLFW_KEY_LEFT_SHIFT] || io.KeysDown[GLFW_KEY_RIGHT_SHIFT];
-						io.KeyAlt	= io.KeysDown[GLFW_KEY_LEFT_ALT] || io.KeysDown[GLFW_KEY_RIGHT_ALT];
-#ifdef _WIN32
-						io.KeySuper = false;
-#else
-						io.KeySuper = io.KeysDown[GLFW_KEY_LEFT_SUPER] || io.KeysDown[GLFW_KEY_RIGHT_SUPER];
-#endif
+						self->m_application_state->push_input(window, {.m_type = input_event_type::key, .m_a = key, .m_b = action});
 					});
 
 				glfwSetCharCallback(
@@ -192,19 +607,70 @@ namespace mu
 					[](GLFWwindow* window, unsigned int c) -> void
 					{
 						auto self = reinterpret_cast<gfx_child_window*>(glfwGetWindowUserPointer(window));
-						MU_LEAF_RETHROW(self->m_application_state->make_current());
-						ImGuiIO& io = ImGui::GetIO();
-						io.AddInputCharacter(c);
+						self->m_application_state->push_input(window, {.m_type = input_event_type::character, .m_a = static_cast<std::int32_t>(c)});
 					});
 
 				glfwSetWindowContentScaleCallback(
 					wnd.get(),
-					[](GLFWwindow* window, float, float) -> void
+					[](GLFWwindow* window, float xscale, float yscale) -> void
+					{
+						auto self = reinterpret_cast<gfx_child_window*>(glfwGetWindowUserPointer(window));
+						self->m_metrics.m_dpi_changed = true;
+						self->m_application_state->push_input(window, {.m_type = input_event_type::content_scale, .m_x = xscale, .m_y = yscale});
+					});
+
+				glfwSetCursorPosCallback(
+					wnd.get(),
+					[](GLFWwindow* window, double x, double y) -> void
+					{
+						auto self = reinterpret_cast<gfx_child_window*>(glfwGetWindowUserPointer(window));
+						self->m_application_state->push_input(window, {.m_type = input_event_type::cursor_pos, .m_x = (float)x, .m_y = (float)y});
+					});
+
+				glfwSetCursorEnterCallback(
+					wnd.get(),
+					[](GLFWwindow* window, int entered) -> void
+					{
+						auto self = reinterpret_cast<gfx_child_window*>(glfwGetWindowUserPointer(window));
+						self->m_application_state->push_input(window, {.m_type = input_event_type::cursor_enter, .m_a = entered});
+					});
+
+				glfwSetWindowFocusCallback(
+					wnd.get(),
+					[](GLFWwindow* window, int focused) -> void
+					{
+						auto self = reinterpret_cast<gfx_child_window*>(glfwGetWindowUserPointer(window));
+						self->m_application_state->push_input(window, {.m_type = input_event_type::focus, .m_a = focused});
+					});
+
+				glfwSetWindowPosCallback(
+					wnd.get(),
+					[](GLFWwindow* window, int x, int y) -> void
 					{
 						auto self = reinterpret_cast<gfx_child_window*>(glfwGetWindowUserPointer(window));
-						MU_LEAF_RETHROW(self->m_application_state->make_current());
+						self->m_metrics.m_pos = {x, y};
+						self->m_application_state->push_input(window, {.m_type = input_event_type::window_pos, .m_a = x, .m_b = y});
+					});
+
+				glfwSetFramebufferSizeCallback(
+					wnd.get(),
+					[](GLFWwindow* window, int width, int height) -> void
+					{
+						auto self						  = reinterpret_cast<gfx_child_window*>(glfwGetWindowUserPointer(window));
+						self->m_metrics.m_framebuffer_size = {width, height};
+					});
+
+				glfwSetWindowSizeCallback(
+					wnd.get(),
+					[](GLFWwindow* window, int width, int height) -> void
+					{
+						auto self					 = reinterpret_cast<gfx_child_window*>(glfwGetWindowUserPointer(window));
+						self->m_metrics.m_window_size = {width, height};
 					});
 
+				m_input_state.init(wnd.get());
+				m_metrics.init(wnd.get());
+
 				m_window = std::move(wnd);
 
 				MU_LEAF_RETHROW(update_dpi());
@@ -273,14 +739,17 @@ namespace mu
 				return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
 			}
 
-			[[nodiscard]] auto init_resources(std::shared_ptr<diligent_globals> globals, std::shared_ptr<Diligent::imgui_shared_resources> shared_resources) noexcept
-				-> mu::leaf::result<void>
+			[[nodiscard]] auto init_resources(
+				std::shared_ptr<diligent_globals>					globals,
+				std::shared_ptr<Diligent::imgui_shared_resources> shared_resources,
+				const gfx_resize_policy&							resize_policy) noexcept -> mu::leaf::result<void>
 			{
 				if (!m_diligent_window) [[unlikely]]
 				{
 					try
 					{
-						m_diligent_window = std::make_shared<diligent_window>(Diligent::Win32NativeWindow{glfwGetWin32Window(m_window.get())}, globals);
+						m_diligent_window				   = std::make_shared<diligent_window>(Diligent::Win32NativeWindow{glfwGetWin32Window(m_window.get())}, globals);
+						m_diligent_window->m_resize_policy = resize_policy;
 
 						const auto& swapchain_desc = m_diligent_window->m_swap_chain->GetDesc();
 						m_imgui_renderer		   = std::make_shared<Diligent::imgui_renderer>(shared_resources, 1024 * 1024, 1024 * 1024, m_dpi_scale);
@@ -294,45 +763,27 @@ namespace mu
 				return {};
 			}
 
-			[[nodiscard]] auto begin_frame(std::shared_ptr<diligent_globals> globals, std::shared_ptr<Diligent::imgui_shared_resources> shared_resources) noexcept
+			// Runs with the immediate context, see submit_frame: the size comes from the snapshot, no GLFW calls.
+			[[nodiscard]] auto render_snapshot(render_context* ctx, draw_data_snapshot::viewport& vp, Diligent::imgui_font_resources& fonts) noexcept
 				-> mu::leaf::result<void>
 			{
-				MU_LEAF_CHECK(update_dpi());
-
-				MU_LEAF_CHECK(init_resources(globals, shared_resources));
-
-				if (m_diligent_window) [[likely]]
-				{
-					m_ready = true;
-					MU_LEAF_CHECK(m_diligent_window->create_resources(m_display_size[0], m_display_size[1]));
-					return {};
-				}
-				else
-				{
-					return MU_LEAF_NEW_ERROR(mu::gfx_error::not_specified{});
-				}
-			}
-
-			[[nodiscard]] auto render(Diligent::IDeviceContext* ctx, ImDrawData* draw_data) noexcept -> mu::leaf::result<void>
-			{
-				if (m_ready)
+				MU_GFX_TRACE_SCOPE("render_child");
+				if (m_diligent_window)
 				{
-					MU_LEAF_CHECK(update_dpi());
-					MU_LEAF_CHECK(m_diligent_window->clear());
-					MU_LEAF_CHECK(m_imgui_renderer->render_draw_data(Diligent::SURFACE_TRANSFORM::SURFACE_TRANSFORM_OPTIMAL, m_display_size[0], m_display_size[1], ctx, draw_data));
+					MU_LEAF_CHECK(record_viewport(ctx, *m_diligent_window, *m_imgui_renderer, fonts, vp));
 				}
 				return {};
 			}
 
-			[[nodiscard]] auto present() noexcept -> mu::leaf::result<void>
+			[[nodiscard]] auto present_snapshot(render_context* ctx) noexcept -> mu::leaf::result<void>
 			{
-				if (m_ready)
+				if (m_diligent_window)
 				{
-					MU_LEAF_CHECK(m_diligent_window->present());
-					m_ready = false;
+					MU_LEAF_CHECK(m_diligent_window->present(ctx));
 				}
 				return {};
 			}
+
 		};
 
 		struct gfx_window_impl : public gfx_window
@@ -341,38 +792,71 @@ namespace mu
 			std::shared_ptr<GLFWwindow>						  m_window;
 			std::shared_ptr<diligent_window>				  m_diligent_window;
 			std::shared_ptr<diligent_globals>				  m_renderer_globals;
+			std::shared_ptr<render_context>					  m_render_context;
+			std::shared_ptr<command_log_recorder>			  m_command_recorder;
+			std::unique_ptr<draw_capture_writer>			  m_draw_capture;
+			gfx_frame_pipeline								  m_frame_pipeline{gfx_frame_pipeline::immediate};
+			gfx_resize_policy								  m_resize_policy;
+			gfx_memory_budget								  m_memory_budget;
+			std::atomic<bool>								  m_compact_imgui{false}; // set by a job over the CPU budget, see begin_imgui_sync
+			submission_queue::stream						  m_submissions;
+			draw_data_snapshot								  m_snapshot;
+			std::shared_ptr<Diligent::imgui_font_resources>	  m_snapshot_fonts;		  // what m_snapshot is drawn with
+			glyph_cache::frame_ticket						  m_snapshot_glyph_frame; // given back once m_snapshot is recorded
+			glyph_cache::frame_ticket						  m_glyph_frame;		  // frame thread, from begin_imgui_sync to submit_snapshot
 			std::shared_ptr<Diligent::imgui_renderer>		  m_imgui_renderer;
 			std::shared_ptr<Diligent::imgui_shared_resources> m_imgui_shared_resources;
+			std::shared_ptr<Diligent::imgui_font_resources>	  m_imgui_font_resources;
+			Diligent::imgui_backend_data					  m_imgui_backend_data; // of the two above, for gfx_add_*
 			std::shared_ptr<gfx_application_state>			  m_application_state;
 
-			std::array<int, 2> m_display_size{0, 0};
-			float			   m_dpi_scale{1.0f};
+			std::array<int, 2>	 m_display_size{0, 0};
+			float				 m_dpi_scale{1.0f};
+			viewport_input_state m_input_state;
+			window_metrics		 m_metrics;
+			damage_tracker		 m_damage_tracker; // frame thread
+
+			// Frame thread, with the context current: draws with the atlas built for scale from the next NewFrame on. The frames
+			// already queued keep theirs through m_snapshot_fonts.
+			[[nodiscard]] auto use_fonts(float scale) noexcept -> mu::leaf::result<void>
+			{
+				MU_LEAF_AUTO(fonts, m_glfw_system->imgui_font_resources(m_renderer_globals, scale));
+				m_application_state->use_font_atlas(fonts->m_atlas);
+				m_imgui_font_resources				  = std::move(fonts);
+				m_imgui_backend_data.m_font_resources = m_imgui_font_resources.get();
+				return {};
+			}
 
+			// Reads the cached metrics; the DPI scale is only queried again after a content scale change. A replayed recording brings
+			// its own scale, as it does its display size.
 			[[nodiscard]] auto update_dpi() noexcept -> mu::leaf::result<void>
 			{
-#ifdef _WINDOWS_
-				try
+				if (const float scale = m_application_state->replayed_content_scale(IMGUI_VIEWPORT_DEFAULT_ID); scale > 0.0f)
 				{
-					auto native_handle = glfwGetWin32Window(m_window.get());
-					m_dpi_scale		   = get_dpi_scale_for_hwnd(native_handle);
+					// Queried again once the replay is over
+					m_dpi_scale				= scale;
+					m_metrics.m_dpi_changed = true;
 				}
-				catch (...)
+				else if (m_metrics.m_dpi_changed)
 				{
-					return MU_LEAF_NEW_ERROR(mu::gfx_error::not_specified{});
-				}
+#ifdef _WINDOWS_
+					try
+					{
+						auto native_handle = glfwGetWin32Window(m_window.get());
+						m_dpi_scale		   = get_dpi_scale_for_hwnd(native_handle);
+					}
+					catch (...)
+					{
+						return MU_LEAF_NEW_ERROR(mu::gfx_error::not_specified{});
+					}
 
 #else  // #ifdef _WINDOWS_
-				m_dpi_scale = 1.0f; // TODO
+					m_dpi_scale = 1.0f; // TODO
 #endif // #else // #ifdef _WINDOWS_
-				try
-				{
-					glfwGetFramebufferSize(m_window.get(), &m_display_size[0], &m_display_size[1]);
-				}
-				catch (...)
-				{
-					return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+					m_metrics.m_dpi_changed = false;
 				}
 
+				m_display_size = m_metrics.m_framebuffer_size;
 				return {};
 			}
 
@@ -398,12 +882,19 @@ namespace mu
 				glfwSetWindowUserPointer(new_window, this);
 
 				m_window = std::move(wnd);
+				m_metrics.init(m_window.get());
 
 				MU_LEAF_RETHROW(update_dpi());
 			}
 
 			virtual ~gfx_window_impl()
 			{
+				// Queued jobs may still be presenting to windows destroyed below
+				if (!wait_submissions()) [[unlikely]]
+				{
+					MU_LEAF_LOG_ERROR(mu::gfx_error::not_specified{});
+				}
+
 				if (auto res = m_application_state->make_current()) [[likely]]
 				{
 					ImGuiPlatformIO& platform_io = ImGui::GetPlatformIO();
@@ -436,6 +927,19 @@ namespace mu
 					MU_LEAF_LOG_ERROR(mu::gfx_error::not_specified{});
 				}
 
+				try
+				{
+					m_snapshot_glyph_frame.reset();
+					m_glyph_frame.reset();
+					m_snapshot_fonts.reset();
+					m_imgui_font_resources.reset();
+					m_imgui_shared_resources.reset();
+				}
+				catch (...)
+				{
+					MU_LEAF_LOG_ERROR(mu::gfx_error::not_specified{});
+				}
+
 				try
 				{
 					m_diligent_window.reset();
@@ -445,6 +949,16 @@ namespace mu
 					MU_LEAF_LOG_ERROR(mu::gfx_error::not_specified{});
 				}
 
+				try
+				{
+					m_command_recorder.reset();
+					m_render_context.reset();
+				}
+				catch (...)
+				{
+					MU_LEAF_LOG_ERROR(mu::gfx_error::not_specified{});
+				}
+
 				try
 				{
 					m_renderer_globals.reset();
@@ -527,11 +1041,7 @@ namespace mu
 						[](GLFWwindow* window, int button, int action, int mods) -> void
 						{
 							auto self = reinterpret_cast<gfx_window_impl*>(glfwGetWindowUserPointer(window));
-							MU_LEAF_RETHROW(self->m_application_state->make_current());
-							if (action == GLFW_PRESS && button >= 0 && button < self->m_application_state->m_mouse_just_pressed.size())
-							{
-								self->m_application_state->m_mouse_just_pressed[button] = true;
-							}
+							self->m_application_state->push_input(window, {.m_type = input_event_type::mouse_button, .m_a = button, .m_b = action});
 						});
 
 					glfwSetScrollCallback(
@@ -539,10 +1049,7 @@ namespace mu
 						[](GLFWwindow* window, double xoffset, double yoffset) -> void
 						{
 							auto self = reinterpret_cast<gfx_window_impl*>(glfwGetWindowUserPointer(window));
-							MU_LEAF_RETHROW(self->m_application_state->make_current())
-							ImGuiIO& io = ImGui::GetIO();
-							io.MouseWheelH += (float)xoffset;
-							io.MouseWheel += (float)yoffset;
+							self->m_application_state->push_input(window, {.m_type = input_event_type::scroll, .m_x = (float)xoffset, .m_y = (float)yoffset});
 						});
 
 					glfwSetKeyCallback(
@@ -550,27 +1057,7 @@ namespace mu
 						[](GLFWwindow* window, int key, int scancode, int action, int mods) -> void
 						{
 							auto self = reinterpret_cast<gfx_window_impl*>(glfwGetWindowUserPointer(window));
-							MU_LEAF_RETHROW(self->m_application_state->make_current())
-							ImGuiIO& io = ImGui::GetIO();
-							if (action == GLFW_PRESS)
-							{
-								io.KeysDown[key] = true;
-							}
-
-							if (action == GLFW_RELEASE)
-							{
-								io.KeysDown[key] = false;
-							}
-
-							// Modifiers are not reliable across systems
-							io.KeyCtrl	= io.KeysDown[GLFW_KEY_LEFT_CONTROL] || io.KeysDown[GLFW_KEY_RIGHT_CONTROL];
-							io.KeyShift = io.KeysDown[GLFW_KEY_LEFT_SHIFT] || io.KeysDown[GLFW_KEY_RIGHT_SHIFT];
-							io.KeyAlt	= io.KeysDown[GLFW_KEY_LEFT_ALT] || io.KeysDown[GLFW_KEY_RIGHT_ALT];
-#ifdef _WIN32
-							io.KeySuper = false;
-#else
-							io.KeySuper = io.KeysDown[GLFW_KEY_LEFT_SUPER] || io.KeysDown[GLFW_KEY_RIGHT_SUPER];
-#endif
+							self->m_application_state->push_input(window, {.m_type = input_event_type::key, .m_a = key, .m_b = action});
 						});
 
 					glfwSetCharCallback(
@@ -578,18 +1065,70 @@ namespace mu
 						[](GLFWwindow* window, unsigned int c) -> void
 						{
 							auto self = reinterpret_cast<gfx_window_impl*>(glfwGetWindowUserPointer(window));
-							MU_LEAF_RETHROW(self->m_application_state->make_current())
-							ImGuiIO& io = ImGui::GetIO();
-							io.AddInputCharacter(c);
+							self->m_application_state->push_input(window, {.m_type = input_event_type::character, .m_a = static_cast<std::int32_t>(c)});
 						});
 
 					glfwSetWindowContentScaleCallback(
 						m_window.get(),
-						[](GLFWwindow* window, float, float) -> void
+						[](GLFWwindow* window, float xscale, float yscale) -> void
+						{
+							auto self = reinterpret_cast<gfx_window_impl*>(glfwGetWindowUserPointer(window));
+							self->m_metrics.m_dpi_changed = true;
+							self->m_application_state->push_input(window, {.m_type = input_event_type::content_scale, .m_x = xscale, .m_y = yscale});
+						});
+
+					glfwSetCursorPosCallback(
+						m_window.get(),
+						[](GLFWwindow* window, double x, double y) -> void
+						{
+							auto self = reinterpret_cast<gfx_window_impl*>(glfwGetWindowUserPointer(window));
+							self->m_application_state->push_input(window, {.m_type = input_event_type::cursor_pos, .m_x = (float)x, .m_y = (float)y});
+						});
+
+					glfwSetCursorEnterCallback(
+						m_window.get(),
+						[](GLFWwindow* window, int entered) -> void
 						{
 							auto self = reinterpret_cast<gfx_window_impl*>(glfwGetWindowUserPointer(window));
-							MU_LEAF_RETHROW(self->m_application_state->make_current());
+							self->m_application_state->push_input(window, {.m_type = input_event_type::cursor_enter, .m_a = entered});
 						});
+
+					glfwSetWindowFocusCallback(
+						m_window.get(),
+						[](GLFWwindow* window, int focused) -> void
+						{
+							auto self = reinterpret_cast<gfx_window_impl*>(glfwGetWindowUserPointer(window));
+							self->m_application_state->push_input(window, {.m_type = input_event_type::focus, .m_a = focused});
+						});
+
+					glfwSetWindowPosCallback(
+						m_window.get(),
+						[](GLFWwindow* window, int x, int y) -> void
+						{
+							auto self = reinterpret_cast<gfx_window_impl*>(glfwGetWindowUserPointer(window));
+							self->m_metrics.m_pos = {x, y};
+							self->m_application_state->push_input(window, {.m_type = input_event_type::window_pos, .m_a = x, .m_b = y});
+						});
+
+					glfwSetFramebufferSizeCallback(
+						m_window.get(),
+						[](GLFWwindow* window, int width, int height) -> void
+						{
+							auto self						  = reinterpret_cast<gfx_window_impl*>(glfwGetWindowUserPointer(window));
+							self->m_metrics.m_framebuffer_size = {width, height};
+						});
+
+					glfwSetWindowSizeCallback(
+						m_window.get(),
+						[](GLFWwindow* window, int width, int height) -> void
+						{
+							auto self					 = reinterpret_cast<gfx_window_impl*>(glfwGetWindowUserPointer(window));
+							self->m_metrics.m_window_size = {width, height};
+						});
+
+					m_input_state.init(m_window.get());
+					// Seeded again, anything polled before the callbacks existed was missed
+					m_metrics.init(m_window.get());
 				}
 				catch (...)
 				{
@@ -650,22 +1189,6 @@ namespace mu
 						return glfwGetClipboardString(self->m_window.get());
 					};
 
-					// Create mouse cursors
-					// (By design, on X11 cursors are user configurable and some cursors may be missing. When a cursor doesn't exist,
-					// GLFW will emit an error which will often be printed by the app, so we temporarily disable error reporting.
-					// Missing cursors will return NULL and our _UpdateMouseCursor() function will use the Arrow cursor instead.)
-					GLFWerrorfun prev_error_callback								  = glfwSetErrorCallback(nullptr);
-					m_application_state->m_mouse_cursors[ImGuiMouseCursor_Arrow]	  = glfwCreateStandardCursor(GLFW_ARROW_CURSOR);
-					m_application_state->m_mouse_cursors[ImGuiMouseCursor_TextInput]  = glfwCreateStandardCursor(GLFW_IBEAM_CURSOR);
-					m_application_state->m_mouse_cursors[ImGuiMouseCursor_ResizeNS]	  = glfwCreateStandardCursor(GLFW_VRESIZE_CURSOR);
-					m_application_state->m_mouse_cursors[ImGuiMouseCursor_ResizeEW]	  = glfwCreateStandardCursor(GLFW_HRESIZE_CURSOR);
-					m_application_state->m_mouse_cursors[ImGuiMouseCursor_Hand]		  = glfwCreateStandardCursor(GLFW_HAND_CURSOR);
-					m_application_state->m_mouse_cursors[ImGuiMouseCursor_ResizeAll]  = glfwCreateStandardCursor(GLFW_RESIZE_ALL_CURSOR);
-					m_application_state->m_mouse_cursors[ImGuiMouseCursor_ResizeNESW] = glfwCreateStandardCursor(GLFW_RESIZE_NESW_CURSOR);
-					m_application_state->m_mouse_cursors[ImGuiMouseCursor_ResizeNWSE] = glfwCreateStandardCursor(GLFW_RESIZE_NWSE_CURSOR);
-					m_application_state->m_mouse_cursors[ImGuiMouseCursor_NotAllowed] = glfwCreateStandardCursor(GLFW_NOT_ALLOWED_CURSOR);
-					glfwSetErrorCallback(prev_error_callback);
-
 					MU_LEAF_CHECK(init_glfw_resources());
 
 					ImGuiViewport* main_viewport	= ImGui::GetMainViewport();
@@ -720,32 +1243,41 @@ namespace mu
 						//#endif
 					};
 
+					// ImGui re-requests the same position and size every frame, only actual changes are forwarded to GLFW
 					platform_io.Platform_SetWindowPos = [](ImGuiViewport* viewport, ImVec2 pos) -> void
 					{
-						GLFWwindow* wnd = static_cast<GLFWwindow*>(viewport->PlatformHandle);
-						glfwSetWindowPos(wnd, (int)pos.x, (int)pos.y);
+						window_metrics&			 metrics = metrics_of(viewport);
+						const std::array<int, 2> target{(int)pos.x, (int)pos.y};
+						if (metrics.m_pos != target)
+						{
+							GLFWwindow* wnd = static_cast<GLFWwindow*>(viewport->PlatformHandle);
+							glfwSetWindowPos(wnd, target[0], target[1]);
+							metrics.m_pos = target;
+						}
 					};
 
 					platform_io.Platform_GetWindowPos = [](ImGuiViewport* viewport) -> ImVec2
 					{
-						int			x = 0, y = 0;
-						GLFWwindow* wnd = static_cast<GLFWwindow*>(viewport->PlatformHandle);
-						glfwGetWindowPos(wnd, &x, &y);
-						return ImVec2((float)x, (float)y);
+						const window_metrics& metrics = metrics_of(viewport);
+						return ImVec2((float)metrics.m_pos[0], (float)metrics.m_pos[1]);
 					};
 
 					platform_io.Platform_SetWindowSize = [](ImGuiViewport* viewport, ImVec2 size) -> void
 					{
-						GLFWwindow* wnd = static_cast<GLFWwindow*>(viewport->PlatformHandle);
-						glfwSetWindowSize(wnd, (int)size.x, (int)size.y);
+						window_metrics&			 metrics = metrics_of(viewport);
+						const std::array<int, 2> target{(int)size.x, (int)size.y};
+						if (metrics.m_window_size != target)
+						{
+							GLFWwindow* wnd = static_cast<GLFWwindow*>(viewport->PlatformHandle);
+							glfwSetWindowSize(wnd, target[0], target[1]);
+							metrics.m_window_size = target;
+						}
 					};
 
 					platform_io.Platform_GetWindowSize = [](ImGuiViewport* viewport) -> ImVec2
 					{
-						int			x = 0, y = 0;
-						GLFWwindow* wnd = static_cast<GLFWwindow*>(viewport->PlatformHandle);
-						glfwGetWindowSize(wnd, &x, &y);
-						return ImVec2((float)x, (float)y);
+						const window_metrics& metrics = metrics_of(viewport);
+						return ImVec2((float)metrics.m_window_size[0], (float)metrics.m_window_size[1]);
 					};
 
 					platform_io.Platform_SetWindowFocus = [](ImGuiViewport* viewport) -> void
@@ -806,9 +1338,11 @@ namespace mu
 			{
 				if (!m_renderer_globals) [[unlikely]]
 				{
+					MU_LEAF_AUTO(globals, m_glfw_system->renderer_globals());
 					try
 					{
-						m_renderer_globals = std::make_shared<diligent_globals>();
+						m_renderer_globals = std::move(globals);
+						m_render_context   = std::make_shared<diligent_render_context>(m_renderer_globals->m_immediate_context);
 					}
 					catch (...)
 					{
@@ -822,22 +1356,22 @@ namespace mu
 					{
 						MU_LEAF_CHECK(m_application_state->make_current());
 
-						m_diligent_window = std::make_shared<diligent_window>(Diligent::Win32NativeWindow{glfwGetWin32Window(m_window.get())}, m_renderer_globals);
+						m_diligent_window				   = std::make_shared<diligent_window>(Diligent::Win32NativeWindow{glfwGetWin32Window(m_window.get())}, m_renderer_globals);
+						m_diligent_window->m_resize_policy = m_resize_policy;
 
-						const auto& swapchain_desc = m_diligent_window->m_swap_chain->GetDesc();
-						m_imgui_shared_resources   = std::make_shared<Diligent::imgui_shared_resources>(
-							  m_diligent_window->m_globals->m_device,
-							  swapchain_desc.ColorBufferFormat,
-							  swapchain_desc.DepthBufferFormat,
-							  m_dpi_scale);
+						MU_LEAF_AUTO(shared_resources, m_glfw_system->imgui_shared_resources(m_renderer_globals, m_diligent_window->m_swap_chain->GetDesc()));
+						m_imgui_shared_resources = std::move(shared_resources);
+						MU_LEAF_CHECK(use_fonts(m_dpi_scale));
 
 						m_imgui_renderer = std::make_shared<Diligent::imgui_renderer>(m_imgui_shared_resources, 1024 * 1024, 1024 * 1024, m_dpi_scale);
 
+						m_imgui_backend_data = Diligent::imgui_backend_data{m_imgui_shared_resources.get(), m_imgui_font_resources.get()};
+
 						IMGUI_CHECKVERSION();
-						ImGuiIO& io			   = ImGui::GetIO();
-						io.BackendRendererName = "imgui_renderer";
+						ImGuiIO& io				   = ImGui::GetIO();
+						io.BackendRendererName	   = "imgui_renderer";
+						io.BackendRendererUserData = &m_imgui_backend_data; // tells gfx_add_* about the primitive pipeline and the glyph cache
 						io.BackendFlags |= ImGuiBackendFlags_RendererHasVtxOffset; // We can honor the ImDrawCmd::VtxOffset field, allowing for large meshes.
-						MU_LEAF_RETHROW(m_imgui_shared_resources->create_device_objects(m_dpi_scale, true));
 						ImGui::GetStyle().ScaleAllSizes(m_dpi_scale);
 					}
 					catch (...)
@@ -851,19 +1385,64 @@ namespace mu
 				return {};
 			}
 
-			[[nodiscard]] auto render(ImDrawData* draw_data) noexcept -> mu::leaf::result<void>
+			// Only valid for viewports with a platform window, which is all the Platform hooks are called for.
+			[[nodiscard]] static auto metrics_of(ImGuiViewport* viewport) noexcept -> window_metrics&
 			{
-				MU_LEAF_CHECK(update_dpi());
-				MU_LEAF_CHECK(m_diligent_window->clear());
-				MU_LEAF_CHECK(m_imgui_renderer->render_draw_data(
-					Diligent::SURFACE_TRANSFORM::SURFACE_TRANSFORM_OPTIMAL,
-					m_display_size[0],
-					m_display_size[1],
-					m_renderer_globals->m_immediate_context,
-					draw_data));
+				IM_ASSERT(viewport->PlatformUserData);
+				if (viewport == ImGui::GetMainViewport())
+				{
+					return static_cast<gfx_window_impl*>(viewport->PlatformUserData)->m_metrics;
+				}
+				return static_cast<gfx_child_window*>(viewport->PlatformUserData)->m_metrics;
+			}
+
+			[[nodiscard]] auto input_state_of(ImGuiViewport* viewport) noexcept -> viewport_input_state*
+			{
+				if (viewport == nullptr || viewport->PlatformUserData == nullptr)
+				{
+					return nullptr;
+				}
+
+				if (viewport == ImGui::GetMainViewport())
+				{
+					return &static_cast<gfx_window_impl*>(viewport->PlatformUserData)->m_input_state;
+				}
+				return &static_cast<gfx_child_window*>(viewport->PlatformUserData)->m_input_state;
+			}
+
+			// After the input queue overflowed, the dropped events may have been a button or key release: the viewport caches are
+			// seeded from GLFW again and the keys brought in line with the focused viewport.
+			[[nodiscard]] auto reseed_input() noexcept -> leaf::result<void>
+			try
+			{
+				GLFWwindow*		 focused	 = nullptr;
+				ImGuiPlatformIO& platform_io = ImGui::GetPlatformIO();
+				for (int n = 0; n < platform_io.Viewports.Size; n++)
+				{
+					ImGuiViewport*		  viewport = platform_io.Viewports[n];
+					viewport_input_state* state	   = input_state_of(viewport);
+					if (state == nullptr || viewport->PlatformHandle == nullptr)
+					{
+						continue;
+					}
+
+					auto window = static_cast<GLFWwindow*>(viewport->PlatformHandle);
+					state->init(window);
+					if (state->m_focused)
+					{
+						focused = window;
+					}
+				}
+
+				m_application_state->reseed_keys(ImGui::GetIO(), focused);
 				return {};
 			}
+			catch (...)
+			{
+				return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+			}
 
+			// Reads the viewport input caches, GLFW is only called to warp the cursor and when a viewport's passthrough flag changes.
 			[[nodiscard]] auto update_mouse() noexcept -> leaf::result<void>
 			try
 			{
@@ -872,7 +1451,7 @@ namespace mu
 				for (int i = 0; i < IM_ARRAYSIZE(io.MouseDown); i++)
 				{
 					// If a mouse press event came, always pass it as "mouse held this frame", so we don't miss click-release events that are shorter than 1 frame.
-					io.MouseDown[i]								 = m_application_state->m_mouse_just_pressed[i] || glfwGetMouseButton(m_window.get(), i) != 0;
+					io.MouseDown[i]								 = m_application_state->m_mouse_just_pressed[i] || (m_input_state.m_buttons & (1u << i)) != 0;
 					m_application_state->m_mouse_just_pressed[i] = false;
 				}
 
@@ -889,36 +1468,36 @@ namespace mu
 					GLFWwindow* self_window = static_cast<GLFWwindow*>(viewport->PlatformHandle);
 					IM_ASSERT(self_window);
 
-					const bool focused = glfwGetWindowAttrib(self_window, GLFW_FOCUSED) != 0;
-					if (focused)
+					viewport_input_state* state = input_state_of(viewport);
+					if (state == nullptr) [[unlikely]]
+					{
+						continue;
+					}
+
+					if (state->m_focused)
 					{
 						if (io.WantSetMousePos)
 						{
-							glfwSetCursorPos(self_window, (double)(mouse_pos_backup.x - viewport->Pos.x), (double)(mouse_pos_backup.y - viewport->Pos.y));
+							state->m_cursor_x = (double)(mouse_pos_backup.x - viewport->Pos.x);
+							state->m_cursor_y = (double)(mouse_pos_backup.y - viewport->Pos.y);
+							glfwSetCursorPos(self_window, state->m_cursor_x, state->m_cursor_y);
+						}
+						else if (io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable)
+						{
+							// Multi-viewport mode: mouse position in OS absolute coordinates (io.MousePos is (0,0) when the mouse is on the upper-left of the primary
+							// monitor)
+							io.MousePos = ImVec2((float)state->m_cursor_x + state->m_pos_x, (float)state->m_cursor_y + state->m_pos_y);
 						}
 						else
 						{
-							double mouse_x, mouse_y;
-							glfwGetCursorPos(self_window, &mouse_x, &mouse_y);
-							if (io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable)
-							{
-								// Multi-viewport mode: mouse position in OS absolute coordinates (io.MousePos is (0,0) when the mouse is on the upper-left of the primary
-								// monitor)
-								int window_x, window_y;
-								glfwGetWindowPos(self_window, &window_x, &window_y);
-								io.MousePos = ImVec2((float)mouse_x + window_x, (float)mouse_y + window_y);
-							}
-							else
-							{
-								// Single viewport mode: mouse position in client window coordinates (io.MousePos is (0,0) when the mouse is on the upper-left corner of the app
-								// window)
-								io.MousePos = ImVec2((float)mouse_x, (float)mouse_y);
-							}
+							// Single viewport mode: mouse position in client window coordinates (io.MousePos is (0,0) when the mouse is on the upper-left corner of the app
+							// window)
+							io.MousePos = ImVec2((float)state->m_cursor_x, (float)state->m_cursor_y);
 						}
 
 						for (int i = 0; i < IM_ARRAYSIZE(io.MouseDown); i++)
 						{
-							io.MouseDown[i] |= glfwGetMouseButton(self_window, i) != 0;
+							io.MouseDown[i] |= (state->m_buttons & (1u << i)) != 0;
 						}
 					}
 
@@ -931,8 +1510,13 @@ namespace mu
 					// [GLFW] FIXME: This is currently only correct on Win32. See what we do below with the WM_NCHITTEST, missing an equivalent for other systems.
 					// See https://github.com/glfw/glfw/issues/1236 if you want to help in making this a GLFW feature.
 					const bool window_no_input = (viewport->Flags & ImGuiViewportFlags_NoInputs) != 0;
-					glfwSetWindowAttrib(self_window, GLFW_MOUSE_PASSTHROUGH, window_no_input);
-					if (glfwGetWindowAttrib(self_window, GLFW_HOVERED) && !window_no_input)
+					if (state->m_passthrough != window_no_input)
+					{
+						glfwSetWindowAttrib(self_window, GLFW_MOUSE_PASSTHROUGH, window_no_input);
+						state->m_passthrough = window_no_input;
+					}
+
+					if (state->m_hovered && !window_no_input)
 					{
 						io.MouseHoveredViewport = viewport->ID;
 					}
@@ -975,8 +1559,8 @@ namespace mu
 						// FIXME-PLATFORM: Unfocused windows seems to fail changing the mouse cursor with GLFW 3.2, but 3.3 works here.
 						glfwSetCursor(
 							self_window,
-							m_application_state->m_mouse_cursors[imgui_cursor] ? m_application_state->m_mouse_cursors[imgui_cursor]
-																			   : m_application_state->m_mouse_cursors[ImGuiMouseCursor_Arrow]);
+							m_glfw_system->m_mouse_cursors[imgui_cursor] ? m_glfw_system->m_mouse_cursors[imgui_cursor]
+																		 : m_glfw_system->m_mouse_cursors[ImGuiMouseCursor_Arrow]);
 						glfwSetInputMode(self_window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
 					}
 				}
@@ -1105,8 +1689,47 @@ namespace mu
 
 			[[nodiscard]] auto new_frame_sync() noexcept -> leaf::result<void>
 			{
+				MU_GFX_TRACE_SCOPE("new_frame_sync");
 				MU_LEAF_CHECK(m_application_state->make_current());
-				
+
+				ImGuiIO& io = ImGui::GetIO();
+				IM_ASSERT(io.Fonts->IsBuilt() && "Font atlas not built!");
+
+				const bool dropped = m_application_state->drain_input(
+					io,
+					[](GLFWwindow* window) noexcept -> ImGuiViewport* { return ImGui::FindViewportByPlatformHandle(window); },
+					[this](ImGuiViewport* viewport) noexcept -> viewport_input_state* { return input_state_of(viewport); });
+				if (dropped) [[unlikely]]
+				{
+					MU_LEAF_CHECK(reseed_input());
+				}
+
+				if (const auto generation = g_monitor_generation.load(std::memory_order_relaxed); generation != m_application_state->m_monitor_generation)
+				{
+					m_application_state->m_monitor_generation	= generation;
+					m_application_state->m_want_update_monitors = true;
+				}
+
+				if (auto& player = m_application_state->m_input_player; player && player->finished())
+				{
+					player.reset();
+					m_application_state->m_timer_ready = false;
+				}
+
+				if (auto& player = m_application_state->m_input_player)
+				{
+					// Nothing is polled while replaying: display size, mouse and delta time all come from the recording
+					player->apply_frame(io);
+
+					if (m_application_state->m_want_update_monitors)
+					{
+						MU_LEAF_CHECK(update_monitors());
+					}
+
+					MU_LEAF_CHECK(update_cursor());
+					return {};
+				}
+
 				time::moment delta_time;
 				if (m_application_state->m_timer_ready) [[likely]]
 				{
@@ -1120,15 +1743,10 @@ namespace mu
 					m_application_state->m_timer_ready = true;
 				}
 
-				ImGuiIO& io = ImGui::GetIO();
-				IM_ASSERT(io.Fonts->IsBuilt() && "Font atlas not built!");
-
 				io.DeltaTime = delta_time.as_seconds<float>();
 
 				// Setup display size (every frame to accommodate for window resizing)
-				int w, h;
-				glfwGetWindowSize(m_window.get(), &w, &h);
-				io.DisplaySize = ImVec2((float)w, (float)h);
+				io.DisplaySize = ImVec2((float)m_metrics.m_window_size[0], (float)m_metrics.m_window_size[1]);
 
 				if (m_application_state->m_want_update_monitors)
 				{
@@ -1139,6 +1757,11 @@ namespace mu
 				MU_LEAF_CHECK(update_cursor());
 				MU_LEAF_CHECK(update_gamepads());
 
+				if (m_application_state->m_input_recorder)
+				{
+					m_application_state->m_input_recorder->record_frame(io);
+				}
+
 				// TODO: Update child windows?
 
 				return {};
@@ -1146,62 +1769,40 @@ namespace mu
 
 			virtual [[nodiscard]] auto begin_frame_async() noexcept -> mu::leaf::result<void>
 			{
+				MU_GFX_TRACE_SCOPE("begin_frame_async");
 				MU_LEAF_CHECK(m_application_state->make_current());
 
 				MU_LEAF_CHECK(update_dpi());
 
 				MU_LEAF_CHECK(init_resources());
 
-				if (m_diligent_window) [[likely]]
-				{
-					MU_LEAF_CHECK(m_diligent_window->create_resources(m_display_size[0], m_display_size[1]));
-
-					ImGuiPlatformIO& platform_io = ImGui::GetPlatformIO();
-					for (int n = 1; n < platform_io.Viewports.Size; n++)
-					{
-						ImGuiViewport* viewport = platform_io.Viewports[n];
-						IM_ASSERT(viewport);
-
-						if (!(viewport->Flags & ImGuiViewportFlags_Minimized))
-						{
-							auto wnd = static_cast<gfx_child_window*>(viewport->PlatformUserData);
-							MU_LEAF_CHECK(wnd->begin_frame(m_diligent_window->m_globals, m_imgui_renderer->m_shared_resources));
-						}
-					}
-
-					return {};
-				}
-				else
+				// Swap chains are resized by the submission jobs, child windows initialized in end_imgui_sync
+				if (!m_diligent_window) [[unlikely]]
 				{
 					return MU_LEAF_NEW_ERROR(mu::gfx_error::not_specified{});
 				}
+
+				return {};
 			}
 
 			virtual [[nodiscard]] auto end_frame() noexcept -> mu::leaf::result<void>
 			try
 			{
+				MU_GFX_TRACE_SCOPE("end_frame");
 				MU_LEAF_CHECK(m_application_state->make_current());
 
-				ImGuiPlatformIO& platform_io = ImGui::GetPlatformIO();
-
-				if (m_diligent_window && m_diligent_window->m_swap_chain)
+				switch (m_frame_pipeline)
 				{
-					MU_LEAF_CHECK(m_diligent_window->present());
-				}
+				case gfx_frame_pipeline::immediate:
+					// Waited for anyway, so done here rather than handed to the submission thread
+					return m_renderer_globals->m_submission_queue->run_inline(m_submissions, [this]() noexcept -> mu::leaf::result<void> { return submit_frame(); });
 
-				for (int n = 1; n < platform_io.Viewports.Size; n++)
-				{
-					ImGuiViewport* viewport = platform_io.Viewports[n];
-					IM_ASSERT(viewport);
+				case gfx_frame_pipeline::strict:
+					return wait_submissions();
 
-					if (!(viewport->Flags & ImGuiViewportFlags_Minimized))
-					{
-						auto wnd = static_cast<gfx_child_window*>(viewport->PlatformUserData);
-						MU_LEAF_CHECK(wnd->present());
-					}
+				default:
+					return {};
 				}
-
-				return {};
 			}
 			catch (...)
 			{
@@ -1212,16 +1813,31 @@ namespace mu
 			{
 				try
 				{
+					MU_GFX_TRACE_SCOPE("begin_imgui_sync");
 					MU_LEAF_CHECK(m_application_state->make_current());
 
 					MU_LEAF_CHECK(new_frame_sync());
 
 					MU_LEAF_CHECK(update_dpi());
 
-					MU_LEAF_CHECK(m_imgui_shared_resources->create_device_objects(m_dpi_scale, false));
-					ImGuiIO& io		= ImGui::GetIO();
-					io.Fonts->TexID = (ImTextureID)m_imgui_shared_resources->m_font_srv;
+					// Coverage atlases are built at the window's scale, only distance fields are scaled when drawn
+					if (!m_imgui_font_resources->m_sdf && m_imgui_font_resources->m_scale != m_dpi_scale)
+					{
+						MU_LEAF_CHECK(use_fonts(m_dpi_scale));
+					}
+					ImGuiIO& io		   = ImGui::GetIO();
+					io.FontGlobalScale = m_dpi_scale / m_imgui_font_resources->m_scale;
+					if (m_imgui_font_resources->m_glyph_cache)
+					{
+						m_glyph_frame = m_imgui_font_resources->m_glyph_cache->begin_frame(this);
+					}
 
+					if (m_compact_imgui.exchange(false))
+					{
+						compact_imgui();
+					}
+
+					std::unique_lock lock(m_imgui_font_resources->m_atlas_mutex);
 					ImGui::NewFrame();
 					return {};
 				}
@@ -1235,8 +1851,10 @@ namespace mu
 			{
 				try
 				{
+					MU_GFX_TRACE_SCOPE("end_imgui_async");
 					MU_LEAF_CHECK(m_application_state->make_current());
 
+					std::unique_lock lock(m_imgui_font_resources->m_atlas_mutex);
 					ImGui::Render();
 					ImGui::EndFrame();
 
@@ -1251,43 +1869,425 @@ namespace mu
 			{
 				try
 				{
+					MU_GFX_TRACE_SCOPE("end_imgui_sync");
 					MU_LEAF_CHECK(m_application_state->make_current());
 
-					ImGui::UpdatePlatformWindows();
+					// UpdatePlatformWindows may destroy windows the previous frame is still presenting to
+					MU_LEAF_CHECK(wait_submissions());
 
-					// ImGuiIO& io = ImGui::GetIO();
-					MU_LEAF_CHECK(render(ImGui::GetDrawData()));
+					ImGui::UpdatePlatformWindows();
 
 					ImGuiPlatformIO& platform_io = ImGui::GetPlatformIO();
-					for (int n = 1; n < platform_io.Viewports.Size; n++)
+					// A failed capture loses the frame from the file, not from the screen
+					if (m_draw_capture && !capture_draw_data(platform_io)) [[unlikely]]
 					{
-						ImGuiViewport* viewport = platform_io.Viewports[n];
-						IM_ASSERT(viewport);
+						m_draw_capture->abort_frame();
+						MU_LEAF_LOG_ERROR(gfx_error::not_specified{});
+					}
+
+					return submit_snapshot(platform_io);
+				}
+				catch (...)
+				{
+					return MU_LEAF_NEW_ERROR(mu::gfx_error::not_specified{});
+				}
+			}
+
+			// Collects the frame's draw data into m_snapshot and, in the pipelined modes, queues submitting it. Runs while none of this
+			// window's jobs are queued, so new child windows can create their swap chains here. The immediate mode borrows ImGui's lists
+			// and end_frame submits them before the next NewFrame; the pipelined modes take the lists over.
+			[[nodiscard]] auto submit_snapshot(ImGuiPlatformIO& platform_io) noexcept -> mu::leaf::result<void>
+			try
+			{
+				MU_GFX_TRACE_SCOPE("submit_snapshot");
+				MU_LEAF_CHECK(update_dpi());
+
+				const bool immediate = m_frame_pipeline == gfx_frame_pipeline::immediate;
+				const bool track	 = m_renderer_globals->m_render_options.m_partial_redraw;
+				auto	   collect	 = [&](void* target, damage_tracker& tracker, std::array<int, 2> size, ImDrawData* draw_data) -> void
+				{
+					const auto count = m_snapshot.m_viewports.size();
+					if (immediate)
+					{
+						m_snapshot.borrow(target, size, draw_data);
+					}
+					else
+					{
+						m_snapshot.take(target, size, draw_data);
+					}
+
+					if (track && m_snapshot.m_viewports.size() > count)
+					{
+						auto& vp	= m_snapshot.m_viewports.back();
+						vp.m_damage = tracker.update(&vp.m_draw_data);
+					}
+				};
+
+				m_snapshot.reset();
+				m_snapshot_fonts	   = m_imgui_font_resources;
+				m_snapshot_glyph_frame = std::move(m_glyph_frame);
+				collect(this, m_damage_tracker, m_display_size, ImGui::GetDrawData());
+
+				for (int n = 1; n < platform_io.Viewports.Size; n++)
+				{
+					ImGuiViewport* viewport = platform_io.Viewports[n];
+					IM_ASSERT(viewport);
+
+					if (!(viewport->Flags & ImGuiViewportFlags_Minimized))
+					{
+						auto wnd = static_cast<gfx_child_window*>(viewport->PlatformUserData);
+						MU_LEAF_CHECK(wnd->update_dpi());
+						MU_LEAF_CHECK(wnd->init_resources(m_diligent_window->m_globals, m_imgui_renderer->m_shared_resources, m_resize_policy));
+						collect(wnd, wnd->m_damage_tracker, wnd->m_display_size, viewport->DrawData);
+					}
+				}
+
+				// The immediate mode submits from end_frame
+				if (immediate)
+				{
+					return {};
+				}
+				return m_renderer_globals->m_submission_queue->push(m_submissions, [this]() -> mu::leaf::result<void> { return submit_frame(); });
+			}
+			catch (...)
+			{
+				return MU_LEAF_NEW_ERROR(mu::gfx_error::not_specified{});
+			}
+
+			// Records and presents m_snapshot, on the submission thread or, in the immediate mode, in end_frame.
+			[[nodiscard]] auto submit_frame() noexcept -> mu::leaf::result<void>
+			{
+				auto recorded = record_snapshot();
+				m_snapshot_glyph_frame.reset();
+				if (!recorded) [[unlikely]]
+				{
+					return recorded;
+				}
+				MU_LEAF_CHECK(present_snapshot());
+				apply_memory_budget();
+				return {};
+			}
+
+			// Resize and record every viewport of m_snapshot.
+			[[nodiscard]] auto record_snapshot() noexcept -> mu::leaf::result<void>
+			{
+				MU_GFX_TRACE_SCOPE("record_snapshot");
+				auto ctx = m_render_context.get();
+
+				// Whatever is drawn, so that glyphs added by a frame with nothing to redraw are not held back until one has
+				if (m_snapshot_fonts->m_glyph_cache)
+				{
+					m_snapshot_fonts->m_glyph_cache->upload(ctx);
+				}
+
+				for (auto& vp : m_snapshot.m_viewports)
+				{
+					if (vp.m_target == this)
+					{
+						MU_LEAF_CHECK(record_viewport(ctx, *m_diligent_window, *m_imgui_renderer, *m_snapshot_fonts, vp));
+					}
+					else
+					{
+						MU_LEAF_CHECK(static_cast<gfx_child_window*>(vp.m_target)->render_snapshot(ctx, vp, *m_snapshot_fonts));
+					}
+				}
+
+				return {};
+			}
+
+			// Once a frame is recorded, with the immediate context: gives back what can be rebuilt while over budget, see gfx_memory_budget.
+			// Only the viewports drawn this frame are counted. Trimming what is already trimmed does nothing, so a window that stays
+			// over its budget does not keep recreating buffers.
+			auto apply_memory_budget() noexcept -> void
+			{
+				if (m_memory_budget.m_gpu_bytes == 0 && m_memory_budget.m_cpu_bytes == 0)
+				{
+					return;
+				}
+
+				gfx_memory_stats stats;
+				for (const auto& vp : m_snapshot.m_viewports)
+				{
+					if (vp.m_target == this)
+					{
+						viewport_memory_stats(m_diligent_window.get(), m_imgui_renderer.get(), stats);
+					}
+					else
+					{
+						auto wnd = static_cast<gfx_child_window*>(vp.m_target);
+						viewport_memory_stats(wnd->m_diligent_window.get(), wnd->m_imgui_renderer.get(), stats);
+					}
+				}
+				stats.m_imgui_heap = imgui_heap_bytes(m_application_state->m_imgui_heap);
 
-						if (!(viewport->Flags & ImGuiViewportFlags_Minimized))
+				if (m_memory_budget.m_gpu_bytes != 0 && stats.gpu_bytes() > m_memory_budget.m_gpu_bytes)
+				{
+					MU_GFX_TRACE_SCOPE("trim_gpu");
+					for (const auto& vp : m_snapshot.m_viewports)
+					{
+						auto renderer = vp.m_target == this ? m_imgui_renderer.get() : static_cast<gfx_child_window*>(vp.m_target)->m_imgui_renderer.get();
+						if (renderer != nullptr)
 						{
-							auto wnd = static_cast<gfx_child_window*>(viewport->PlatformUserData);
-							MU_LEAF_CHECK(wnd->render(m_renderer_globals->m_immediate_context, viewport->DrawData));
+							renderer->trim();
 						}
 					}
+				}
 
-					return {};
+				if (m_memory_budget.m_cpu_bytes != 0 && stats.cpu_bytes() > m_memory_budget.m_cpu_bytes)
+				{
+					m_compact_imgui.store(true);
 				}
-				catch (...)
+			}
+
+			// Frame thread, before NewFrame: frees the draw buffers of windows that were not shown, ImGui builds them again if they are.
+			// ImGui does the same by itself after io.ConfigMemoryCompactTimer.
+			auto compact_imgui() noexcept -> void
+			{
+				MU_GFX_TRACE_SCOPE("compact_imgui");
+				ImGuiContext& g = *ImGui::GetCurrentContext();
+				for (ImGuiWindow* window : g.Windows)
 				{
-					return MU_LEAF_NEW_ERROR(mu::gfx_error::not_specified{});
+					if (!window->Active && !window->WasActive && !window->MemoryCompacted)
+					{
+						ImGui::GcCompactTransientWindowBuffers(window);
+					}
 				}
 			}
 
+			// Present every viewport of m_snapshot.
+			[[nodiscard]] auto present_snapshot() noexcept -> mu::leaf::result<void>
+			{
+				MU_GFX_TRACE_SCOPE("present_snapshot");
+				auto ctx = m_render_context.get();
+
+				for (auto& vp : m_snapshot.m_viewports)
+				{
+					if (vp.m_target == this)
+					{
+						MU_LEAF_CHECK(m_diligent_window->present(ctx));
+					}
+					else
+					{
+						MU_LEAF_CHECK(static_cast<gfx_child_window*>(vp.m_target)->present_snapshot(ctx));
+					}
+				}
+
+				return {};
+			}
+
 			[[nodiscard]] auto present() noexcept -> mu::leaf::result<void>
 			{
 				return {};
 			}
 
+			[[nodiscard]] auto capture_draw_data(ImGuiPlatformIO& platform_io) noexcept -> mu::leaf::result<void>
+			{
+				MU_GFX_TRACE_SCOPE("capture_draw_data");
+				MU_LEAF_CHECK(m_draw_capture->begin_frame());
+				for (int n = 0; n < platform_io.Viewports.Size; n++)
+				{
+					ImGuiViewport* viewport = platform_io.Viewports[n];
+					IM_ASSERT(viewport);
+
+					if (!(viewport->Flags & ImGuiViewportFlags_Minimized))
+					{
+						MU_LEAF_CHECK(m_draw_capture->add_viewport(viewport->ID, viewport->DrawData));
+					}
+				}
+				return m_draw_capture->end_frame();
+			}
+
 			virtual [[nodiscard]] auto make_current() noexcept -> mu::leaf::result<void>
 			{
 				return m_application_state->make_current();
 			}
+
+			virtual [[nodiscard]] auto set_frame_pipeline(gfx_frame_pipeline pipeline) noexcept -> mu::leaf::result<void>
+			try
+			{
+				// A pipelined frame may still be in flight
+				MU_LEAF_CHECK(wait_submissions());
+
+				m_frame_pipeline = pipeline;
+				return {};
+			}
+			catch (...)
+			{
+				return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+			}
+
+			virtual [[nodiscard]] auto set_resize_policy(const gfx_resize_policy& policy) noexcept -> mu::leaf::result<void>
+			{
+				// Swap chains are resized by queued jobs
+				MU_LEAF_CHECK(wait_submissions());
+				MU_LEAF_CHECK(m_application_state->make_current());
+
+				m_resize_policy = policy;
+				if (m_diligent_window)
+				{
+					m_diligent_window->m_resize_policy = policy;
+				}
+
+				ImGuiPlatformIO& platform_io = ImGui::GetPlatformIO();
+				for (int n = 1; n < platform_io.Viewports.Size; n++)
+				{
+					auto wnd = static_cast<gfx_child_window*>(platform_io.Viewports[n]->PlatformUserData);
+					if (wnd && wnd->m_diligent_window)
+					{
+						wnd->m_diligent_window->m_resize_policy = policy;
+					}
+				}
+
+				return {};
+			}
+
+			virtual [[nodiscard]] auto memory_stats() noexcept -> mu::leaf::result<gfx_memory_stats>
+			try
+			{
+				// Renderer buffers are resized and trimmed by queued jobs
+				MU_LEAF_CHECK(wait_submissions());
+
+				gfx_memory_stats stats;
+				viewport_memory_stats(m_diligent_window.get(), m_imgui_renderer.get(), stats);
+
+				// Through the window's own context, the calling thread's current one may be another window's, e.g. in a UI callback
+				const ImGuiPlatformIO& platform_io = m_application_state->m_imgui_lib_context->PlatformIO;
+				for (int n = 1; n < platform_io.Viewports.Size; n++)
+				{
+					auto wnd = static_cast<gfx_child_window*>(platform_io.Viewports[n]->PlatformUserData);
+					if (wnd)
+					{
+						viewport_memory_stats(wnd->m_diligent_window.get(), wnd->m_imgui_renderer.get(), stats);
+					}
+				}
+
+				stats.m_imgui_heap = imgui_heap_bytes(m_application_state->m_imgui_heap);
+				return stats;
+			}
+			catch (...)
+			{
+				return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+			}
+
+			virtual [[nodiscard]] auto set_memory_budget(const gfx_memory_budget& budget) noexcept -> mu::leaf::result<void>
+			{
+				// Read by queued jobs
+				MU_LEAF_CHECK(wait_submissions());
+
+				m_memory_budget = budget;
+				return {};
+			}
+
+			// Queued jobs must not see m_render_context or the swap chains change under them
+			[[nodiscard]] auto wait_submissions() noexcept -> mu::leaf::result<void>
+			{
+				if (m_renderer_globals)
+				{
+					return m_renderer_globals->m_submission_queue->wait(m_submissions);
+				}
+				return {};
+			}
+
+			virtual [[nodiscard]] auto begin_command_recording(const char* path) noexcept -> mu::leaf::result<void>
+			try
+			{
+				MU_LEAF_CHECK(wait_submissions());
+				MU_LEAF_CHECK(end_command_recording());
+
+				m_command_recorder = std::make_shared<command_log_recorder>(m_render_context, path);
+				m_render_context   = m_command_recorder;
+				return {};
+			}
+			catch (...)
+			{
+				return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+			}
+
+			virtual [[nodiscard]] auto end_command_recording() noexcept -> mu::leaf::result<void>
+			try
+			{
+				if (!m_command_recorder)
+				{
+					return {};
+				}
+
+				MU_LEAF_CHECK(wait_submissions());
+				auto recorder	 = std::move(m_command_recorder);
+				m_render_context = recorder->m_inner;
+				return recorder->close();
+			}
+			catch (...)
+			{
+				return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+			}
+
+			virtual [[nodiscard]] auto begin_draw_capture(const char* path) noexcept -> mu::leaf::result<void>
+			try
+			{
+				MU_LEAF_CHECK(end_draw_capture());
+
+				auto writer = std::make_unique<draw_capture_writer>();
+				MU_LEAF_CHECK(writer->open(path));
+				m_draw_capture = std::move(writer);
+				return {};
+			}
+			catch (...)
+			{
+				return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+			}
+
+			virtual [[nodiscard]] auto end_draw_capture() noexcept -> mu::leaf::result<void>
+			{
+				if (!m_draw_capture)
+				{
+					return {};
+				}
+
+				auto writer = std::move(m_draw_capture);
+				return writer->close();
+			}
+
+			virtual [[nodiscard]] auto begin_input_recording() noexcept -> mu::leaf::result<void>
+			try
+			{
+				m_application_state->m_input_recorder = std::make_unique<input_recorder>();
+				return {};
+			}
+			catch (...)
+			{
+				return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+			}
+
+			virtual [[nodiscard]] auto end_input_recording(const char* path) noexcept -> mu::leaf::result<void>
+			{
+				if (!m_application_state->m_input_recorder) [[unlikely]]
+				{
+					return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+				}
+
+				auto recorder = std::move(m_application_state->m_input_recorder);
+				return recorder->save(path);
+			}
+
+			virtual [[nodiscard]] auto begin_input_replay(const char* path, float delta_time) noexcept -> mu::leaf::result<void>
+			try
+			{
+				auto player = std::make_unique<input_player>();
+				MU_LEAF_CHECK(player->load(path));
+				player->m_delta_time = delta_time;
+
+				m_application_state->m_input_player = std::move(player);
+				return {};
+			}
+			catch (...)
+			{
+				return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+			}
+
+			virtual [[nodiscard]] auto is_replaying_input() noexcept -> mu::leaf::result<bool>
+			{
+				return m_application_state->m_input_player != nullptr;
+			}
 		};
 	} // namespace details
 } // namespace mu
@@ -1300,6 +2300,9 @@ namespace mu
 		{
 			std::shared_ptr<glfw_system>				m_glfw_system;
 			std::vector<std::weak_ptr<gfx_window_impl>> m_windows;
+			frame_graph									 m_frame_graph;
+			std::vector<std::shared_ptr<gfx_window>>	 m_frame_windows; // of the frame run_frame runs, kept to reuse its storage
+			gfx_memory_budget							 m_memory_budget; // of what the windows share, see set_memory_budget
 
 			gfx_impl() : m_glfw_system(std::make_shared<glfw_system>()) { }
 
@@ -1320,6 +2323,7 @@ namespace mu
 			virtual auto pump() noexcept -> mu::leaf::result<void>
 			try
 			{
+				MU_GFX_TRACE_SCOPE("pump");
 				glfwPollEvents();
 				return {};
 			}
@@ -1330,6 +2334,7 @@ namespace mu
 
 			virtual auto present() noexcept -> mu::leaf::result<void>
 			{
+				MU_GFX_TRACE_SCOPE("present");
 				for (auto itor = m_windows.begin(); itor != m_windows.end();)
 				{
 					if (itor->expired()) [[unlikely]]
@@ -1342,8 +2347,145 @@ namespace mu
 						++itor;
 					}
 				}
+				apply_memory_budget();
 				return {};
 			}
+
+			virtual auto set_render_options(const gfx_render_options& options) noexcept -> mu::leaf::result<void>
+			{
+				std::unique_lock lock(m_glfw_system->m_renderer_mutex);
+				if (!m_glfw_system->m_renderer_globals.expired()) [[unlikely]]
+				{
+					return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+				}
+				m_glfw_system->m_render_options = options;
+				return {};
+			}
+
+			virtual auto run_frame(tf::Executor& executor, const gfx_ui_callback& ui) noexcept -> mu::leaf::result<void>
+			try
+			{
+				MU_LEAF_CHECK(pump());
+
+				m_frame_windows.clear();
+				for (auto itor = m_windows.begin(); itor != m_windows.end();)
+				{
+					if (auto window = itor->lock())
+					{
+						m_frame_windows.push_back(std::move(window));
+						++itor;
+					}
+					else
+					{
+						itor = m_windows.erase(itor);
+					}
+				}
+
+				// Closed windows are not kept alive until the next frame
+				auto result = m_frame_graph.run(executor, m_frame_windows, ui);
+				m_frame_windows.clear();
+
+				// Like do_frame, the windows that did close their frame are presented whatever failed
+				auto presented = present();
+				if (!result) [[unlikely]]
+				{
+					return result;
+				}
+				return presented;
+			}
+			catch (...)
+			{
+				return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+			}
+
+			virtual auto memory_stats() noexcept -> mu::leaf::result<gfx_memory_stats>
+			try
+			{
+				gfx_memory_stats stats;
+				for (auto& weak_window : m_windows)
+				{
+					if (auto window = weak_window.lock())
+					{
+						MU_LEAF_AUTO(window_stats, window->memory_stats());
+						stats += window_stats;
+					}
+				}
+
+				stats += shared_memory_stats();
+				return stats;
+			}
+			catch (...)
+			{
+				return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+			}
+
+			virtual auto set_memory_budget(const gfx_memory_budget& budget) noexcept -> mu::leaf::result<void>
+			{
+				m_memory_budget = budget;
+				return {};
+			}
+
+			// What every window shares, counted by no window's memory_stats.
+			auto shared_memory_stats() -> gfx_memory_stats
+			{
+				gfx_memory_stats stats;
+				std::unique_lock lock(m_glfw_system->m_renderer_mutex);
+				if (auto shared = m_glfw_system->m_imgui_shared_resources.lock(); shared && shared->m_vertex_constant_buffer)
+				{
+					stats.m_constant_buffers += shared->m_vertex_constant_buffer->GetDesc().uiSizeInBytes;
+				}
+				for (const auto& [scale, weak_fonts] : m_glfw_system->m_imgui_font_resources)
+				{
+					auto fonts = weak_fonts.lock();
+					if (!fonts)
+					{
+						continue;
+					}
+					if (fonts->m_font_tex)
+					{
+						const auto& desc = fonts->m_font_tex->GetDesc();
+						stats.m_font_textures += diligent_window::texture_bytes(desc.Width, desc.Height, desc.Format);
+					}
+					if (fonts->m_glyph_cache)
+					{
+						fonts->m_glyph_cache->memory(stats.m_font_textures, stats.m_glyph_pixels);
+					}
+				}
+				stats.m_imgui_heap += imgui_heap_bytes(0);
+				return stats;
+			}
+
+			// Once every window presented: past the shared budget, the glyph caches free their pages not drawn lately. The atlases are
+			// in use by every window at their scale and never trimmed.
+			auto apply_memory_budget() noexcept -> void
+			try
+			{
+				if (m_memory_budget.m_gpu_bytes == 0 && m_memory_budget.m_cpu_bytes == 0)
+				{
+					return;
+				}
+
+				const auto stats = shared_memory_stats();
+				if ((m_memory_budget.m_gpu_bytes == 0 || stats.gpu_bytes() <= m_memory_budget.m_gpu_bytes) &&
+					(m_memory_budget.m_cpu_bytes == 0 || stats.cpu_bytes() <= m_memory_budget.m_cpu_bytes))
+				{
+					return;
+				}
+
+				MU_GFX_TRACE_SCOPE("trim_shared");
+				std::unique_lock lock(m_glfw_system->m_renderer_mutex);
+				for (const auto& [scale, weak_fonts] : m_glfw_system->m_imgui_font_resources)
+				{
+					if (auto fonts = weak_fonts.lock(); fonts && fonts->m_glyph_cache)
+					{
+						fonts->m_glyph_cache->trim();
+					}
+				}
+			}
+			catch (...)
+			{
+				MU_LEAF_LOG_ERROR(gfx_error::not_specified{});
+			}
 		};
 	} // namespace details
 } // namespace mu
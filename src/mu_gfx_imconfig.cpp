@@ -0,0 +1,6 @@
+#include "mu_gfx_impl.h"
+
+#ifdef MU_GFX_THREAD_LOCAL_IMGUI
+// imgui.cpp skips its own definition when GImGui is a macro
+thread_local ImGuiContext* mu_gfx_imgui_context = nullptr;
+#endif
@@ -1,3 +1,4 @@
 #pragma once
 
 #include "mu_gfx.h"
+#include "mu_gfx_trace.h"
@@ -0,0 +1,228 @@
+#include <mu_gfx_trace.h>
+
+#if defined(MU_GFX_ENABLE_TRACING)
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace mu
+{
+	namespace gfx_trace
+	{
+		namespace
+		{
+			struct trace_event
+			{
+				const char*	  m_name;
+				std::uint64_t m_begin_ns;
+				std::uint64_t m_end_ns;
+			};
+
+			// Single writer (the owning thread), read on demand by write_chrome_trace while it records. Once full the buffer wraps and keeps
+			// the newest spans.
+			struct thread_buffer
+			{
+				static constexpr std::uint64_t capacity = 1 << 16;
+
+				std::array<trace_event, capacity> m_events;
+				std::atomic<std::uint64_t>		  m_count{0};
+				std::atomic<const char*>		  m_thread_name{nullptr};
+				std::uint32_t					  m_thread_index{0};
+				thread_buffer*					  m_next{nullptr};
+			};
+
+			// Buffers are pushed once per thread and live until process exit, so the list only ever grows.
+			std::atomic<thread_buffer*> g_buffers{nullptr};
+			std::atomic<std::uint32_t>	g_thread_count{0};
+
+			const auto g_epoch = std::chrono::steady_clock::now();
+
+			auto local_buffer() noexcept -> thread_buffer*
+			{
+				thread_local thread_buffer* buffer = []() -> thread_buffer*
+				{
+					auto new_buffer			   = new (std::nothrow) thread_buffer();
+					if (new_buffer == nullptr) [[unlikely]]
+					{
+						return nullptr;
+					}
+					new_buffer->m_thread_index = g_thread_count.fetch_add(1, std::memory_order_relaxed);
+					new_buffer->m_next		   = g_buffers.load(std::memory_order_relaxed);
+					while (!g_buffers.compare_exchange_weak(new_buffer->m_next, new_buffer, std::memory_order_release, std::memory_order_relaxed))
+					{
+					}
+					return new_buffer;
+				}();
+				return buffer;
+			}
+
+			// Task names are owned by taskflow graphs that are rebuilt every frame, so they are interned to keep the recorded pointers valid.
+			auto intern(const std::string& name) noexcept -> const char*
+			try
+			{
+				thread_local std::unordered_map<std::string, const char*> local_cache;
+				if (auto itor = local_cache.find(name); itor != local_cache.end()) [[likely]]
+				{
+					return itor->second;
+				}
+
+				static std::mutex					   intern_mutex;
+				static std::unordered_set<std::string> interned;
+
+				const char* result = nullptr;
+				{
+					std::lock_guard<std::mutex> lock(intern_mutex);
+					result = interned.insert(name).first->c_str();
+				}
+				local_cache.emplace(name, result);
+				return result;
+			}
+			catch (...)
+			{
+				return "task";
+			}
+
+			auto write_json_string(std::ostream& os, const char* str) -> void
+			{
+				os << '"';
+				for (; *str != '\0'; ++str)
+				{
+					const char c = *str;
+					if (c == '"' || c == '\\')
+					{
+						os << '\\' << c;
+					}
+					else if (static_cast<unsigned char>(c) < 0x20)
+					{
+						os << ' ';
+					}
+					else
+					{
+						os << c;
+					}
+				}
+				os << '"';
+			}
+		} // namespace
+
+		auto now_ns() noexcept -> std::uint64_t
+		{
+			return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - g_epoch).count());
+		}
+
+		auto record(const char* name, std::uint64_t begin_ns, std::uint64_t end_ns) noexcept -> void
+		{
+			if (auto buffer = local_buffer(); buffer != nullptr) [[likely]]
+			{
+				// Orders the previous count before the slot is written, for write_chrome_trace to tell which spans it overwrote
+				std::atomic_thread_fence(std::memory_order_release);
+				const auto n								   = buffer->m_count.load(std::memory_order_relaxed);
+				buffer->m_events[n % thread_buffer::capacity] = trace_event{name, begin_ns, end_ns};
+				buffer->m_count.store(n + 1, std::memory_order_release);
+			}
+		}
+
+		auto set_thread_name(const char* name) noexcept -> void
+		{
+			if (auto buffer = local_buffer(); buffer != nullptr) [[likely]]
+			{
+				buffer->m_thread_name.store(name, std::memory_order_release);
+			}
+		}
+
+		auto clear() noexcept -> void
+		{
+			for (auto buffer = g_buffers.load(std::memory_order_acquire); buffer != nullptr; buffer = buffer->m_next)
+			{
+				buffer->m_count.store(0, std::memory_order_release);
+			}
+		}
+
+		auto write_chrome_trace(const char* path) noexcept -> mu::leaf::result<void>
+		try
+		{
+			std::ofstream os(path, std::ios::out | std::ios::trunc);
+			if (!os) [[unlikely]]
+			{
+				return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+			}
+
+			os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+			bool					 first = true;
+			std::vector<trace_event> events;
+			events.reserve(thread_buffer::capacity);
+			for (auto buffer = g_buffers.load(std::memory_order_acquire); buffer != nullptr; buffer = buffer->m_next)
+			{
+				if (auto thread_name = buffer->m_thread_name.load(std::memory_order_acquire); thread_name != nullptr)
+				{
+					os << (first ? "" : ",") << "\n{\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->m_thread_index << ",\"name\":\"thread_name\",\"args\":{\"name\":";
+					write_json_string(os, thread_name);
+					os << "}}";
+					first = false;
+				}
+
+				// The owning thread may keep recording: copy the spans first, then drop the ones it overwrote meanwhile, including
+				// the slot it may be writing now.
+				const auto count = buffer->m_count.load(std::memory_order_acquire);
+				const auto begin = count > thread_buffer::capacity ? count - thread_buffer::capacity : 0;
+				events.clear();
+				for (auto n = begin; n < count; ++n)
+				{
+					events.push_back(buffer->m_events[n % thread_buffer::capacity]);
+				}
+				std::atomic_thread_fence(std::memory_order_acquire);
+				const auto recorded = buffer->m_count.load(std::memory_order_relaxed);
+				const auto skipped	= recorded >= thread_buffer::capacity ? std::min(recorded - thread_buffer::capacity + 1, count) : begin;
+
+				for (auto n = std::max(begin, skipped); n < count; ++n)
+				{
+					const auto& evt = events[n - begin];
+					os << (first ? "" : ",") << "\n{\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->m_thread_index << ",\"name\":";
+					write_json_string(os, evt.m_name);
+					os << ",\"ts\":" << (evt.m_begin_ns / 1000) << '.' << (evt.m_begin_ns % 1000) / 100 << ",\"dur\":" << ((evt.m_end_ns - evt.m_begin_ns) / 1000) << '.'
+					   << ((evt.m_end_ns - evt.m_begin_ns) % 1000) / 100 << "}";
+					first = false;
+				}
+			}
+			os << "\n]}\n";
+
+			if (!os) [[unlikely]]
+			{
+				return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+			}
+			return {};
+		}
+		catch (...)
+		{
+			return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+		}
+
+		executor_observer::~executor_observer() = default;
+
+		auto executor_observer::set_up(size_t num_workers) -> void
+		{
+			m_begin_ns.assign(num_workers, 0);
+		}
+
+		auto executor_observer::on_entry(tf::WorkerView wv, tf::TaskView) -> void
+		{
+			m_begin_ns[wv.id()] = now_ns();
+		}
+
+		auto executor_observer::on_exit(tf::WorkerView wv, tf::TaskView tv) -> void
+		{
+			const auto end_ns = now_ns();
+			record(tv.name().empty() ? "task" : intern(tv.name()), m_begin_ns[wv.id()], end_ns);
+		}
+	} // namespace gfx_trace
+} // namespace mu
+
+#endif // #if defined(MU_GFX_ENABLE_TRACING)
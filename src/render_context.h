@@ -0,0 +1,481 @@
+#pragma once
+
+#include <mu_stdlib.h>
+
+#include <Graphics/GraphicsEngine/interface/DeviceContext.h>
+#include <Graphics/GraphicsEngine/interface/SwapChain.h>
+#include <Graphics/GraphicsEngine/interface/ShaderResourceBinding.h>
+#include <Graphics/GraphicsEngine/interface/TextureView.h>
+#include <Common/interface/RefCntAutoPtr.hpp>
+
+#include <array>
+#include <vector>
+
+namespace mu
+{
+	// The subset of IDeviceContext / ISwapChain that mu_gfx issues. The renderer and windows only talk to the GPU through this,
+	// so the command stream can be stubbed out, counted or recorded without touching the rendering code.
+	struct render_context
+	{
+		render_context()		  = default;
+		virtual ~render_context() = default;
+
+		// size is the number of bytes the caller is about to write, which is what gets counted or recorded.
+		virtual auto map_buffer(Diligent::IBuffer* buffer, Diligent::Uint32 size, Diligent::MAP_TYPE map_type, Diligent::MAP_FLAGS map_flags) -> void* = 0;
+		virtual auto unmap_buffer(Diligent::IBuffer* buffer, Diligent::MAP_TYPE map_type) -> void													= 0;
+		virtual auto update_buffer(Diligent::IBuffer* buffer, Diligent::Uint32 offset, Diligent::Uint32 size, const void* data) -> void			= 0;
+
+		// Writes box of the first mip of view's texture from data, which holds stride bytes for each row of the box.
+		virtual auto update_texture(Diligent::ITextureView* view, const Diligent::Box& box, const void* data, Diligent::Uint32 stride) -> void = 0;
+
+		// Copies size bytes between buffers on the GPU, e.g. from a dynamic staging buffer into a default one.
+		virtual auto copy_buffer(Diligent::IBuffer* src, Diligent::Uint32 src_offset, Diligent::IBuffer* dst, Diligent::Uint32 dst_offset, Diligent::Uint32 size) -> void = 0;
+
+		virtual auto set_vertex_buffer(Diligent::IBuffer* buffer, Diligent::Uint32 offset) -> void												 = 0;
+		virtual auto set_index_buffer(Diligent::IBuffer* buffer, Diligent::Uint32 offset) -> void												 = 0;
+		virtual auto set_pipeline_state(Diligent::IPipelineState* pso) -> void																	 = 0;
+		virtual auto set_blend_factors(const float* blend_factors) -> void																		 = 0;
+		virtual auto set_viewport(const Diligent::Viewport& viewport, Diligent::Uint32 rt_width, Diligent::Uint32 rt_height) -> void			 = 0;
+		virtual auto set_scissor_rect(const Diligent::Rect& rect, Diligent::Uint32 rt_width, Diligent::Uint32 rt_height) -> void				 = 0;
+		virtual auto commit_texture(Diligent::IShaderResourceBinding* srb, Diligent::IShaderResourceVariable* var, Diligent::ITextureView* view) -> void = 0;
+		virtual auto draw_indexed(const Diligent::DrawIndexedAttribs& attribs) -> void															 = 0;
+		virtual auto draw(const Diligent::DrawAttribs& attribs) -> void																			 = 0;
+
+		virtual auto set_render_target(Diligent::ITextureView* rtv, Diligent::ITextureView* dsv) -> void = 0;
+		virtual auto clear_render_target(Diligent::ITextureView* rtv, const float* clear_color) -> void	 = 0;
+		virtual auto clear_depth(Diligent::ITextureView* dsv, float depth) -> void						 = 0;
+		virtual auto copy_texture(Diligent::ITextureView* src, Diligent::ITextureView* dst) -> void		 = 0; // whole textures of equal size
+		virtual auto present(Diligent::ISwapChain* swap_chain, Diligent::Uint32 sync_interval) -> void	 = 0;
+	};
+
+	// RAII map/unmap, the render_context counterpart of Diligent's MapHelper.
+	template<typename T>
+	struct mapped_buffer
+	{
+		render_context*	   m_ctx;
+		Diligent::IBuffer* m_buffer;
+		T*				   m_data;
+
+		mapped_buffer(render_context* ctx, Diligent::IBuffer* buffer, Diligent::Uint32 count)
+			: m_ctx(ctx)
+			, m_buffer(buffer)
+			, m_data(static_cast<T*>(ctx->map_buffer(buffer, static_cast<Diligent::Uint32>(count * sizeof(T)), Diligent::MAP_WRITE, Diligent::MAP_FLAG_DISCARD)))
+		{
+		}
+
+		~mapped_buffer()
+		{
+			if (m_data != nullptr)
+			{
+				m_ctx->unmap_buffer(m_buffer, Diligent::MAP_WRITE);
+			}
+		}
+
+		mapped_buffer(const mapped_buffer&)			   = delete;
+		mapped_buffer& operator=(const mapped_buffer&) = delete;
+
+		operator T*()
+		{
+			return m_data;
+		}
+	};
+
+	// Forwards to a Diligent device context.
+	struct diligent_render_context : public render_context
+	{
+		Diligent::RefCntAutoPtr<Diligent::IDeviceContext> m_ctx;
+
+		explicit diligent_render_context(Diligent::IDeviceContext* ctx) : m_ctx(ctx) { }
+
+		virtual ~diligent_render_context() = default;
+
+		virtual auto map_buffer(Diligent::IBuffer* buffer, Diligent::Uint32, Diligent::MAP_TYPE map_type, Diligent::MAP_FLAGS map_flags) -> void* override final
+		{
+			void* data = nullptr;
+			m_ctx->MapBuffer(buffer, map_type, map_flags, data);
+			return data;
+		}
+
+		virtual auto unmap_buffer(Diligent::IBuffer* buffer, Diligent::MAP_TYPE map_type) -> void override final
+		{
+			m_ctx->UnmapBuffer(buffer, map_type);
+		}
+
+		virtual auto update_buffer(Diligent::IBuffer* buffer, Diligent::Uint32 offset, Diligent::Uint32 size, const void* data) -> void override final
+		{
+			m_ctx->UpdateBuffer(buffer, offset, size, data, Diligent::RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+		}
+
+		virtual auto update_texture(Diligent::ITextureView* view, const Diligent::Box& box, const void* data, Diligent::Uint32 stride) -> void override final
+		{
+			Diligent::TextureSubResData sub_resource(data, stride);
+			m_ctx->UpdateTexture(
+				view->GetTexture(),
+				0,
+				0,
+				box,
+				sub_resource,
+				Diligent::RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+				Diligent::RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+		}
+
+		virtual auto copy_buffer(Diligent::IBuffer* src, Diligent::Uint32 src_offset, Diligent::IBuffer* dst, Diligent::Uint32 dst_offset, Diligent::Uint32 size) -> void override final
+		{
+			m_ctx->CopyBuffer(
+				src,
+				src_offset,
+				Diligent::RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+				dst,
+				dst_offset,
+				size,
+				Diligent::RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+		}
+
+		virtual auto set_vertex_buffer(Diligent::IBuffer* buffer, Diligent::Uint32 offset) -> void override final
+		{
+			Diligent::Uint32   offsets[]		= {offset};
+			Diligent::IBuffer* vertex_buffers[] = {buffer};
+			m_ctx->SetVertexBuffers(
+				0,
+				1,
+				vertex_buffers,
+				offsets,
+				Diligent::RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+				Diligent::SET_VERTEX_BUFFERS_FLAG_RESET);
+		}
+
+		virtual auto set_index_buffer(Diligent::IBuffer* buffer, Diligent::Uint32 offset) -> void override final
+		{
+			m_ctx->SetIndexBuffer(buffer, offset, Diligent::RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+		}
+
+		virtual auto set_pipeline_state(Diligent::IPipelineState* pso) -> void override final
+		{
+			m_ctx->SetPipelineState(pso);
+		}
+
+		virtual auto set_blend_factors(const float* blend_factors) -> void override final
+		{
+			m_ctx->SetBlendFactors(blend_factors);
+		}
+
+		virtual auto set_viewport(const Diligent::Viewport& viewport, Diligent::Uint32 rt_width, Diligent::Uint32 rt_height) -> void override final
+		{
+			m_ctx->SetViewports(1, &viewport, rt_width, rt_height);
+		}
+
+		virtual auto set_scissor_rect(const Diligent::Rect& rect, Diligent::Uint32 rt_width, Diligent::Uint32 rt_height) -> void override final
+		{
+			m_ctx->SetScissorRects(1, &rect, rt_width, rt_height);
+		}
+
+		virtual auto commit_texture(Diligent::IShaderResourceBinding* srb, Diligent::IShaderResourceVariable* var, Diligent::ITextureView* view) -> void override final
+		{
+			var->Set(view);
+			m_ctx->CommitShaderResources(srb, Diligent::RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+		}
+
+		virtual auto draw_indexed(const Diligent::DrawIndexedAttribs& attribs) -> void override final
+		{
+			m_ctx->DrawIndexed(attribs);
+		}
+
+		virtual auto draw(const Diligent::DrawAttribs& attribs) -> void override final
+		{
+			m_ctx->Draw(attribs);
+		}
+
+		virtual auto set_render_target(Diligent::ITextureView* rtv, Diligent::ITextureView* dsv) -> void override final
+		{
+			m_ctx->SetRenderTargets(1, &rtv, dsv, Diligent::RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+		}
+
+		virtual auto clear_render_target(Diligent::ITextureView* rtv, const float* clear_color) -> void override final
+		{
+			m_ctx->ClearRenderTarget(rtv, clear_color, Diligent::RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+		}
+
+		virtual auto clear_depth(Diligent::ITextureView* dsv, float depth) -> void override final
+		{
+			m_ctx->ClearDepthStencil(dsv, Diligent::CLEAR_DEPTH_FLAG, depth, 0, Diligent::RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+		}
+
+		virtual auto copy_texture(Diligent::ITextureView* src, Diligent::ITextureView* dst) -> void override final
+		{
+			Diligent::CopyTextureAttribs attribs(
+				src->GetTexture(),
+				Diligent::RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+				dst->GetTexture(),
+				Diligent::RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+			m_ctx->CopyTexture(attribs);
+		}
+
+		virtual auto present(Diligent::ISwapChain* swap_chain, Diligent::Uint32 sync_interval) -> void override final
+		{
+			swap_chain->Present(sync_interval);
+		}
+	};
+
+	// Counts every call and forwards it to m_inner. Without an inner context it is a null context: maps hand out scratch memory,
+	// so the renderer can run without a device.
+	struct counting_render_context : public render_context
+	{
+		enum class call : std::size_t
+		{
+			map_buffer,
+			unmap_buffer,
+			update_buffer,
+			update_texture,
+			copy_buffer,
+			set_vertex_buffer,
+			set_index_buffer,
+			set_pipeline_state,
+			set_blend_factors,
+			set_viewport,
+			set_scissor_rect,
+			commit_texture,
+			draw_indexed,
+			draw,
+			set_render_target,
+			clear_render_target,
+			clear_depth,
+			copy_texture,
+			present,
+			count
+		};
+
+		render_context* m_inner{nullptr};
+
+		std::array<std::uint64_t, static_cast<std::size_t>(call::count)> m_calls{};
+		std::uint64_t													 m_bytes_mapped{0};
+		std::uint64_t													 m_bytes_updated{0};
+		std::uint64_t													 m_indices_drawn{0};
+		std::uint64_t													 m_instances_drawn{0}; // by draw
+
+		// Maps nest LIFO (vertex + index buffer are mapped together), so scratch memory is a stack.
+		std::vector<std::vector<std::byte>> m_scratch;
+		std::size_t							m_scratch_depth{0};
+
+		explicit counting_render_context(render_context* inner = nullptr) : m_inner(inner) { }
+
+		virtual ~counting_render_context() = default;
+
+		auto count(call c) noexcept -> void
+		{
+			++m_calls[static_cast<std::size_t>(c)];
+		}
+
+		[[nodiscard]] auto calls(call c) const noexcept -> std::uint64_t
+		{
+			return m_calls[static_cast<std::size_t>(c)];
+		}
+
+		// Everything except map/unmap/update, clears, draws, copies and presents, i.e. the calls that change pipeline state.
+		[[nodiscard]] auto state_calls() const noexcept -> std::uint64_t
+		{
+			return calls(call::set_vertex_buffer) + calls(call::set_index_buffer) + calls(call::set_pipeline_state) + calls(call::set_blend_factors) +
+				   calls(call::set_viewport) + calls(call::set_scissor_rect) + calls(call::commit_texture) + calls(call::set_render_target);
+		}
+
+		auto reset() noexcept -> void
+		{
+			m_calls.fill(0);
+			m_bytes_mapped	  = 0;
+			m_bytes_updated	  = 0;
+			m_indices_drawn	  = 0;
+			m_instances_drawn = 0;
+		}
+
+		virtual auto map_buffer(Diligent::IBuffer* buffer, Diligent::Uint32 size, Diligent::MAP_TYPE map_type, Diligent::MAP_FLAGS map_flags) -> void* override final
+		{
+			count(call::map_buffer);
+			m_bytes_mapped += size;
+			if (m_inner)
+			{
+				return m_inner->map_buffer(buffer, size, map_type, map_flags);
+			}
+
+			if (m_scratch.size() <= m_scratch_depth)
+			{
+				m_scratch.resize(m_scratch_depth + 1);
+			}
+			auto& scratch = m_scratch[m_scratch_depth++];
+			if (scratch.size() < size || scratch.empty())
+			{
+				// Never hand out nullptr, mapped_buffer treats that as a failed map and would skip the unmap.
+				scratch.resize(std::max<std::size_t>(size, 1));
+			}
+			return scratch.data();
+		}
+
+		virtual auto unmap_buffer(Diligent::IBuffer* buffer, Diligent::MAP_TYPE map_type) -> void override final
+		{
+			count(call::unmap_buffer);
+			if (m_inner)
+			{
+				m_inner->unmap_buffer(buffer, map_type);
+			}
+			else
+			{
+				--m_scratch_depth;
+			}
+		}
+
+		virtual auto update_buffer(Diligent::IBuffer* buffer, Diligent::Uint32 offset, Diligent::Uint32 size, const void* data) -> void override final
+		{
+			count(call::update_buffer);
+			m_bytes_updated += size;
+			if (m_inner)
+			{
+				m_inner->update_buffer(buffer, offset, size, data);
+			}
+		}
+
+		virtual auto update_texture(Diligent::ITextureView* view, const Diligent::Box& box, const void* data, Diligent::Uint32 stride) -> void override final
+		{
+			count(call::update_texture);
+			m_bytes_updated += static_cast<std::uint64_t>(stride) * (box.MaxY - box.MinY);
+			if (m_inner)
+			{
+				m_inner->update_texture(view, box, data, stride);
+			}
+		}
+
+		virtual auto copy_buffer(Diligent::IBuffer* src, Diligent::Uint32 src_offset, Diligent::IBuffer* dst, Diligent::Uint32 dst_offset, Diligent::Uint32 size) -> void override final
+		{
+			count(call::copy_buffer);
+			if (m_inner)
+			{
+				m_inner->copy_buffer(src, src_offset, dst, dst_offset, size);
+			}
+		}
+
+		virtual auto set_vertex_buffer(Diligent::IBuffer* buffer, Diligent::Uint32 offset) -> void override final
+		{
+			count(call::set_vertex_buffer);
+			if (m_inner)
+			{
+				m_inner->set_vertex_buffer(buffer, offset);
+			}
+		}
+
+		virtual auto set_index_buffer(Diligent::IBuffer* buffer, Diligent::Uint32 offset) -> void override final
+		{
+			count(call::set_index_buffer);
+			if (m_inner)
+			{
+				m_inner->set_index_buffer(buffer, offset);
+			}
+		}
+
+		virtual auto set_pipeline_state(Diligent::IPipelineState* pso) -> void override final
+		{
+			count(call::set_pipeline_state);
+			if (m_inner)
+			{
+				m_inner->set_pipeline_state(pso);
+			}
+		}
+
+		virtual auto set_blend_factors(const float* blend_factors) -> void override final
+		{
+			count(call::set_blend_factors);
+			if (m_inner)
+			{
+				m_inner->set_blend_factors(blend_factors);
+			}
+		}
+
+		virtual auto set_viewport(const Diligent::Viewport& viewport, Diligent::Uint32 rt_width, Diligent::Uint32 rt_height) -> void override final
+		{
+			count(call::set_viewport);
+			if (m_inner)
+			{
+				m_inner->set_viewport(viewport, rt_width, rt_height);
+			}
+		}
+
+		virtual auto set_scissor_rect(const Diligent::Rect& rect, Diligent::Uint32 rt_width, Diligent::Uint32 rt_height) -> void override final
+		{
+			count(call::set_scissor_rect);
+			if (m_inner)
+			{
+				m_inner->set_scissor_rect(rect, rt_width, rt_height);
+			}
+		}
+
+		virtual auto commit_texture(Diligent::IShaderResourceBinding* srb, Diligent::IShaderResourceVariable* var, Diligent::ITextureView* view) -> void override final
+		{
+			count(call::commit_texture);
+			if (m_inner)
+			{
+				m_inner->commit_texture(srb, var, view);
+			}
+		}
+
+		virtual auto draw_indexed(const Diligent::DrawIndexedAttribs& attribs) -> void override final
+		{
+			count(call::draw_indexed);
+			m_indices_drawn += attribs.NumIndices;
+			if (m_inner)
+			{
+				m_inner->draw_indexed(attribs);
+			}
+		}
+
+		virtual auto draw(const Diligent::DrawAttribs& attribs) -> void override final
+		{
+			count(call::draw);
+			m_instances_drawn += attribs.NumInstances;
+			if (m_inner)
+			{
+				m_inner->draw(attribs);
+			}
+		}
+
+		virtual auto set_render_target(Diligent::ITextureView* rtv, Diligent::ITextureView* dsv) -> void override final
+		{
+			count(call::set_render_target);
+			if (m_inner)
+			{
+				m_inner->set_render_target(rtv, dsv);
+			}
+		}
+
+		virtual auto clear_render_target(Diligent::ITextureView* rtv, const float* clear_color) -> void override final
+		{
+			count(call::clear_render_target);
+			if (m_inner)
+			{
+				m_inner->clear_render_target(rtv, clear_color);
+			}
+		}
+
+		virtual auto clear_depth(Diligent::ITextureView* dsv, float depth) -> void override final
+		{
+			count(call::clear_depth);
+			if (m_inner)
+			{
+				m_inner->clear_depth(dsv, depth);
+			}
+		}
+
+		virtual auto copy_texture(Diligent::ITextureView* src, Diligent::ITextureView* dst) -> void override final
+		{
+			count(call::copy_texture);
+			if (m_inner)
+			{
+				m_inner->copy_texture(src, dst);
+			}
+		}
+
+		virtual auto present(Diligent::ISwapChain* swap_chain, Diligent::Uint32 sync_interval) -> void override final
+		{
+			count(call::present);
+			if (m_inner)
+			{
+				m_inner->present(swap_chain, sync_interval);
+			}
+		}
+	};
+} // namespace mu
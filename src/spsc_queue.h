@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+namespace mu
+{
+	// Bounded single-producer single-consumer ring. push and pop never block or allocate; push fails when the ring is full.
+	template<typename T, std::size_t Capacity>
+	struct spsc_queue
+	{
+		static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+		std::array<T, Capacity> m_items;
+
+		// Producer and consumer indices on separate cache lines, so the two threads do not share one
+		alignas(64) std::atomic<std::size_t> m_head{0}; // next slot to write
+		alignas(64) std::atomic<std::size_t> m_tail{0}; // next slot to read
+
+		[[nodiscard]] auto push(const T& item) noexcept -> bool
+		{
+			const auto head = m_head.load(std::memory_order_relaxed);
+			if (head - m_tail.load(std::memory_order_acquire) == Capacity) [[unlikely]]
+			{
+				return false;
+			}
+
+			m_items[head & (Capacity - 1)] = item;
+			m_head.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+		[[nodiscard]] auto pop(T& item) noexcept -> bool
+		{
+			const auto tail = m_tail.load(std::memory_order_relaxed);
+			if (tail == m_head.load(std::memory_order_acquire))
+			{
+				return false;
+			}
+
+			item = m_items[tail & (Capacity - 1)];
+			m_tail.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Pops everything available at the time of the call, acquiring the producer index once for the whole batch.
+		template<typename Func>
+		auto drain(Func&& func) noexcept(noexcept(func(std::declval<T&>()))) -> std::size_t
+		{
+			const auto tail = m_tail.load(std::memory_order_relaxed);
+			const auto head = m_head.load(std::memory_order_acquire);
+			for (auto n = tail; n != head; ++n)
+			{
+				func(m_items[n & (Capacity - 1)]);
+			}
+			m_tail.store(head, std::memory_order_release);
+			return head - tail;
+		}
+	};
+} // namespace mu
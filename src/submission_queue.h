@@ -0,0 +1,166 @@
+#pragma once
+
+#include <mu_gfx.h>
+#include <mu_gfx_trace.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace mu
+{
+	// Owns all use of an immediate device context, which is not thread-safe. Any thread pushes jobs, one thread runs them in push
+	// order, so frame stages of different windows can run in parallel and only their GPU submissions are serialized.
+	//
+	// Each submitter keeps a stream: the ticket of its last job and whether one of its jobs failed, so a window only waits for and
+	// is only told about its own work.
+	//
+	// run_inline lets a submitter use the context on its own thread instead, between two jobs of the queue thread, for work that
+	// would be waited for right away: it saves the round trip through the queue thread and runs in parallel with everything else
+	// but the queue's jobs.
+	struct submission_queue
+	{
+		using job = std::function<leaf::result<void>()>;
+
+		struct stream
+		{
+			std::uint64_t m_last{0}; // ticket of the last job pushed on this stream
+			bool		  m_failed{false};
+		};
+
+		struct entry
+		{
+			std::uint64_t m_ticket;
+			stream*		  m_stream;
+			job			  m_job;
+		};
+
+		std::mutex				m_mutex;
+		std::mutex				m_context_mutex; // held while the context is used, by a job or by run_inline
+		std::condition_variable m_cv;
+		std::deque<entry>		m_entries;
+		std::uint64_t			m_pushed{0};
+		std::uint64_t			m_completed{0};
+		bool					m_stop{false};
+		std::thread				m_thread;
+
+		submission_queue()
+		{
+			m_thread = std::thread(
+				[this]()
+				{
+					MU_GFX_TRACE_THREAD_NAME("submit");
+					run();
+				});
+		}
+
+		// Runs what is still queued, then joins.
+		~submission_queue()
+		{
+			{
+				std::unique_lock lock(m_mutex);
+				m_stop = true;
+			}
+			m_cv.notify_all();
+			m_thread.join();
+		}
+
+		submission_queue(const submission_queue&)			 = delete;
+		submission_queue& operator=(const submission_queue&) = delete;
+
+		// The stream must outlive the job, wait on it before destroying it.
+		[[nodiscard]] auto push(stream& s, job j) noexcept -> leaf::result<void>
+		try
+		{
+			{
+				std::unique_lock lock(m_mutex);
+				s.m_last = ++m_pushed;
+				m_entries.push_back(entry{s.m_last, &s, std::move(j)});
+			}
+			m_cv.notify_all();
+			return {};
+		}
+		catch (...)
+		{
+			return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+		}
+
+		// Blocks until every job pushed on s has run. Reports a failure of any of them since the last wait.
+		[[nodiscard]] auto wait(stream& s) noexcept -> leaf::result<void>
+		try
+		{
+			MU_GFX_TRACE_SCOPE("wait_submissions");
+			std::unique_lock lock(m_mutex);
+			m_cv.wait(lock, [&]() { return m_completed >= s.m_last; });
+			if (std::exchange(s.m_failed, false)) [[unlikely]]
+			{
+				return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+			}
+			return {};
+		}
+		catch (...)
+		{
+			return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+		}
+
+		// Runs func on the calling thread once every job pushed on s has run, holding the context while no job runs.
+		template<typename T_FUNC>
+		[[nodiscard]] auto run_inline(stream& s, T_FUNC&& func) noexcept -> leaf::result<void>
+		try
+		{
+			MU_LEAF_CHECK(wait(s));
+			std::unique_lock context(m_context_mutex);
+			return func();
+		}
+		catch (...)
+		{
+			return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+		}
+
+		// Blocks until every job pushed so far, on any stream, has run.
+		[[nodiscard]] auto wait_idle() noexcept -> leaf::result<void>
+		try
+		{
+			std::unique_lock lock(m_mutex);
+			const auto		 target = m_pushed;
+			m_cv.wait(lock, [&]() { return m_completed >= target; });
+			return {};
+		}
+		catch (...)
+		{
+			return MU_LEAF_NEW_ERROR(gfx_error::not_specified{});
+		}
+
+	private:
+		auto run() noexcept -> void
+		{
+			std::unique_lock lock(m_mutex);
+			while (true)
+			{
+				m_cv.wait(lock, [this]() { return !m_entries.empty() || m_stop; });
+				if (!m_entries.empty())
+				{
+					auto e = std::move(m_entries.front());
+					m_entries.pop_front();
+					lock.unlock();
+					bool failed = false;
+					{
+						std::unique_lock context(m_context_mutex);
+						failed = !e.m_job();
+					}
+					lock.lock();
+					e.m_stream->m_failed |= failed;
+					m_completed = e.m_ticket;
+					m_cv.notify_all();
+				}
+				else if (m_stop)
+				{
+					return;
+				}
+			}
+		}
+	};
+} // namespace mu
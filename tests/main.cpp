@@ -1,8 +1,21 @@
 #include <mu_gfx.h>
+#include <mu_gfx_trace.h>
+
+#include <unordered_map>
 
 static auto all_error_handlers = std::tuple_cat(mu::error_handlers, mu::only_gfx_error_handlers);
 
-static auto imgui_test_frame(std::shared_ptr<mu::gfx_window>& wwnd, bool& create_new_window) noexcept -> mu::leaf::result<void>
+// Per window, so UI building can run for several windows at once
+struct test_ui_state
+{
+	bool			   demo_open	   = true;
+	bool			   opt_fullscreen  = true;
+	bool			   opt_padding	   = false;
+	ImGuiDockNodeFlags dockspace_flags = ImGuiDockNodeFlags_None;
+};
+
+static auto imgui_test_frame(const std::shared_ptr<mu::gfx_window>& wwnd, test_ui_state& state, bool show_demo, std::atomic<bool>& create_new_window) noexcept
+	-> mu::leaf::result<void>
 {
 	MU_LEAF_CHECK(wwnd->make_current());
 
@@ -11,10 +24,10 @@ static auto imgui_test_frame(std::shared_ptr<mu::gfx_window>& wwnd, bool& create
 		ImGui::PushID(wwnd.get());
 		{
 			{
-				static bool				  demo_open		  = true;
-				static bool				  opt_fullscreen  = true;
-				static bool				  opt_padding	  = false;
-				static ImGuiDockNodeFlags dockspace_flags = ImGuiDockNodeFlags_None;
+				auto& demo_open		  = state.demo_open;
+				auto& opt_fullscreen  = state.opt_fullscreen;
+				auto& opt_padding	  = state.opt_padding;
+				auto& dockspace_flags = state.dockspace_flags;
 
 				// We are using the ImGuiWindowFlags_NoDocking flag to make the parent window not dockable into,
 				// because it would be confusing to have two docking targets within each others.
@@ -108,11 +121,19 @@ static auto imgui_test_frame(std::shared_ptr<mu::gfx_window>& wwnd, bool& create
 
 				ImGui::Text("%.3f ms/frame (%.1f FPS)", ImGui::GetIO().DeltaTime * 1000.0f, 1.0f / ImGui::GetIO().DeltaTime);
 
-				create_new_window |= ImGui::Button("Create New Window");
+				if (ImGui::Button("Create New Window"))
+				{
+					create_new_window = true;
+				}
 
 				ImGui::End();
 			}
-			ImGui::ShowDemoWindow();
+
+			// The demo window keeps its state in function statics, it can only be shown by one window
+			if (show_demo)
+			{
+				ImGui::ShowDemoWindow();
+			}
 		}
 		ImGui::PopID();
 
@@ -124,119 +145,6 @@ static auto imgui_test_frame(std::shared_ptr<mu::gfx_window>& wwnd, bool& create
 	}
 }
 
-struct app_stask_state
-{
-	std::vector<std::shared_ptr<mu::gfx_window>>& windows;
-	bool&										  create_new_window;
-	std::array<std::atomic<std::uint32_t>, 8>	  m_window_task_counters;
-};
-
-static auto app_test_frame(tf::Executor* executor, app_stask_state* ts) noexcept -> mu::leaf::result<void>
-{
-	for (auto& cnt : ts->m_window_task_counters)
-	{
-		cnt = 0;
-	}
-
-	tf::Taskflow stage_1;
-	for (auto itor = ts->windows.begin(); itor != ts->windows.end(); ++itor)
-	{
-		stage_1
-			.emplace(
-				[ts]()
-				{
-					if (auto func_error = [&]() -> mu::leaf::result<void>
-						{
-							auto  n	   = ts->m_window_task_counters[0]++;
-							auto& wwnd = ts->windows[n];
-							MU_LEAF_CHECK(wwnd->begin_frame_async());
-							return {};
-						}();
-						!func_error) [[unlikely]]
-					{
-						// log error func_error.get_error_id().value();
-					}
-				})
-			.name("begin_frame");
-	}
-	executor->run(stage_1).wait();
-
-	for (auto itor = ts->windows.begin(); itor != ts->windows.end(); ++itor)
-	{
-		{
-			auto  n	   = ts->m_window_task_counters[1]++;
-			auto& wwnd = ts->windows[n];
-			MU_LEAF_CHECK(wwnd->begin_imgui_sync());
-		}
-		{
-			auto  n	   = ts->m_window_task_counters[3]++;
-			auto& wwnd = ts->windows[n];
-			MU_LEAF_CHECK(imgui_test_frame(wwnd, ts->create_new_window));
-		}
-	}
-
-	tf::Taskflow stage_2;
-	for (auto itor = ts->windows.begin(); itor != ts->windows.end(); ++itor)
-	{
-		stage_2
-			.emplace(
-				[ts]()
-				{
-					if (auto func_error = [&]() -> mu::leaf::result<void>
-						{
-							{
-								auto  n	   = ts->m_window_task_counters[4]++;
-								auto& wwnd = ts->windows[n];
-								MU_LEAF_CHECK(wwnd->end_imgui_async());
-							}
-							return {};
-						}();
-						!func_error) [[unlikely]]
-					{
-						// log error func_error.get_error_id().value();
-					}
-				})
-			.name("begin_end_imgui");
-	}
-	executor->run(stage_2).wait();
-
-	for (auto itor = ts->windows.begin(); itor != ts->windows.end(); ++itor)
-	{
-		{
-			auto  n	   = ts->m_window_task_counters[5]++;
-			auto& wwnd = ts->windows[n];
-			MU_LEAF_CHECK(wwnd->end_imgui_sync());
-		}
-	}
-
-	tf::Taskflow stage_3;
-	for (auto itor = ts->windows.begin(); itor != ts->windows.end(); ++itor)
-	{
-		stage_3
-			.emplace(
-				[ts]()
-				{
-					if (auto func_error = [&]() -> mu::leaf::result<void>
-						{
-							{
-								auto  n	   = ts->m_window_task_counters[7]++;
-								auto& wwnd = ts->windows[n];
-								MU_LEAF_CHECK(wwnd->end_frame());
-							}
-							return {};
-						}();
-						!func_error) [[unlikely]]
-					{
-						// log error func_error.get_error_id().value();
-					}
-				})
-			.name("end_imgui_end_frame");
-	}
-	executor->run(stage_3).wait();
-
-	return {};
-}
-
 auto main(int, char**) -> int
 {
 	if (auto app_error = []() -> mu::leaf::result<void>
@@ -254,46 +162,59 @@ auto main(int, char**) -> int
 				MU_LEAF_CHECK(wnd->show());
 			}
 
-			bool create_new_window = false;
+			std::atomic<bool>								   create_new_window = false;
+			std::unordered_map<mu::gfx_window*, test_ui_state> ui_states;
+
+			MU_GFX_TRACE_THREAD_NAME("main");
 
 			tf::Executor executor;
+			MU_GFX_TRACE_EXECUTOR(executor);
 			while (windows.size() > 0)
 			{
-				MU_LEAF_CHECK(mu::gfx()->do_frame(
-					[&]() noexcept -> mu::leaf::result<void>
+				if (create_new_window)
+				{
+					create_new_window = false;
+					if (auto new_wnd_res = mu::gfx()->open_window(200, 200, 640, 480))
+					{
+						(*new_wnd_res)->show();
+						windows.emplace_back(std::move(*new_wnd_res));
+					}
+				}
+
+				for (auto itor = windows.begin(); itor != windows.end();)
+				{
+					auto& wwnd = *itor;
+					if (wwnd)
 					{
-						if (create_new_window)
+						MU_LEAF_AUTO(wants_to_close, wwnd->wants_to_close());
+
+						if (wants_to_close) [[unlikely]]
 						{
-							create_new_window = false;
-							if (auto new_wnd_res = mu::gfx()->open_window(200, 200, 640, 480))
-							{
-								(*new_wnd_res)->show();
-								windows.emplace_back(std::move(*new_wnd_res));
-							}
+							ui_states.erase(wwnd.get());
+							itor = windows.erase(itor);
 						}
-
-						for (auto itor = windows.begin(); itor != windows.end();)
+						else
 						{
-							auto& wwnd = *itor;
-							if (wwnd)
-							{
-								MU_LEAF_AUTO(wants_to_close, wwnd->wants_to_close());
-
-								if (wants_to_close) [[unlikely]]
-								{
-									itor = windows.erase(itor);
-								}
-								else
-								{
-									++itor;
-								}
-							}
+							++itor;
 						}
+					}
+				}
+
+				// UI state must exist before UI building can run concurrently
+				for (auto& wwnd : windows)
+				{
+					ui_states[wwnd.get()];
+				}
 
-						auto ts = app_stask_state{windows, create_new_window};
-						return app_test_frame(&executor, &ts);
+				MU_LEAF_CHECK(mu::gfx()->run_frame(
+					executor,
+					[&](const std::shared_ptr<mu::gfx_window>& wwnd) -> mu::leaf::result<void>
+					{
+						return imgui_test_frame(wwnd, ui_states.at(wwnd.get()), wwnd == windows.front(), create_new_window);
 					}));
 			}
+
+			MU_LEAF_CHECK(mu::gfx_trace::write_chrome_trace("mu_gfx_trace.json"));
 			return {};
 		}();
 		!app_error) [[unlikely]]